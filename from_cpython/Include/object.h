@@ -834,13 +834,39 @@ PyAPI_FUNC(void) _Py_PrintReferenceAddressesCapped(FILE *, int) PYSTON_NOEXCEPT;
     (*Py_TYPE(op)->tp_dealloc)((PyObject *)(op)))
 #endif /* !Py_TRACE_REFS */
 
-#define Py_INCREF(op) (                         \
+/* Pyston addition: immortal objects.
+ *
+ * Objects that live for the whole lifetime of the runtime (None, True/False, the small ints, the builtin types,
+ * immortal interned strings) get a refcount of _Py_IMMORTAL_REFCNT, and Py_INCREF/Py_DECREF (as well as the
+ * refcounting code that the JITs emit) leave such objects alone.  This means that these objects' cache lines don't
+ * get written to all the time, and that their pages stay shared after a fork().
+ *
+ * An object is immortal iff the upper half of its refcount is nonzero, which the JITs can check with a single
+ * 32-bit compare.  The refcount stays a big positive number, so "Py_REFCNT(op) == 1" checks keep working.
+ *
+ * Debug builds tear down the whole runtime at exit and check that every reference got released again, so
+ * they don't use immortal objects.
+ */
+#ifndef Py_REF_DEBUG
+#define Py_IMMORTAL_OBJECTS
+#define _Py_IMMORTAL_REFCNT ((Py_ssize_t)1 << 32)
+#define _Py_IsImmortal(op) (((PyObject*)(op))->ob_refcnt >= _Py_IMMORTAL_REFCNT)
+#define _Py_SetImmortal(op) (((PyObject*)(op))->ob_refcnt = _Py_IMMORTAL_REFCNT)
+#else
+#define _Py_IsImmortal(op) 0
+#define _Py_SetImmortal(op) ((void)0)
+#endif
+
+#define Py_INCREF(op) ((void)(                  \
+    _Py_IsImmortal(op) ? 0 : (                  \
     _Py_INC_REFTOTAL  _Py_REF_DEBUG_COMMA       \
-    ((PyObject*)(op))->ob_refcnt++)
+    ((PyObject*)(op))->ob_refcnt++)))
 
 #define Py_DECREF(op)                                   \
     do {                                                \
-        if (_Py_DEC_REFTOTAL  _Py_REF_DEBUG_COMMA       \
+        if (_Py_IsImmortal(op))                         \
+            ;                                           \
+        else if (_Py_DEC_REFTOTAL  _Py_REF_DEBUG_COMMA  \
         --((PyObject*)(op))->ob_refcnt != 0)            \
             _Py_CHECK_REFCNT(op)                        \
         else                                            \
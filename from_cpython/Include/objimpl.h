@@ -236,6 +236,12 @@ PyAPI_FUNC(PyVarObject *) _PyObject_NewVar(PyTypeObject *, Py_ssize_t) PYSTON_NO
 /* C equivalent of gc.collect(). */
 PyAPI_FUNC(Py_ssize_t) PyGC_Collect(void) PYSTON_NOEXCEPT;
 
+/* Pyston addition: moves all the objects that are currently tracked into a
+ * permanent generation which is excluded from collections. */
+PyAPI_FUNC(Py_ssize_t) _PyGC_Freeze(void) PYSTON_NOEXCEPT;
+PyAPI_FUNC(void) _PyGC_Unfreeze(void) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyGC_GetFreezeCount(void) PYSTON_NOEXCEPT;
+
 /* Test if a type has a GC head */
 #define PyType_IS_GC(t) PyType_HasFeature((t), Py_TPFLAGS_HAVE_GC)
 
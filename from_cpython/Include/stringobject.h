@@ -92,6 +92,14 @@ PyAPI_FUNC(void) _Py_ReleaseInternedStrings(void) PYSTON_NOEXCEPT;
 // Pyston addition:
 PyAPI_FUNC(char) PyString_GetItem(PyObject *, Py_ssize_t) PYSTON_NOEXCEPT;
 
+// Pyston addition: vectorized search kernels for byte strings.  The find functions return the index of the first
+// match or -1; the count functions count non-overlapping matches, stopping at maxcount.
+PyAPI_FUNC(Py_ssize_t) _PyString_FindChar(const char *s, Py_ssize_t n, char c) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_CountChar(const char *s, Py_ssize_t n, char c, Py_ssize_t maxcount) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_Find(const char *s, Py_ssize_t n, const char *p, Py_ssize_t m) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_Count(const char *s, Py_ssize_t n, const char *p, Py_ssize_t m,
+                                       Py_ssize_t maxcount) PYSTON_NOEXCEPT;
+
 /* Use only if you know it's a string */
 #define PyString_CHECK_INTERNED(op) (((PyStringObject *)(op))->ob_sstate)
 
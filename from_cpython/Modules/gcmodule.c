@@ -49,6 +49,12 @@ static struct gc_generation generations[NUM_GENERATIONS] = {
 
 PyGC_Head * const _PyGC_generation0 = GEN_HEAD(0);
 
+/* Pyston addition: objects moved here by _PyGC_Freeze() are never collected. */
+static struct gc_generation permanent_generation = {
+    {{&permanent_generation.head, &permanent_generation.head, 0}}, 0, 0
+};
+#define PERMANENT_HEAD (&permanent_generation.head)
+
 static int enabled = 1; /* automatic collection enabled? */
 
 /* true if we are currently running the collector */
@@ -1534,6 +1540,63 @@ PyGC_Collect(void)
     return n;
 }
 
+#ifdef Py_IMMORTAL_OBJECTS
+static int
+visit_immortalize(PyObject *op, void *data)
+{
+    _Py_SetImmortal(op);
+    return 0;
+}
+#endif
+
+/* Pyston addition, similar to CPython 3.7's gc.freeze().  Meant to be called
+ * in a pre-fork server before forking the workers: the collector will never
+ * look at the frozen objects again, and we also make them (and everything
+ * they directly reference) immortal, so that the children don't write to
+ * their pages and they stay shared.
+ */
+Py_ssize_t
+_PyGC_Freeze(void)
+{
+    int i;
+#ifdef Py_IMMORTAL_OBJECTS
+    PyGC_Head *gc;
+#endif
+
+    if (collecting)
+        return 0;
+
+    for (i = 0; i < NUM_GENERATIONS; i++)
+        gc_list_merge(GEN_HEAD(i), PERMANENT_HEAD);
+    generations[0].count = 0;
+
+#ifdef Py_IMMORTAL_OBJECTS
+    for (gc = PERMANENT_HEAD->gc.gc_next; gc != PERMANENT_HEAD; gc = gc->gc.gc_next) {
+        PyObject *op = FROM_GC(gc);
+        _Py_SetImmortal(op);
+        (void) Py_TYPE(op)->tp_traverse(op, (visitproc)visit_immortalize, NULL);
+    }
+#endif
+
+    return gc_list_size(PERMANENT_HEAD);
+}
+
+/* Puts the frozen objects back into the oldest generation.  Their refcounts
+ * stay immortal, so the collector won't ever free them, but gc.get_objects()
+ * and gc.get_referrers() will see them again.
+ */
+void
+_PyGC_Unfreeze(void)
+{
+    gc_list_merge(PERMANENT_HEAD, GEN_HEAD(NUM_GENERATIONS - 1));
+}
+
+Py_ssize_t
+_PyGC_GetFreezeCount(void)
+{
+    return gc_list_size(PERMANENT_HEAD);
+}
+
 /* for debugging */
 void
 _PyGC_Dump(PyGC_Head *g)
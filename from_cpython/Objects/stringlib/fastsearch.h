@@ -47,6 +47,15 @@ fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
     if (w < 0 || (mode == FAST_COUNT && maxcount == 0))
         return -1;
 
+    // Pyston change: byte strings go through our vectorized kernels.  The sizeof check is a compile-time constant,
+    // so the unicode instantiations don't pay for it.
+    if (sizeof(STRINGLIB_CHAR) == 1 && m > 0) {
+        if (mode == FAST_SEARCH)
+            return _PyString_Find((const char*)s, n, (const char*)p, m);
+        if (mode == FAST_COUNT)
+            return _PyString_Count((const char*)s, n, (const char*)p, m, maxcount);
+    }
+
     /* look for special cases */
     if (m <= 1) {
         if (m <= 0)
@@ -116,6 +116,16 @@ stringlib_split_char(PyObject* str_obj,
 
     i = j = 0;
     while ((j < str_len) && (maxcount-- > 0)) {
+        // Pyston change: use the vectorized kernel for byte strings.
+        if (sizeof(STRINGLIB_CHAR) == 1) {
+            Py_ssize_t pos = _PyString_FindChar((const char*)str + j, str_len - j, (char)ch);
+            if (pos == -1)
+                break;
+            j += pos;
+            SPLIT_ADD(str, i, j);
+            i = j = j + 1;
+            continue;
+        }
         for(; j < str_len; j++) {
             /* I found that using memchr makes no difference */
             if (str[j] == ch) {
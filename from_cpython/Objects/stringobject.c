@@ -426,8 +426,13 @@ done:
 
 /* find and count characters and substrings */
 
-#define findchar(target, target_len, c)                         \
-  ((char *)memchr((const void *)(target), c, target_len))
+// Pyston change: use our vectorized kernel instead of memchr
+Py_LOCAL_INLINE(char *)
+findchar(const char *target, Py_ssize_t target_len, char c)
+{
+    Py_ssize_t pos = _PyString_FindChar(target, target_len, c);
+    return pos == -1 ? NULL : (char *)target + pos;
+}
 
 /* String ops must return a string.  */
 /* If the object is subclass of string, create a copy */
@@ -446,17 +451,8 @@ return_self(PyStringObject *self)
 Py_LOCAL_INLINE(Py_ssize_t)
 countchar(const char *target, Py_ssize_t target_len, char c, Py_ssize_t maxcount)
 {
-    Py_ssize_t count=0;
-    const char *start=target;
-    const char *end=target+target_len;
-
-    while ( (start=findchar(start, end-start, c)) != NULL ) {
-        count++;
-        if (count >= maxcount)
-            break;
-        start += 1;
-    }
-    return count;
+    // Pyston change: use our vectorized kernel
+    return _PyString_CountChar(target, target_len, c, maxcount);
 }
 
 /* Algorithms for different cases of string replacement */
@@ -680,6 +680,53 @@ void Assembler::cvtss2sd(XMMRegister src, XMMRegister dest) {
     emitModRM(0b11, src_idx, dest_idx);
 }
 
+void Assembler::emitSSEArith(Indirect src, XMMRegister dest, uint8_t opcode) {
+    int rex = 0;
+    int src_idx = src.base.regnum;
+    int dest_idx = dest.regnum;
+
+    if (src_idx >= 8) {
+        rex |= REX_B;
+        src_idx -= 8;
+    }
+    if (dest_idx >= 8) {
+        rex |= REX_R;
+        dest_idx -= 8;
+    }
+
+    emitByte(0xf2);
+    if (rex)
+        emitRex(rex);
+    emitByte(0x0f);
+    emitByte(opcode);
+
+    bool needssib = (src_idx == 0b100);
+    int mode = getModeFromOffset(src.offset, src_idx);
+    emitModRM(mode, dest_idx, src_idx);
+
+    if (needssib)
+        emitSIB(0b00, 0b100, src_idx);
+
+    if (mode == 0b01) {
+        emitByte(src.offset);
+    } else if (mode == 0b10) {
+        assert(fitsInto<int32_t>(src.offset));
+        emitInt(src.offset, 4);
+    }
+}
+
+void Assembler::addsd(Indirect src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x58);
+}
+
+void Assembler::subsd(Indirect src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x5c);
+}
+
+void Assembler::mulsd(Indirect src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x59);
+}
+
 void Assembler::push(Register reg) {
     // assert(0 && "This breaks unwinding, please don't use.");
 
@@ -724,6 +771,34 @@ void Assembler::add(Immediate imm, Indirect mem) {
     emitArith(imm, mem, OPCODE_ADD);
 }
 
+void Assembler::add(Indirect src, Register dest) {
+    emitArith(src, dest, 0x03);
+}
+
+void Assembler::add(Register src, Register dest) {
+    emitArith(src, dest, 0x01);
+}
+
+void Assembler::sub(Indirect src, Register dest) {
+    emitArith(src, dest, 0x2B);
+}
+
+void Assembler::shl(Immediate imm, Register reg) {
+    assert(imm.val < 64);
+
+    int reg_idx = reg.regnum;
+    int rex = REX_W;
+    if (reg_idx >= 8) {
+        rex |= REX_B;
+        reg_idx -= 8;
+    }
+
+    emitRex(rex);
+    emitByte(0xC1);
+    emitModRM(0b11, 4, reg_idx);
+    emitByte(imm.val);
+}
+
 void Assembler::incl(Indirect mem) {
     int src_idx = mem.base.regnum;
 
@@ -905,6 +980,10 @@ void Assembler::retq() {
 
 
 void Assembler::cmp(Register reg1, Register reg2) {
+    emitArith(reg1, reg2, 0x39);
+}
+
+void Assembler::emitArith(Register reg1, Register reg2, uint8_t opcode) {
     int reg1_idx = reg1.regnum;
     int reg2_idx = reg2.regnum;
 
@@ -922,7 +1001,7 @@ void Assembler::cmp(Register reg1, Register reg2) {
     assert(reg2_idx >= 0 && reg2_idx < 8);
 
     emitRex(rex);
-    emitByte(0x39);
+    emitByte(opcode);
     emitModRM(0b11, reg1_idx, reg2_idx);
 }
 
@@ -971,6 +1050,10 @@ void Assembler::cmp(Indirect mem, Immediate imm, MovType type) {
 }
 
 void Assembler::cmp(Indirect mem, Register reg) {
+    emitArith(mem, reg, 0x3B);
+}
+
+void Assembler::emitArith(Indirect mem, Register reg, uint8_t opcode) {
     int mem_idx = mem.base.regnum;
     int reg_idx = reg.regnum;
 
@@ -990,7 +1073,7 @@ void Assembler::cmp(Indirect mem, Register reg) {
     bool needssib = (mem_idx == 0b100);
 
     emitRex(rex);
-    emitByte(0x3B);
+    emitByte(opcode);
 
     if (mem.offset == 0 && mem.base != RBP) {
         emitModRM(0b00, reg_idx, mem_idx);
@@ -1261,17 +1344,27 @@ void Assembler::skipBytes(int num) {
 
 template <int MaxJumpSize>
 ForwardJumpBase<MaxJumpSize>::ForwardJumpBase(Assembler& assembler, ConditionCode condition)
-    : assembler(assembler), condition(condition), jmp_inst(assembler.curInstPointer()) {
+    : assembler(assembler), condition(condition), jmp_inst(assembler.curInstPointer()), unconditional(false) {
     assembler.jmp_cond(JumpDestination::fromStart(assembler.bytesWritten() + MaxJumpSize), condition);
     jmp_end = assembler.curInstPointer();
 }
 
+template <int MaxJumpSize>
+ForwardJumpBase<MaxJumpSize>::ForwardJumpBase(Assembler& assembler)
+    : assembler(assembler), condition(COND_OVERFLOW), jmp_inst(assembler.curInstPointer()), unconditional(true) {
+    assembler.jmp(JumpDestination::fromStart(assembler.bytesWritten() + MaxJumpSize));
+    jmp_end = assembler.curInstPointer();
+}
+
 template <int MaxJumpSize> ForwardJumpBase<MaxJumpSize>::~ForwardJumpBase() {
     uint8_t* new_pos = assembler.curInstPointer();
     int offset = new_pos - jmp_inst;
     RELEASE_ASSERT(offset < MaxJumpSize, "");
     assembler.setCurInstPointer(jmp_inst);
-    assembler.jmp_cond(JumpDestination::fromStart(assembler.bytesWritten() + offset), condition);
+    if (unconditional)
+        assembler.jmp(JumpDestination::fromStart(assembler.bytesWritten() + offset));
+    else
+        assembler.jmp_cond(JumpDestination::fromStart(assembler.bytesWritten() + offset), condition);
     while (assembler.curInstPointer() < jmp_end)
         assembler.nop();
     assembler.setCurInstPointer(new_pos);
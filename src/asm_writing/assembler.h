@@ -89,6 +89,12 @@ private:
     void emitSIB(uint8_t scalebits, uint8_t index, uint8_t base);
     void emitArith(Immediate imm, Register reg, int opcode, MovType type = MovType::Q);
     void emitArith(Immediate imm, Indirect mem, int opcode);
+    // reg = reg <op> mem; opcode is the one of the "op r64, r/m64" form.
+    void emitArith(Indirect mem, Register reg, uint8_t opcode);
+    // reg2 = reg2 <op> reg1; opcode is the one of the "op r/m64, r64" form.
+    void emitArith(Register reg1, Register reg2, uint8_t opcode);
+    // Scalar double arithmetic: dest = dest <op> src.
+    void emitSSEArith(Indirect src, XMMRegister dest, uint8_t opcode);
 
     int getModeFromOffset(int offset, int reg_idx) const;
 
@@ -127,6 +133,9 @@ public:
 
     void movss(Indirect src, XMMRegister dest);
     void cvtss2sd(XMMRegister src, XMMRegister dest);
+    void addsd(Indirect src, XMMRegister dest);
+    void subsd(Indirect src, XMMRegister dest);
+    void mulsd(Indirect src, XMMRegister dest);
 
     void mov(Indirect scr, Register dest);
     void movq(Indirect scr, Register dest);
@@ -153,7 +162,11 @@ public:
 
     void add(Immediate imm, Register reg);
     void add(Immediate imm, Indirect mem);
+    void add(Indirect src, Register dest);
+    void add(Register src, Register dest);
     void sub(Immediate imm, Register reg);
+    void sub(Indirect src, Register dest);
+    void shl(Immediate imm, Register reg);
 
     void incl(Indirect mem);
     void decl(Indirect mem);
@@ -225,8 +238,12 @@ private:
     uint8_t* jmp_inst;
     uint8_t* jmp_end;
 
+    bool unconditional;
+
 public:
     ForwardJumpBase(Assembler& assembler, ConditionCode condition);
+    // Emits an unconditional jump.
+    explicit ForwardJumpBase(Assembler& assembler);
     ~ForwardJumpBase();
 };
 
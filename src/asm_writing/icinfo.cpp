@@ -36,6 +36,61 @@ using namespace pyston::assembler;
 
 #define MAX_RETRY_BACKOFF 1024
 
+// IC slots only get patched while holding the GIL.  No other thread executes IC code then (one that is inside of a slot
+// is blocked in a call out of it), so a plain copy is enough.
+// Where the slot allows it we still write its head with a single 8-byte store, after the rest of the slot: that is best
+// effort only.  The store is atomic as a data store, but the cross-modifying-code rules of x86 don't promise that
+// another core fetching these instructions sees either the old or the new bytes, that needs it to serialize (e.g. the
+// int3 protocol of Linux's text_poke_bp()).  Don't rely on this for patching without the GIL.
+#define IC_ATOMIC_PATCH_SIZE 8
+static_assert(IC_INVALDITION_HEADER_SIZE <= IC_ATOMIC_PATCH_SIZE, "the invalidation header has to fit in one store");
+
+// Whether the first IC_ATOMIC_PATCH_SIZE bytes of the slot can be written with one store which doesn't cross a cache
+// line.
+static bool canPatchAtomically(uint8_t* addr, int size) {
+    return size >= IC_ATOMIC_PATCH_SIZE && ((uintptr_t)addr & 63) <= 64 - IC_ATOMIC_PATCH_SIZE;
+}
+
+static void patchAtomically(uint8_t* addr, const uint8_t* new_bytes) {
+    uint64_t val;
+    memcpy(&val, new_bytes, IC_ATOMIC_PATCH_SIZE);
+    __atomic_store_n((uint64_t*)addr, val, __ATOMIC_RELEASE);
+}
+
+// Writes the invalidation header (a jump to the end of the slot) to the start of a slot.
+static void writeInvalidationHeader(uint8_t* start, int size) {
+    if (!canPatchAtomically(start, size)) {
+        Assembler writer(start, size);
+        writer.nop();
+        writer.jmp(JumpDestination::fromStart(size));
+        assert(writer.bytesWritten() <= IC_INVALDITION_HEADER_SIZE);
+        return;
+    }
+
+    uint8_t header[IC_ATOMIC_PATCH_SIZE];
+    Assembler writer(header, IC_ATOMIC_PATCH_SIZE);
+    writer.nop();
+    writer.jmp(JumpDestination::fromStart(size));
+    int written = writer.bytesWritten();
+    assert(written <= IC_INVALDITION_HEADER_SIZE);
+    // Keep whatever comes after the jump, in case a thread is just about to execute it:
+    memcpy(header + written, start + written, IC_ATOMIC_PATCH_SIZE - written);
+    patchAtomically(start, header);
+}
+
+// Copies new code into a slot: we first make the slot jump over itself, then write everything but the first bytes, and
+// then write those with a single store (best effort, see IC_ATOMIC_PATCH_SIZE).
+static void publishSlotCode(uint8_t* slot_start, int size, const uint8_t* code) {
+    if (!canPatchAtomically(slot_start, size)) {
+        memcpy(slot_start, code, size);
+        return;
+    }
+
+    writeInvalidationHeader(slot_start, size);
+    memcpy(slot_start + IC_ATOMIC_PATCH_SIZE, code + IC_ATOMIC_PATCH_SIZE, size - IC_ATOMIC_PATCH_SIZE);
+    patchAtomically(slot_start, code);
+}
+
 int64_t ICInvalidator::version() {
     return cur_version;
 }
@@ -183,8 +238,6 @@ void ICSlotRewrite::commit(CommitHook* hook, std::vector<void*> gc_references,
         assert(original_size == assembler.bytesWritten());
     }
 
-    ic->next_slot_to_try++;
-
     // we can create a new IC slot if this is the last slot in the IC in addition we are checking that the new slot is
     // at least as big as the current one.
     bool should_create_new_slot = variable_size_slots && &ic->slots.back() == ic_entry && empty_space >= actual_size;
@@ -215,13 +268,19 @@ void ICSlotRewrite::commit(CommitHook* hook, std::vector<void*> gc_references,
     }
 
     // if (VERBOSITY()) printf("Committing to %p-%p\n", start, start + ic->slot_size);
-    memcpy(slot_start, buf, original_size);
+    publishSlotCode(slot_start, original_size, buf);
 
     ic_entry->clear(false /* don't invalidate */);
 
     ic_entry->gc_references = std::move(gc_references);
     ic_entry->used = true;
-    ic->times_rewritten++;
+    ic_entry->num_hits = 0;
+    // Re-adding a type that maybeReorderSlots() just evicted doesn't make this IC any more megamorphic:
+    if (ic->reorder_refills)
+        ic->reorder_refills--;
+    else
+        ic->times_rewritten++;
+    ic->ageSlotHits();
 
     for (int i = 0; i < dependencies.size(); i++) {
         ICInvalidator* invalidator = dependencies[i].first;
@@ -249,6 +308,8 @@ void ICSlotRewrite::commit(CommitHook* hook, std::vector<void*> gc_references,
     }
 
     llvm::sys::Memory::InvalidateInstructionCache(slot_start, original_size);
+
+    ic->maybeReorderSlots();
 }
 
 void ICSlotRewrite::addDependenceOn(ICInvalidator& invalidator) {
@@ -293,46 +354,40 @@ std::unique_ptr<ICSlotRewrite> ICInfo::startRewrite(const char* debug_name) {
 }
 
 ICSlotInfo* ICInfo::pickEntryForRewrite(const char* debug_name) {
-    int num_slots = slots.size();
-    int fallback_to_in_use_slot = -1;
-
-    llvm::SmallVector<ICSlotInfo*, 8> slots_vec;
+    // we prefer to use the first unused slot, and if none is available we will fall back to evicting the in-use
+    // slot (which no one is inside) with the fewest hits.
+    ICSlotInfo* fallback_to_in_use_slot = NULL;
+    int i = 0;
     for (auto&& slot : slots) {
-        slots_vec.push_back(&slot);
-    }
-
-    // we prefer to use a unused slot and if non is available we will fallback to a slot which is in use (but no one is
-    // inside)
-    for (int _i = 0; _i < num_slots; _i++) {
-        int i = (_i + next_slot_to_try) % num_slots;
-
-        ICSlotInfo* sinfo = slots_vec[i];
+        ICSlotInfo* sinfo = &slot;
         assert(sinfo->num_inside >= 0);
+        i++;
 
         if (sinfo->num_inside || sinfo->size == 0)
             continue;
 
         if (sinfo->used) {
-            if (fallback_to_in_use_slot == -1)
-                fallback_to_in_use_slot = i;
+            if (!fallback_to_in_use_slot || sinfo->num_hits < fallback_to_in_use_slot->num_hits)
+                fallback_to_in_use_slot = sinfo;
             continue;
         }
 
         if (VERBOSITY() >= 4) {
-            printf("picking %s icentry to in-use slot %d at %p\n", debug_name, i, start_addr);
+            printf("picking %s icentry to unused slot %d at %p\n", debug_name, i - 1, start_addr);
         }
 
-        next_slot_to_try = i;
         return sinfo;
     }
 
-    if (fallback_to_in_use_slot != -1) {
+    if (fallback_to_in_use_slot) {
         if (VERBOSITY() >= 4) {
-            printf("picking %s icentry to in-use slot %d at %p\n", debug_name, fallback_to_in_use_slot, start_addr);
+            printf("picking %s icentry to in-use slot with %ld hits at %p\n", debug_name,
+                   fallback_to_in_use_slot->num_hits, start_addr);
         }
 
-        next_slot_to_try = fallback_to_in_use_slot;
-        return slots_vec[fallback_to_in_use_slot];
+        static StatCounter ic_slot_evictions("ic_slot_evictions");
+        ic_slot_evictions.log();
+        return fallback_to_in_use_slot;
     }
 
     if (VERBOSITY() >= 4)
@@ -340,20 +395,67 @@ ICSlotInfo* ICInfo::pickEntryForRewrite(const char* debug_name) {
     return NULL;
 }
 
+void ICInfo::ageSlotHits() {
+    for (auto&& slot : slots)
+        slot.num_hits /= 2;
+}
+
+// A slot has to have been hit at least this many times (since aging) before we move it to the front:
+#define IC_REORDER_MIN_HITS 256
+// and it has to have been hit this many times more than the slot in front of it:
+#define IC_REORDER_MIN_RATIO 8
+
+void ICInfo::maybeReorderSlots() {
+    // We can't move the code of a slot around, since it's not position independent.  Instead, if a hot slot sits
+    // behind a much colder one in the guard chain, we clear both: the hot type will most likely be the next one
+    // to miss, and then gets rewritten into the front slot since we fill free slots in order.
+    // The two rewrites which re-add the evicted types don't count towards IC_MEGAMORPHIC_THRESHOLD.
+    ICSlotInfo* hottest = NULL;
+    for (auto&& slot : slots) {
+        if (slot.used && (!hottest || slot.num_hits > hottest->num_hits))
+            hottest = &slot;
+    }
+
+    if (!hottest || hottest->num_hits < IC_REORDER_MIN_HITS || hottest->num_inside || reorder_refills)
+        return;
+
+    for (auto&& slot : slots) {
+        if (&slot == hottest)
+            return;
+
+        if (!slot.used || slot.num_inside || slot.size < hottest->size)
+            continue;
+
+        if (slot.num_hits * IC_REORDER_MIN_RATIO > hottest->num_hits)
+            continue;
+
+        if (VERBOSITY() >= 4)
+            printf("reordering ic slots at %p\n", start_addr);
+
+        static StatCounter ic_slot_reorders("ic_slot_reorders");
+        ic_slot_reorders.log();
+
+        slot.clear();
+        hottest->clear();
+        reorder_refills = 2;
+        return;
+    }
+}
+
 static llvm::DenseMap<void*, ICInfo*> ics_by_return_addr;
 static llvm::DenseMap<BST_stmt*, ICInfo*> ics_by_ast_node;
 
 ICInfo::ICInfo(void* start_addr, void* slowpath_rtn_addr, void* continue_addr, StackInfo stack_info, int size,
                llvm::CallingConv::ID calling_conv, LiveOutSet _live_outs, assembler::GenericRegister return_register,
                std::vector<Location> ic_global_decref_locations, assembler::RegisterSet allocatable_registers)
-    : next_slot_to_try(0),
-      stack_info(stack_info),
+    : stack_info(stack_info),
       calling_conv(calling_conv),
       live_outs(std::move(_live_outs)),
       return_register(return_register),
       retry_in(0),
       retry_backoff(1),
       times_rewritten(0),
+      reorder_refills(0),
       allocatable_registers(allocatable_registers),
       ic_global_decref_locations(std::move(ic_global_decref_locations)),
       node(NULL),
@@ -444,10 +546,7 @@ void ICInfo::invalidate(ICSlotInfo* icentry) {
     if (VERBOSITY() >= 4)
         printf("clearing patchpoint %p, slot at %p\n", start_addr, start);
 
-    Assembler writer(start, icentry->size);
-    writer.nop();
-    writer.jmp(JumpDestination::fromStart(icentry->size));
-    assert(writer.bytesWritten() <= IC_INVALDITION_HEADER_SIZE);
+    writeInvalidationHeader(start, icentry->size);
 
     // std::unique_ptr<MCWriter> writer(createMCWriter(start, getSlotSize(), 0));
     // writer->emitNop();
@@ -457,15 +556,6 @@ void ICInfo::invalidate(ICSlotInfo* icentry) {
 
     llvm::sys::Memory::InvalidateInstructionCache(start, icentry->size);
 
-    int i = 0;
-    for (auto&& slot : slots) {
-        if (&slot == icentry) {
-            next_slot_to_try = i;
-            break;
-        }
-        ++i;
-    }
-
     icentry->used = false;
 }
 
@@ -59,7 +59,7 @@ struct DecrefInfo {
 struct ICSlotInfo {
 public:
     ICSlotInfo(ICInfo* ic, uint8_t* addr, int size)
-        : ic(ic), start_addr(addr), num_inside(0), size(size), used(false) {}
+        : ic(ic), start_addr(addr), num_inside(0), size(size), used(false), num_hits(0) {}
 
     ICInfo* ic;
     uint8_t* start_addr;
@@ -73,6 +73,10 @@ public:
     int size;
     bool used; // if this slot is empty or got invalidated
 
+    // Incremented by the slot's code every time its guards pass, and halved every time the IC gets rewritten,
+    // so it approximates how recently and how heavily this slot got used.
+    int64_t num_hits;
+
     void clear(bool should_invalidate = true);
 };
 
@@ -81,13 +85,9 @@ typedef BitSet<16> LiveOutSet;
 class ICSlotRewrite;
 class ICInfo {
 private:
+    // Slots get tried in order, so we fill the free slots front to back and, once all of them are taken,
+    // evict the one with the fewest (aged) hits.
     std::list<ICSlotInfo> slots;
-    // For now, just use a round-robin eviction policy.
-    // This is probably a bunch worse than LRU, but it's also
-    // probably a bunch better than the "always evict slot #0" policy
-    // that it's replacing.
-    // TODO: experiment with different IC eviction strategies.
-    int next_slot_to_try;
 
     const StackInfo stack_info;
     const llvm::CallingConv::ID calling_conv;
@@ -96,6 +96,7 @@ private:
     std::unique_ptr<TypeRecorder> type_recorder;
     int retry_in, retry_backoff;
     int times_rewritten;
+    int reorder_refills; // number of upcoming rewrites which just re-add the types evicted by maybeReorderSlots()
     assembler::RegisterSet allocatable_registers;
 
     DecrefInfo slowpath_decref_info;
@@ -109,6 +110,8 @@ private:
 
     // for ICSlotRewrite:
     ICSlotInfo* pickEntryForRewrite(const char* debug_name);
+    void ageSlotHits();
+    void maybeReorderSlots();
 
 public:
     ICInfo(void* start_addr, void* slowpath_rtn_addr, void* continue_addr, StackInfo stack_info, int size,
@@ -13,6 +13,7 @@
 
 #include "asm_writing/rewriter.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "asm_writing/icinfo.h"
@@ -527,10 +528,12 @@ void RewriterVar::incref() {
 
 void RewriterVar::decref() {
     rewriter->addAction([=]() { rewriter->_decref(this, { this }); }, { this }, ActionType::MUTATION);
+    rewriter->markLastActionAsCall();
 }
 
 void RewriterVar::xdecref() {
     rewriter->addAction([=]() { rewriter->_xdecref(this, { this }); }, { this }, ActionType::MUTATION);
+    rewriter->markLastActionAsCall();
 }
 
 void Rewriter::_incref(RewriterVar* var, int num_refs) {
@@ -558,6 +561,12 @@ void Rewriter::_incref(RewriterVar* var, int num_refs) {
         assembler->incq(assembler::Immediate(&_Py_RefTotal));
 #endif
 
+#ifdef Py_IMMORTAL_OBJECTS
+    // Objects don't become mortal again, so we don't have to emit anything for immortal constants:
+    if (var->isConstant() && _Py_IsImmortal((Box*)var->constant_value))
+        return;
+#endif
+
     if (var->isConstant() && !Rewriter::isLargeConstant(var->constant_value)) {
         for (int i = 0; i < num_refs; i++) {
             assembler->incq(assembler::Immediate((uint64_t)var->constant_value + offsetof(Box, ob_refcnt)));
@@ -565,6 +574,11 @@ void Rewriter::_incref(RewriterVar* var, int num_refs) {
     } else {
         auto reg = var->getInReg();
 
+#ifdef Py_IMMORTAL_OBJECTS
+        // Immortal objects have a nonzero upper half of the refcount.
+        assembler->cmpl(assembler::Indirect(reg, offsetof(Box, ob_refcnt) + 4), assembler::Immediate(0));
+        assembler::ForwardJump jne(*assembler, assembler::COND_NOT_EQUAL);
+#endif
         if (num_refs == 1)
             assembler->incq(assembler::Indirect(reg, offsetof(Box, ob_refcnt)));
         else
@@ -581,6 +595,15 @@ void Rewriter::_decref(RewriterVar* var, llvm::ArrayRef<RewriterVar*> vars_to_bu
 
 // this->_call(NULL, true, false /* can't throw */, (void*)Helper::decref, { var }, {}, vars_to_bump);
 
+#ifdef Py_IMMORTAL_OBJECTS
+    if (var->isConstant() && _Py_IsImmortal((Box*)var->constant_value)) {
+        for (auto&& use : vars_to_bump) {
+            use->bumpUseLateIfNecessary();
+        }
+        return;
+    }
+#endif
+
 #ifdef Py_REF_DEBUG
     // assembler->trap();
     assembler->decq(assembler::Immediate(&_Py_RefTotal));
@@ -596,8 +619,13 @@ void Rewriter::_decref(RewriterVar* var, llvm::ArrayRef<RewriterVar*> vars_to_bu
     auto reg = assembler::RDI;
     // auto reg = var->getInReg();
 
-    assembler->decq(assembler::Indirect(reg, offsetof(Box, ob_refcnt)));
     {
+#ifdef Py_IMMORTAL_OBJECTS
+        // Immortal objects have a nonzero upper half of the refcount.
+        assembler->cmpl(assembler::Indirect(reg, offsetof(Box, ob_refcnt) + 4), assembler::Immediate(0));
+        assembler::ForwardJump jne(*assembler, assembler::COND_NOT_EQUAL);
+#endif
+        assembler->decq(assembler::Indirect(reg, offsetof(Box, ob_refcnt)));
         assembler::ForwardJump jnz(*assembler, assembler::COND_NOT_ZERO);
 #ifdef Py_TRACE_REFS
         _callOptimalEncoding(assembler::R11, (void*)_Py_Dealloc);
@@ -851,7 +879,8 @@ assembler::Register RewriterVar::getInReg(Location dest, bool allow_constant_in_
     assert(locations.size() == 1);
     Location l(*locations.begin());
 
-    assembler::Register reg = rewriter->allocReg(dest, otherThan);
+    assembler::Register reg = dest.type == Location::AnyReg ? rewriter->allocRegFor(this, otherThan)
+                                                            : rewriter->allocReg(dest, otherThan);
     if (rewriter->failed)
         return reg;
 
@@ -1016,6 +1045,7 @@ RewriterVar* Rewriter::call(bool has_side_effects, void* func_addr, llvm::ArrayR
         this->_call(result, lambda_closure.has_side_effects, lambda_closure.can_throw, func_addr, lambda_closure.args(),
                     lambda_closure.argsXmm(), lambda_closure.allArgs());
     }, lambda_closure.allArgs(), type);
+    markLastActionAsCall();
 
     return result;
 }
@@ -1496,6 +1526,26 @@ void Rewriter::commit() {
         assertConsistent();
     };
 
+    // Once the guards passed we know that this slot is getting used; count that so that the ICInfo can
+    // tell the hot slots from the cold ones when it has to evict one.  The baseline JIT doesn't have
+    // separate slots, so skip it there.
+    auto emit_slot_hit_counter = [&]() {
+        if (!needs_invalidation_support)
+            return;
+
+        if (LOG_IC_ASSEMBLY)
+            assembler->comment("slot hit counter");
+
+        uintptr_t counter_addr = (uintptr_t)(&picked_slot->num_hits);
+        if (isLargeConstant(counter_addr)) {
+            assembler::Register reg = allocReg(Location::any(), getReturnDestination());
+            const_loader.loadConstIntoReg(counter_addr, reg);
+            assembler->incq(assembler::Indirect(reg, 0));
+        } else {
+            assembler->incq(assembler::Immediate(counter_addr));
+        }
+    };
+
     if (last_guard_action == -1) {
         on_done_guarding();
     }
@@ -1506,6 +1556,9 @@ void Rewriter::commit() {
         return;
     }
 
+    if (last_guard_action == -1)
+        emit_slot_hit_counter();
+
     // Now, start emitting assembly; check if we're dong guarding after each.
     for (int i = 0; i < actions.size(); i++) {
         // add increfs if required
@@ -1535,6 +1588,7 @@ void Rewriter::commit() {
         assertConsistent();
         if (i == last_guard_action) {
             on_done_guarding();
+            emit_slot_hit_counter();
         }
     }
 
@@ -1935,6 +1989,7 @@ void Rewriter::checkAndThrowCAPIException(RewriterVar* r, int64_t exc_val, assem
     STAT_TIMER(t0, "us_timer_rewriter", 10);
 
     addAction([=]() { this->_checkAndThrowCAPIException(r, exc_val, type); }, { r }, ActionType::MUTATION);
+    markLastActionAsCall();
 }
 
 void Rewriter::_checkAndThrowCAPIException(RewriterVar* r, int64_t exc_val, assembler::MovType type) {
@@ -2082,6 +2137,35 @@ assembler::Register Rewriter::allocReg(Location dest, Location otherThan, assemb
     }
 }
 
+bool Rewriter::isLiveAcrossCall(RewriterVar* var) {
+    assertPhaseEmitting();
+
+    if (var->uses.empty())
+        return false;
+
+    auto next_call = std::upper_bound(call_actions.begin(), call_actions.end(), current_action_idx);
+    return next_call != call_actions.end() && var->uses.back() > *next_call;
+}
+
+assembler::Register Rewriter::allocRegFor(RewriterVar* var, Location otherThan) {
+    assertPhaseEmitting();
+
+    // This is the linear-scan idea applied at the point of definition: we know all the future uses of var and of
+    // which actions emit calls.  A value that has to survive a call goes straight into a callee-save register, so
+    // _setupCall doesn't have to move it out of the way (or into the scratch area) later; a short-lived one takes a
+    // caller-save register so it doesn't block the callee-save ones.
+    // Only the baseline jit hands out callee-save registers, so for the other ICs this is the same as allocReg().
+    auto callee_save_regs = allocatable_regs & assembler::RegisterSet::getCalleeSave();
+    auto preferred_regs = isLiveAcrossCall(var) ? callee_save_regs
+                                                : allocatable_regs & assembler::RegisterSet::stdAllocatable();
+    for (assembler::Register reg : preferred_regs) {
+        if (Location(reg) != otherThan && vars_by_location.count(reg) == 0)
+            return reg;
+    }
+
+    return allocReg(Location::any(), otherThan);
+}
+
 assembler::XMMRegister Rewriter::allocXMMReg(Location dest, Location otherThan) {
     assertPhaseEmitting();
 
@@ -2174,7 +2258,7 @@ assembler::Register RewriterVar::initializeInReg(Location l) {
         l = Location::any();
     }
 
-    assembler::Register reg = rewriter->allocReg(l);
+    assembler::Register reg = l.type == Location::AnyReg ? rewriter->allocRegFor(this) : rewriter->allocReg(l);
     l = Location(reg);
 
     // Add this to vars_by_locations
@@ -499,6 +499,14 @@ protected:
         return &actions.back();
     }
 
+    // Indices of the actions which emit a call (and so make _setupCall spill the caller-save registers), in order.
+    // This is the liveness information allocRegFor() uses to decide which values should live in callee-save registers.
+    llvm::SmallVector<int, 16> call_actions;
+    void markLastActionAsCall() {
+        if (!failed)
+            call_actions.push_back((int)actions.size() - 1);
+    }
+
     bool added_changing_action;
     bool marked_inside_ic;
     std::vector<void*> gc_references;
@@ -526,6 +534,11 @@ protected:
     assembler::Register allocReg(Location dest, Location otherThan = Location::any());
     assembler::Register allocReg(Location dest, Location otherThan, assembler::RegisterSet valid_registers);
     assembler::XMMRegister allocXMMReg(Location dest, Location otherThan = Location::any());
+    // Allocates any register for holding var: a free callee-save one if var is still needed after the next call,
+    // otherwise preferably a caller-save one.  Falls back to allocReg() if none of the preferred ones are free.
+    assembler::Register allocRegFor(RewriterVar* var, Location otherThan = Location::any());
+    // Whether var has a use after the next action which emits a call.
+    bool isLiveAcrossCall(RewriterVar* var);
     // Allocates an 8-byte region in the scratch space
     Location allocScratch();
     assembler::Indirect indirectFor(Location l);
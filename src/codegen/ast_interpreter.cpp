@@ -22,12 +22,14 @@
 #include "analysis/scoping_analysis.h"
 #include "codegen/baseline_jit.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/irgen.h"
 #include "codegen/irgen/hooks.h"
 #include "codegen/irgen/irgenerator.h"
 #include "codegen/irgen/util.h"
 #include "codegen/osrentry.h"
+#include "codegen/profile_cache.h"
 #include "core/bst.h"
 #include "core/cfg.h"
 #include "core/common.h"
@@ -39,6 +41,7 @@
 #include "runtime/import.h"
 #include "runtime/inline/boxing.h"
 #include "runtime/inline/list.h"
+#include "runtime/int.h"
 #include "runtime/long.h"
 #include "runtime/objmodel.h"
 #include "runtime/set.h"
@@ -55,6 +58,10 @@ namespace pyston {
 
 namespace {
 
+// Dispatch between the statements of a block which we don't baseline-JIT with computed gotos instead of going
+// through the switch in visit_stmt() for every statement.  Relies on the "labels as values" extension of GCC and clang.
+#define THREADED_INTERPRETER_DISPATCH 1
+
 class ASTInterpreter;
 extern "C" Box* executeInnerAndSetupFrame(ASTInterpreter& interpreter, CFGBlock* start_block, BST_stmt* start_at);
 
@@ -63,6 +70,7 @@ extern "C" Box* executeInnerAndSetupFrame(ASTInterpreter& interpreter, CFGBlock*
  * all non-jitted code!
  *
  * All ASTInterpreter instances have to live on the stack because otherwise the GC won't scan the fields.
+ * The exception are the interpreters of stackless generators, which the generator owns and traverses.
  */
 class ASTInterpreter {
 public:
@@ -74,7 +82,11 @@ public:
     static Box* executeInner(ASTInterpreter& interpreter, CFGBlock* start_block, BST_stmt* start_at);
 
 private:
+    static void executeBlockFrom(ASTInterpreter& interpreter, BST_stmt* start_at, Value& v);
     Value executeStmt(BST_stmt* node);
+#if THREADED_INTERPRETER_DISPATCH
+    Value executeBlockThreaded(BST_stmt* node);
+#endif
 
     Value createFunction(BST_MakeFunction* node, BoxedCode* node_code);
     Value doBinOp(BST_stmt* node, Value left, Value right, int op, BinExpType exp_type);
@@ -85,6 +97,9 @@ private:
 
     Value getVReg(int vreg, bool kill = true);
 
+    InterpreterAttrCache& getAttrCache(BST_LoadAttr* node);
+    Box* getattrQuickened(BST_LoadAttr* node, Box* obj, BoxedString* attr);
+
     Value visit_augBinOp(BST_AugBinOp* node);
     Value visit_binop(BST_BinOp* node);
     Value visit_call(BST_Call* node);
@@ -116,6 +131,8 @@ private:
     Value visit_tuple(BST_Tuple* node);
     Value visit_unaryop(BST_UnaryOp* node);
     Value visit_yield(BST_Yield* node);
+    Value yieldStackless(BST_Yield* node);
+    void suspendStackless(BST_Yield* node, STOLEN(Box*) value);
     void visit_assert(BST_Assert* node);
     void visit_branch(BST_Branch* node);
     void visit_deleteattr(BST_DeleteAttr* node);
@@ -159,9 +176,20 @@ private:
     std::unique_ptr<JitFragmentWriter> jit;
     bool should_jit;
 
+    // Set for the interpreter of a stackless generator, which can't do OSR until it moves to a generator stack of its
+    // own (see leaveStacklessMode()):
+    bool stackless;
+    // The yield at which the stackless generator is suspended, or NULL if it is running.
+    BST_Yield* suspended_at;
+    // Set if the stackless generator got suspended because a loop got hot; it continues at this block once it moved
+    // to a stack of its own.
+    CFGBlock* leave_stackless_at;
+
 public:
     ~ASTInterpreter() { Py_XDECREF(this->created_closure); }
 
+    bool isSuspended() const { return suspended_at || leave_stackless_at; }
+
     const VRegInfo& getVRegInfo() const { return source_info->cfg->getVRegInfo(); }
 
 #ifndef NDEBUG
@@ -192,6 +220,8 @@ public:
     void setGlobals(Box* globals);
 
     friend struct pyston::ASTInterpreterJitInterface;
+    friend bool pyston::resumeStacklessGenerator(BoxedGenerator* generator);
+    friend bool pyston::leaveStacklessMode(BoxedGenerator* generator);
 };
 
 void ASTInterpreter::addSymbol(int vreg, Box* new_value, bool allow_duplicates) {
@@ -245,7 +275,10 @@ ASTInterpreter::ASTInterpreter(BoxedCode* code, Box** vregs, FrameInfo* deopt_fr
       created_closure(0),
       generator(0),
       parent_module(source_info->parent_module),
-      should_jit(false) {
+      should_jit(false),
+      stackless(false),
+      suspended_at(NULL),
+      leave_stackless_at(NULL) {
 
     if (deopt_frame_info) {
         // copy over all fields and clear the deopt frame info
@@ -306,6 +339,9 @@ void ASTInterpreter::startJITing(CFGBlock* block, int exit_offset, llvm::DenseSe
         code_block = code_blocks[code_blocks.size() - 1].get();
 
     if (!code_block || code_block->shouldCreateNewBlock()) {
+        if (unlikely(ENABLE_PROFILE_CACHE) && code_blocks.empty())
+            profileCacheNoteTierUp(getCode());
+
         code_blocks.push_back(llvm::make_unique<JitCodeBlock>(getCode(), getCode()->name->s()));
         code_block = code_blocks[code_blocks.size() - 1].get();
         exit_offset = 0;
@@ -394,18 +430,7 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
 
     if (!from_start) {
         interpreter.current_block = start_block;
-        bool started = false;
-        for (auto s : *start_block) {
-            if (!started) {
-                if (s != start_at)
-                    continue;
-                started = true;
-            }
-
-            interpreter.setCurrentStatement(s);
-            Py_XDECREF(v.o);
-            v = interpreter.executeStmt(s);
-        }
+        executeBlockFrom(interpreter, start_at, v);
     } else {
         interpreter.next_block = start_block;
     }
@@ -428,6 +453,14 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
                 if (unlikely(rtn == (Box*)ASTInterpreterJitInterface::osr_dummy_value)) {
                     BST_Jump* cur_stmt = (BST_Jump*)interpreter.getCurrentStatement();
                     RELEASE_ASSERT(cur_stmt->type() == BST_TYPE::Jump, "");
+
+                    // A stackless generator has to move to a stack of its own first (see visit_jump()):
+                    if (interpreter.stackless) {
+                        Py_CLEAR(v.o);
+                        interpreter.leave_stackless_at = cur_stmt->target;
+                        return NULL;
+                    }
+
                     // WARNING: do not put a try catch + rethrow block around this code here.
                     //          it will confuse our unwinder!
                     rtn = interpreter.doOSR(cur_stmt);
@@ -437,6 +470,14 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
                     if (rtn)
                         return rtn;
                     // if we get here OSR failed, fallthrough to the interpreter loop
+                } else if (unlikely(rtn == (Box*)ASTInterpreterJitInterface::stackless_yield_dummy_value)) {
+                    // The JITed code left at a yield (see yieldFromJITHelper()).  Either the stackless generator got
+                    // suspended, or we continue after the yield in the interpreter:
+                    Py_CLEAR(v.o);
+                    if (interpreter.stackless)
+                        return NULL;
+                    executeBlockFrom(interpreter, interpreter.suspended_at, v);
+                    continue;
                 } else {
                     Py_XDECREF(v.o);
                     return rtn;
@@ -449,6 +490,14 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
             interpreter.startJITing(interpreter.current_block);
         }
 
+#if THREADED_INTERPRETER_DISPATCH
+        if (!interpreter.jit) {
+            Py_XDECREF(v.o);
+            v = interpreter.executeBlockThreaded(interpreter.current_block->body());
+            continue;
+        }
+#endif
+
         for (BST_stmt* s : *interpreter.current_block) {
             interpreter.setCurrentStatement(s);
             if (interpreter.jit)
@@ -457,11 +506,31 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
                 Py_DECREF(v.o);
             }
             v = interpreter.executeStmt(s);
+            if (unlikely(interpreter.suspended_at))
+                break;
         }
     }
     return v.o;
 }
 
+// Executes the rest of the current block, starting at the given statement.
+void ASTInterpreter::executeBlockFrom(ASTInterpreter& interpreter, BST_stmt* start_at, Value& v) {
+    bool started = false;
+    for (auto s : *interpreter.current_block) {
+        if (!started) {
+            if (s != start_at)
+                continue;
+            started = true;
+        }
+
+        interpreter.setCurrentStatement(s);
+        Py_XDECREF(v.o);
+        v = interpreter.executeStmt(s);
+        if (unlikely(interpreter.suspended_at))
+            break;
+    }
+}
+
 Box* ASTInterpreter::execute(ASTInterpreter& interpreter, CFGBlock* start_block, BST_stmt* start_at) {
     UNAVOIDABLE_STAT_TIMER(t0, "us_timer_in_interpreter");
     RECURSIVE_BLOCK(CXX, " in function call");
@@ -470,13 +539,17 @@ Box* ASTInterpreter::execute(ASTInterpreter& interpreter, CFGBlock* start_block,
 }
 
 Value ASTInterpreter::doBinOp(BST_stmt* node, Value left, Value right, int op, BinExpType exp_type) {
+    // Lets the bjit emit inline code if the operands are ints or floats.
+    BoxedClass* operand_cls = left.o->cls == right.o->cls ? left.o->cls : NULL;
     switch (exp_type) {
         case BinExpType::AugBinOp:
-            return Value(augbinop(left.o, right.o, op), jit ? jit->emitAugbinop(node, left, right, op) : NULL);
+            return Value(augbinop(left.o, right.o, op),
+                         jit ? jit->emitAugbinop(node, left, right, op, operand_cls) : NULL);
         case BinExpType::BinOp:
-            return Value(binop(left.o, right.o, op), jit ? jit->emitBinop(node, left, right, op) : NULL);
+            return Value(binop(left.o, right.o, op), jit ? jit->emitBinop(node, left, right, op, operand_cls) : NULL);
         case BinExpType::Compare:
-            return Value(compare(left.o, right.o, op), jit ? jit->emitCompare(node, left, right, op) : NULL);
+            return Value(compare(left.o, right.o, op),
+                         jit ? jit->emitCompare(node, left, right, op, operand_cls) : NULL);
         default:
             RELEASE_ASSERT(0, "not implemented");
     }
@@ -564,12 +637,66 @@ void ASTInterpreter::visit_unpackintoarray(BST_UnpackIntoArray* node) {
     }
 }
 
+static bool canQuickenIntBinop(int op) {
+    switch (op) {
+        case AST_TYPE::Add:
+        case AST_TYPE::Sub:
+        case AST_TYPE::Mult:
+        case AST_TYPE::BitAnd:
+        case AST_TYPE::BitOr:
+        case AST_TYPE::BitXor:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Does the same as binop() for two ints, for the operations for which canQuickenIntBinop() returns true.
+static Box* quickenedIntBinop(int op, BoxedInt* lhs, BoxedInt* rhs) {
+    switch (op) {
+        case AST_TYPE::Add:
+            return add_i64_i64(lhs->n, rhs->n);
+        case AST_TYPE::Sub:
+            return sub_i64_i64(lhs->n, rhs->n);
+        case AST_TYPE::Mult:
+            return mul_i64_i64(lhs->n, rhs->n);
+        case AST_TYPE::BitAnd:
+            return boxInt(lhs->n & rhs->n);
+        case AST_TYPE::BitOr:
+            return boxInt(lhs->n | rhs->n);
+        case AST_TYPE::BitXor:
+            return boxInt(lhs->n ^ rhs->n);
+        default:
+            RELEASE_ASSERT(0, "%d", op);
+    }
+}
+
 Value ASTInterpreter::visit_binop(BST_BinOp* node) {
     Value left = getVReg(node->vreg_left);
     AUTO_DECREF(left.o);
     Value right = getVReg(node->vreg_right);
     AUTO_DECREF(right.o);
-    return doBinOp(node, left, right, node->op_type, BinExpType::BinOp);
+
+    // A BinOp which saw two ints gets quickened: as long as it keeps seeing ints we do the operation inline instead
+    // of going through the generic binop().  Any other operands send it back to the generic version.
+    if (node->is_quickened()) {
+        if (likely(!jit && left.o->cls == int_cls && right.o->cls == int_cls)) {
+            return Value(quickenedIntBinop(node->op_type, (BoxedInt*)left.o, (BoxedInt*)right.o), NULL);
+        }
+
+        static StatCounter num_interp_dequickened("num_interp_dequickened");
+        num_interp_dequickened.log();
+        node->set_quickened(false);
+    }
+
+    Value rtn = doBinOp(node, left, right, node->op_type, BinExpType::BinOp);
+
+    if (!jit && left.o->cls == int_cls && right.o->cls == int_cls && canQuickenIntBinop(node->op_type)) {
+        static StatCounter num_interp_quickened("num_interp_quickened");
+        num_interp_quickened.log();
+        node->set_quickened(true);
+    }
+    return rtn;
 }
 
 Value ASTInterpreter::visit_makeslice(BST_MakeSlice* node) {
@@ -621,11 +748,16 @@ Value ASTInterpreter::visit_jump(BST_Jump* node) {
             jit->call(false, (void*)threading::allowGLReadPreemption);
     }
 
+    // We can't OSR out of the frame of a stackless generator, its caller expects us to come back at the next yield.  A
+    // yield resets the count to OSR_THRESHOLD_INTERPRETER at most, so a loop which runs long without yielding suspends
+    // instead and continues on a generator stack of its own, where it can do the OSR:
+    bool leave_stackless = unlikely(stackless) && backedge && edgecount + 1 >= OSR_THRESHOLD_BASELINE;
+
     if (jit) {
         if (backedge && ENABLE_OSR && !FORCE_INTERPRETER)
             jit->emitOSRPoint(node);
         jit->emitJump(node->target);
-        finishJITing(node->target);
+        finishJITing(leave_stackless ? NULL : node->target);
 
         // we may have started JITing because the OSR thresholds got triggered in this case we don't want to jit
         // additional blocks ouside of the loop if the function is cold.
@@ -636,6 +768,11 @@ Value ASTInterpreter::visit_jump(BST_Jump* node) {
     if (backedge)
         ++edgecount;
 
+    if (leave_stackless) {
+        leave_stackless_at = node->target;
+        return Value();
+    }
+
     if (ENABLE_BASELINEJIT && backedge && edgecount >= OSR_THRESHOLD_INTERPRETER && !jit && !node->target->code) {
         should_jit = true;
         startJITing(node->target);
@@ -656,6 +793,12 @@ Box* ASTInterpreter::doOSR(BST_Jump* node) {
     if (!can_osr)
         return NULL;
 
+    // There is already an OSR compile for this loop running in the background; keep going in the baseline JIT.
+    if (ENABLE_BACKGROUND_COMPILATION && isBackgroundCompilePending(getCode(), node)) {
+        edgecount = 0;
+        return NULL;
+    }
+
     static StatCounter ast_osrs("num_ast_osrs");
     ast_osrs.log();
 
@@ -735,6 +878,14 @@ Box* ASTInterpreter::doOSR(BST_Jump* node) {
 
         entry->potentially_undefined = potentially_undefined;
 
+        if (ENABLE_BACKGROUND_COMPILATION && enqueueBackgroundOSRCompile(getCode(), entry)) {
+            for (auto&& p : sorted_symbol_table) {
+                Py_DECREF(p.second);
+            }
+            edgecount = 0;
+            return NULL;
+        }
+
         found_entry = entry;
     }
 
@@ -773,6 +924,8 @@ Value ASTInterpreter::executeStmt(BST_stmt* node) {
     Value v;
     try {
         v = visit_stmt(node);
+        if (unlikely(suspended_at))
+            return v;
         next_block = node->get_normal_block();
 
         if (jit) {
@@ -795,6 +948,139 @@ Value ASTInterpreter::executeStmt(BST_stmt* node) {
     return v;
 }
 
+#if THREADED_INTERPRETER_DISPATCH
+// Executes the statements of the current block starting with 'node', while we are not baseline-JITing it, and returns
+// the value of its terminator.  Every handler jumps straight to the handler of the next statement, which gives the
+// branch predictor a separate indirect branch per opcode to learn from.  The handlers also know the concrete type of
+// the statement, so they can step to the next one without the switch inside BST_stmt::size_in_bytes().
+// This has to match what visit_stmt() does for the individual statements.
+Value ASTInterpreter::executeBlockThreaded(BST_stmt* node) {
+    // Indexed by type_and_flags; statements which have the invoke flag set go through executeStmt().
+    // Quickened statements use the same handlers, which check the flag themselves.
+    static void* dispatch_table[256];
+    if (unlikely(!dispatch_table[0])) {
+        for (int i = 0; i < 256; i++)
+            dispatch_table[i] = (i & BST_stmt::invoke_flag) ? &&invoke : &&unknown;
+#define SET_DISPATCH_TARGET(opcode, n)                                                                                 \
+    dispatch_table[BST_TYPE::opcode] = &&handle_##opcode;                                                              \
+    dispatch_table[BST_TYPE::opcode | BST_stmt::quickened_flag] = &&handle_##opcode;
+        FOREACH_TYPE(SET_DISPATCH_TARGET)
+#undef SET_DISPATCH_TARGET
+    }
+
+#if ENABLE_SAMPLING_PROFILER
+#define PREEMPTION_CHECK() threading::allowGLReadPreemption()
+#else
+#define PREEMPTION_CHECK()
+#endif
+
+#define DISPATCH()                                                                                                     \
+    do {                                                                                                               \
+        setCurrentStatement(node);                                                                                     \
+        PREEMPTION_CHECK();                                                                                            \
+        goto* dispatch_table[node->type_and_flags];                                                                    \
+    } while (0)
+
+// Only valid for statements which are not terminators:
+#define NEXT(opcode)                                                                                                   \
+    do {                                                                                                               \
+        node = (BST_stmt*)((unsigned char*)node + static_cast<BST_##opcode*>(node)->size_in_bytes());                 \
+        DISPATCH();                                                                                                    \
+    } while (0)
+
+#define HANDLE(opcode, visit)                                                                                          \
+    handle_##opcode : visit(static_cast<BST_##opcode*>(node));                                                        \
+    ASTInterpreterJitInterface::pendingCallsCheckHelper();                                                             \
+    NEXT(opcode);
+
+#define HANDLE_WITH_DEST(opcode, visit)                                                                                \
+    handle_##opcode : doStore(static_cast<BST_##opcode*>(node)->vreg_dst, visit(static_cast<BST_##opcode*>(node)));    \
+    ASTInterpreterJitInterface::pendingCallsCheckHelper();                                                             \
+    NEXT(opcode);
+
+    DISPATCH();
+
+    HANDLE(DeleteAttr, visit_deleteattr)
+    HANDLE(DeleteSub, visit_deletesub)
+    HANDLE(DeleteSubSlice, visit_deletesubslice)
+    HANDLE(DeleteName, visit_deletename)
+    HANDLE(Exec, visit_exec)
+    HANDLE(Print, visit_print)
+    HANDLE(StoreName, visit_storename)
+    HANDLE(StoreAttr, visit_storeattr)
+    HANDLE(StoreSub, visit_storesub)
+    HANDLE(StoreSubSlice, visit_storesubslice)
+    HANDLE(UnpackIntoArray, visit_unpackintoarray)
+    HANDLE(SetExcInfo, visit_setexcinfo)
+    HANDLE(UncacheExcInfo, visit_uncacheexcinfo)
+    HANDLE(PrintExpr, visit_printexpr)
+
+    HANDLE_WITH_DEST(CopyVReg, visit_copyvreg)
+    HANDLE_WITH_DEST(AugBinOp, visit_augBinOp)
+    HANDLE_WITH_DEST(CallFunc, visit_call)
+    HANDLE_WITH_DEST(CallAttr, visit_call)
+    HANDLE_WITH_DEST(CallClsAttr, visit_call)
+    HANDLE_WITH_DEST(Compare, visit_compare)
+    HANDLE_WITH_DEST(BinOp, visit_binop)
+    HANDLE_WITH_DEST(Dict, visit_dict)
+    HANDLE_WITH_DEST(List, visit_list)
+    HANDLE_WITH_DEST(Repr, visit_repr)
+    HANDLE_WITH_DEST(Set, visit_set)
+    HANDLE_WITH_DEST(Tuple, visit_tuple)
+    HANDLE_WITH_DEST(UnaryOp, visit_unaryop)
+    HANDLE_WITH_DEST(Landingpad, visit_landingpad)
+    HANDLE_WITH_DEST(Locals, visit_locals)
+    HANDLE_WITH_DEST(LoadName, visit_loadname)
+    HANDLE_WITH_DEST(LoadAttr, visit_loadattr)
+    HANDLE_WITH_DEST(GetIter, visit_getiter)
+    HANDLE_WITH_DEST(ImportFrom, visit_importfrom)
+    HANDLE_WITH_DEST(ImportName, visit_importname)
+    HANDLE_WITH_DEST(ImportStar, visit_importstar)
+    HANDLE_WITH_DEST(Nonzero, visit_nonzero)
+    HANDLE_WITH_DEST(CheckExcMatch, visit_checkexcmatch)
+    HANDLE_WITH_DEST(HasNext, visit_hasnext)
+    HANDLE_WITH_DEST(MakeClass, visit_makeClass)
+    HANDLE_WITH_DEST(MakeFunction, visit_makeFunction)
+    HANDLE_WITH_DEST(LoadSub, visit_loadsub)
+    HANDLE_WITH_DEST(LoadSubSlice, visit_loadsubslice)
+    HANDLE_WITH_DEST(MakeSlice, visit_makeslice)
+
+// A yield leaves the block early if it suspended a stackless generator:
+handle_Yield: {
+    Value v = visit_yield(static_cast<BST_Yield*>(node));
+    if (unlikely(!v.o))
+        return v;
+    doStore(static_cast<BST_Yield*>(node)->vreg_dst, v);
+    ASTInterpreterJitInterface::pendingCallsCheckHelper();
+    NEXT(Yield);
+}
+
+// The terminators end the block:
+handle_Branch:
+    visit_branch(static_cast<BST_Branch*>(node));
+    return Value();
+
+handle_Jump:
+    return visit_jump(static_cast<BST_Jump*>(node));
+
+handle_Assert:
+handle_Raise:
+handle_Return:
+invoke:
+    return executeStmt(node);
+
+unknown:
+    RELEASE_ASSERT(0, "not implemented %d", node->type());
+    __builtin_unreachable();
+
+#undef HANDLE_WITH_DEST
+#undef HANDLE
+#undef NEXT
+#undef DISPATCH
+#undef PREEMPTION_CHECK
+}
+#endif
+
 Value ASTInterpreter::visit_augBinOp(BST_AugBinOp* node) {
     assert(node->op_type != AST_TYPE::Is && node->op_type != AST_TYPE::IsNot && "not tested yet");
 
@@ -901,8 +1187,56 @@ void ASTInterpreter::visit_printexpr(BST_PrintExpr* node) {
 }
 
 Value ASTInterpreter::visit_yield(BST_Yield* node) {
+    // (also resumes a generator which left stackless mode while it was suspended at this yield)
+    if (stackless || suspended_at)
+        return yieldStackless(node);
+
+    Value value = node->vreg_value != VREG_UNDEFINED ? getVReg(node->vreg_value) : getNone();
+    return Value(ASTInterpreterJitInterface::yieldHelper(this, value.o),
+                 jit ? jit->emitYield(node, value, true /* can_continue */) : NULL);
+}
+
+// A stackless generator suspends by handing the value to the generator and unwinding the interpreter loop, which we
+// signal by returning a NULL value.  It gets resumed by executing the same yield again, which then returns the value
+// sent into the generator or throws the exception thrown into it.
+Value ASTInterpreter::yieldStackless(BST_Yield* node) {
+    if (suspended_at) {
+        assert(suspended_at == node);
+        suspended_at = NULL;
+
+        if (generator->exception.type) {
+            ExcInfo e = generator->exception;
+            generator->exception = ExcInfo(NULL, NULL, NULL);
+            Py_CLEAR(generator->returnValue);
+            throw e;
+        }
+
+        Box* r = generator->returnValue;
+        generator->returnValue = NULL;
+        return Value(r, NULL);
+    }
+
     Value value = node->vreg_value != VREG_UNDEFINED ? getVReg(node->vreg_value) : getNone();
-    return Value(ASTInterpreterJitInterface::yieldHelper(this, value.o), jit ? jit->emitYield(value) : NULL);
+
+    // We don't know yet what comes after the yield, so the JITed code for this block ends at it and leaves the rest to
+    // the interpreter, also when a generator with a stack of its own runs it:
+    if (jit) {
+        jit->emitYield(node, value, false /* can_continue */);
+        finishJITing();
+    }
+
+    suspendStackless(node, value.o);
+    return Value();
+}
+
+void ASTInterpreter::suspendStackless(BST_Yield* node, STOLEN(Box*) value) {
+    assert(!generator->returnValue);
+    generator->returnValue = value;
+    suspended_at = node;
+    next_block = NULL;
+
+    // (see visit_jump())
+    edgecount = std::min(edgecount, (unsigned)OSR_THRESHOLD_INTERPRETER);
 }
 
 Value ASTInterpreter::visit_stmt(BST_stmt* node) {
@@ -1042,6 +1376,8 @@ Value ASTInterpreter::visit_stmt(BST_stmt* node) {
                     break;
                 case BST_TYPE::Yield:
                     v = visit_yield((BST_Yield*)node);
+                    if (unlikely(!v.o)) // a stackless generator got suspended
+                        return v;
                     break;
                 case BST_TYPE::Landingpad:
                     v = visit_landingpad((BST_Landingpad*)node);
@@ -1649,11 +1985,76 @@ Value ASTInterpreter::visit_loadattr(BST_LoadAttr* node) {
     Value r;
     if (node->clsonly)
         r = Value(getclsattr(v.o, attr), jit ? jit->emitGetClsAttr(v, attr) : NULL);
+    else if (!jit)
+        r = Value(getattrQuickened(node, v.o, attr), NULL);
     else
         r = Value(pyston::getattr(v.o, attr), jit ? jit->emitGetAttr(node, v, attr) : NULL);
     return r;
 }
 
+InterpreterAttrCache& ASTInterpreter::getAttrCache(BST_LoadAttr* node) {
+    BoxedCode* code = getCode();
+    if (unlikely(!code->interp_attr_caches)) {
+        // Only number the LoadAttrs once the function actually runs:
+        int num_slots = 0;
+        for (CFGBlock* block : source_info->cfg->blocks) {
+            for (BST_stmt* stmt : *block) {
+                if (stmt->type() == BST_TYPE::LoadAttr)
+                    bst_cast<BST_LoadAttr>(stmt)->cache_slot = num_slots++;
+            }
+        }
+        code->interp_attr_caches.reset(new InterpreterAttrCache[num_slots]);
+    }
+    assert(node->cache_slot >= 0);
+    return code->interp_attr_caches[node->cache_slot];
+}
+
+// A LoadAttr which finds the attribute at a location that getattrCacheableLocation() can describe gets quickened:
+// it remembers that location in its inline cache and reads the attribute directly from there while the class and
+// the instance's hidden class stay the same.  Sites where this keeps failing stay with the generic getattr().
+#define MAX_ATTR_CACHE_FAILURES 8
+Box* ASTInterpreter::getattrQuickened(BST_LoadAttr* node, Box* obj, BoxedString* attr) {
+    InterpreterAttrCache& cache = getAttrCache(node);
+    BoxedClass* cls = obj->cls;
+
+    if (node->is_quickened()) {
+        if (likely(cls == cache.cls && cls->tp_version_tag == cache.version && cache.epoch == type_cache_epoch
+                   && PyType_HasFeature(cls, Py_TPFLAGS_VALID_VERSION_TAG)
+                   && obj->getHCAttrsPtr()->hcls == cache.hcls)) {
+            if (cache.offset >= 0)
+                return incref(obj->getHCAttrsPtr()->attr_list->attrs[cache.offset]);
+            return incref(cache.value);
+        }
+
+        static StatCounter num_interp_dequickened("num_interp_dequickened");
+        num_interp_dequickened.log();
+        node->set_quickened(false);
+        cache.num_failures++;
+    }
+
+    Box* rtn = pyston::getattr(obj, attr);
+
+    if (cache.num_failures < MAX_ATTR_CACHE_FAILURES) {
+        int offset;
+        Box* value;
+        if (getattrCacheableLocation(obj, attr, offset, value)) {
+            static StatCounter num_interp_quickened("num_interp_quickened");
+            num_interp_quickened.log();
+
+            cache.cls = cls;
+            cache.hcls = obj->getHCAttrsPtr()->hcls;
+            cache.version = cls->tp_version_tag;
+            cache.epoch = type_cache_epoch;
+            cache.offset = offset;
+            cache.value = value;
+            node->set_quickened(true);
+        } else {
+            cache.num_failures++;
+        }
+    }
+    return rtn;
+}
+
 
 Value ASTInterpreter::visit_loadsub(BST_LoadSub* node) {
     Value value = getVReg(node->vreg_value);
@@ -1935,12 +2336,44 @@ Box* ASTInterpreterJitInterface::yieldHelper(void* _interpreter, STOLEN(Box*) va
     return yield(generator, value, live_values);
 }
 
+Box* ASTInterpreterJitInterface::yieldFromJITHelper(void* _interpreter, BST_Yield* node, STOLEN(Box*) value,
+                                                     bool can_continue, Box** live_values, int num_live_values) {
+    ASTInterpreter* interpreter = (ASTInterpreter*)_interpreter;
+    auto generator = interpreter->generator;
+    assert(generator && generator->cls == generator_cls);
+
+    // A stackless generator returns to its caller through the interpreter loop, which resumes it at this yield:
+    if (interpreter->stackless) {
+        static StatCounter num_stackless_generator_bjit_yields("num_stackless_generator_bjit_yields");
+        num_stackless_generator_bjit_yields.log();
+
+        interpreter->suspendStackless(node, value);
+        return (Box*)stackless_yield_dummy_value;
+    }
+
+    Box* r = yield(generator, value, llvm::makeArrayRef(live_values, num_live_values));
+    if (can_continue)
+        return r;
+
+    // The JITed code ends at this yield because it got emitted while the generator ran stackless.  The interpreter
+    // continues after it, picking up the sent value like when resuming a stackless generator:
+    assert(!generator->returnValue);
+    generator->returnValue = r;
+    interpreter->suspended_at = node;
+    return (Box*)stackless_yield_dummy_value;
+}
+
 const void* interpreter_instr_addr = (void*)&executeInnerAndSetupFrame;
 
 // small wrapper around executeInner because we can not directly call the member function from asm.
 extern "C" Box* executeInnerFromASM(ASTInterpreter& interpreter, CFGBlock* start_block, BST_stmt* start_at) {
     initFrame(interpreter.getFrameInfo());
     Box* rtn = ASTInterpreter::executeInner(interpreter, start_block, start_at);
+    if (unlikely(interpreter.isSuspended())) {
+        // The frame of a stackless generator stays alive until it gets resumed:
+        cur_thread_state.frame_info = interpreter.getFrameInfo()->back;
+        return rtn;
+    }
     deinitFrameMaybe(interpreter.getFrameInfo());
     return rtn;
 }
@@ -1950,10 +2383,14 @@ Box* astInterpretFunction(BoxedCode* code, Box* closure, Box* generator, Box* gl
     UNAVOIDABLE_STAT_TIMER(t0, "us_timer_in_interpreter");
 
     SourceInfo* source_info = code->source.get();
+    code->ensureCFG();
 
     assert((!globals) == source_info->scoping.areGlobalsFromModule());
     bool can_reopt = ENABLE_REOPT && !FORCE_INTERPRETER;
 
+    if (unlikely(ENABLE_PROFILE_CACHE) && code->times_interpreted == 0)
+        applyProfileCache(code);
+
     if (unlikely(can_reopt
                  && (FORCE_OPTIMIZE || !ENABLE_INTERPRETER || code->times_interpreted > REOPT_THRESHOLD_BASELINE))) {
         code->times_interpreted = 0;
@@ -1975,38 +2412,43 @@ Box* astInterpretFunction(BoxedCode* code, Box* closure, Box* generator, Box* gl
         }
         FunctionSpecialization* spec = new FunctionSpecialization(UNKNOWN, arg_types);
 
-        // this also pushes the new CompiledVersion to the back of the version list:
-        CompiledFunction* optimized = compileFunction(code, spec, new_effort, NULL);
-
-        code->dependent_interp_callsites.invalidateAll();
-
-        UNAVOIDABLE_STAT_TIMER(t0, "us_timer_in_jitted_code");
-        Box* r;
-        Box* maybe_args[3];
-        int nmaybe_args = 0;
-        if (closure)
-            maybe_args[nmaybe_args++] = closure;
-        if (generator)
-            maybe_args[nmaybe_args++] = generator;
-        if (globals)
-            maybe_args[nmaybe_args++] = globals;
-        if (nmaybe_args == 0)
-            r = optimized->call(arg1, arg2, arg3, args);
-        else if (nmaybe_args == 1)
-            r = optimized->call1(maybe_args[0], arg1, arg2, arg3, args);
-        else if (nmaybe_args == 2)
-            r = optimized->call2(maybe_args[0], maybe_args[1], arg1, arg2, arg3, args);
-        else {
-            assert(nmaybe_args == 3);
-            r = optimized->call3(maybe_args[0], maybe_args[1], maybe_args[2], arg1, arg2, arg3, args);
-        }
+        // With background compilation the new version gets installed once the compiler thread is done with it;
+        // until then we keep executing this function in the interpreter / baseline JIT.
+        bool can_compile_in_background = ENABLE_BACKGROUND_COMPILATION && ENABLE_INTERPRETER && !FORCE_OPTIMIZE;
+        if (!can_compile_in_background || !enqueueBackgroundCompile(code, spec, new_effort)) {
+            // this also pushes the new CompiledVersion to the back of the version list:
+            CompiledFunction* optimized = compileFunction(code, spec, new_effort, NULL);
+
+            code->dependent_interp_callsites.invalidateAll();
+
+            UNAVOIDABLE_STAT_TIMER(t0, "us_timer_in_jitted_code");
+            Box* r;
+            Box* maybe_args[3];
+            int nmaybe_args = 0;
+            if (closure)
+                maybe_args[nmaybe_args++] = closure;
+            if (generator)
+                maybe_args[nmaybe_args++] = generator;
+            if (globals)
+                maybe_args[nmaybe_args++] = globals;
+            if (nmaybe_args == 0)
+                r = optimized->call(arg1, arg2, arg3, args);
+            else if (nmaybe_args == 1)
+                r = optimized->call1(maybe_args[0], arg1, arg2, arg3, args);
+            else if (nmaybe_args == 2)
+                r = optimized->call2(maybe_args[0], maybe_args[1], arg1, arg2, arg3, args);
+            else {
+                assert(nmaybe_args == 3);
+                r = optimized->call3(maybe_args[0], maybe_args[1], maybe_args[2], arg1, arg2, arg3, args);
+            }
 
-        if (optimized->exception_style == CXX)
-            return r;
-        else {
-            if (!r)
-                throwCAPIException();
-            return r;
+            if (optimized->exception_style == CXX)
+                return r;
+            else {
+                if (!r)
+                    throwCAPIException();
+                return r;
+            }
         }
     }
 
@@ -2040,6 +2482,124 @@ Box* astInterpretFunction(BoxedCode* code, Box* closure, Box* generator, Box* gl
     return v ? v : incref(Py_None);
 }
 
+bool canRunGeneratorStackless(BoxedCode* code) {
+    if (!ENABLE_STACKLESS_GENERATORS || !code->source || FORCE_OPTIMIZE || !ENABLE_INTERPRETER)
+        return false;
+
+    // The baseline JIT returns to the interpreter loop at the yields of a stackless generator, but LLVM-compiled code
+    // can't, so functions which are hot enough to get compiled (see astInterpretFunction()) keep using a generator
+    // stack.
+    if (code->times_interpreted > REOPT_THRESHOLD_BASELINE || !code->versions.empty()
+        || code->always_use_version.get(CXX) || code->always_use_version.get(CAPI))
+        return false;
+
+    return true;
+}
+
+static StatCounter num_stackless_generators("num_stackless_generators");
+
+bool resumeStacklessGenerator(BoxedGenerator* generator) {
+    ASTInterpreter* interpreter = (ASTInterpreter*)generator->stackless_interpreter;
+    CFGBlock* start_block = NULL;
+    BST_stmt* start_at = NULL;
+
+    if (!interpreter) {
+        // Same as astInterpretFunction(), except that the frame lives on the heap:
+        BoxedFunctionBase* func = generator->function;
+        BoxedCode* code = func->code;
+        code->ensureCFG();
+        SourceInfo* source_info = code->source.get();
+
+        Box** vregs = NULL;
+        int num_vregs = source_info->cfg->getVRegInfo().getTotalNumOfVRegs();
+        if (num_vregs > 0)
+            vregs = (Box**)calloc(num_vregs, sizeof(Box*));
+
+        ++code->times_interpreted;
+        interpreter = new ASTInterpreter(code, vregs);
+        interpreter->stackless = true;
+
+        if (unlikely(source_info->scoping.usesNameLookup()))
+            interpreter->setBoxedLocals(new BoxedDict());
+
+        assert((!func->globals) == source_info->scoping.areGlobalsFromModule());
+        interpreter->setGlobals(func->globals ? func->globals : source_info->parent_module);
+
+        Box** args = generator->args ? &generator->args->elts[0] : NULL;
+        interpreter->initArguments(func->closure, generator, generator->arg1, generator->arg2, generator->arg3, args);
+
+        generator->stackless_interpreter = interpreter;
+        num_stackless_generators.log();
+    } else {
+        assert(interpreter->isSuspended());
+        if (interpreter->leave_stackless_at) {
+            // We left stackless mode in the middle of a loop and now continue on our own stack:
+            start_block = interpreter->leave_stackless_at;
+            start_at = start_block->body();
+            interpreter->leave_stackless_at = NULL;
+        } else {
+            start_block = interpreter->current_block;
+            start_at = interpreter->suspended_at;
+        }
+
+        // The caller can change between yields:
+        FrameInfo* frame_info = interpreter->getFrameInfo();
+        if (frame_info->back != cur_thread_state.frame_info && frame_info->frame_obj)
+            frameInvalidateBack(frame_info->frame_obj);
+    }
+
+    generator->paused_frame_info = NULL;
+    generator->live_values = llvm::ArrayRef<Box*>();
+
+    Box* rtn = ASTInterpreter::execute(*interpreter, start_block, start_at);
+    if (interpreter->isSuspended()) {
+        assert(!rtn);
+        generator->paused_frame_info = interpreter->getFrameInfo();
+        generator->live_values = llvm::makeArrayRef((Box**)&interpreter->created_closure, 1);
+        return true;
+    }
+
+    Py_XDECREF(rtn);
+    return false;
+}
+
+bool leaveStacklessMode(BoxedGenerator* generator) {
+    ASTInterpreter* interpreter = (ASTInterpreter*)generator->stackless_interpreter;
+    assert(interpreter && interpreter->stackless && interpreter->isSuspended());
+
+    // If it got suspended at a yield we only move once new generators of this function wouldn't run stackless anymore:
+    if (!interpreter->leave_stackless_at && canRunGeneratorStackless(interpreter->getCode()))
+        return false;
+
+    static StatCounter num_stackless_generators_left("num_stackless_generators_left");
+    num_stackless_generators_left.log();
+
+    interpreter->stackless = false;
+    return true;
+}
+
+void freeStacklessGeneratorFrame(BoxedGenerator* generator) {
+    ASTInterpreter* interpreter = (ASTInterpreter*)generator->stackless_interpreter;
+    if (!interpreter)
+        return;
+
+    generator->stackless_interpreter = NULL;
+    generator->paused_frame_info = NULL;
+    generator->live_values = llvm::ArrayRef<Box*>();
+
+    // deinitFrame() clears the globals, so if they are still set nobody released the references of the frame yet
+    // (the generator is suspended, or an exception got thrown before we entered the interpreter loop):
+    FrameInfo* frame_info = interpreter->getFrameInfo();
+    if (frame_info->globals) {
+        initFrame(frame_info);
+        deinitFrame(frame_info);
+    }
+
+    Box** vregs = interpreter->getVRegs();
+    delete interpreter;
+    free(vregs);
+}
+
 Box* astInterpretFunctionEval(BoxedCode* code, Box* globals, Box* boxedLocals) {
     ++code->times_interpreted;
 
@@ -25,9 +25,12 @@ class GCVisitor;
 
 class BST_stmt;
 class BST_Jump;
+class BST_Yield;
 class Box;
 class BoxedClosure;
+class BoxedCode;
 class BoxedDict;
+class BoxedGenerator;
 struct LineInfo;
 
 extern const void* interpreter_instr_addr;
@@ -35,6 +38,8 @@ extern const void* interpreter_instr_addr;
 struct ASTInterpreterJitInterface {
     // Special value which when returned from the bjit will trigger a OSR.
     static constexpr uint64_t osr_dummy_value = -1;
+    // Special value which the bjit returns when it left a block at a yield, see yieldFromJITHelper().
+    static constexpr uint64_t stackless_yield_dummy_value = -2;
 
     static int getBoxedLocalsOffset();
     static int getCreatedClosureOffset();
@@ -53,6 +58,8 @@ struct ASTInterpreterJitInterface {
     static void uncacheExcInfoHelper(void* interp);
     static void raise0Helper(void* interp) __attribute__((noreturn));
     static Box* yieldHelper(void* interp, STOLEN(Box*) value);
+    static Box* yieldFromJITHelper(void* interp, BST_Yield* node, STOLEN(Box*) value, bool can_continue,
+                                   Box** live_values, int num_live_values);
 };
 
 class RewriterVar;
@@ -84,6 +91,19 @@ extern "C" Box* astInterpretDeopt(BoxedCode* cf, BST_stmt* enclosing_stmt, Box*
 struct FrameInfo;
 FrameInfo* getFrameInfoForInterpretedFrame(void* frame_ptr);
 
+// Stackless generators keep their interpreter frame in the generator object and run on the stack of whoever resumes
+// them, instead of getting a stack of their own.  Only possible while the function runs in the interpreter or the
+// baseline JIT.
+bool canRunGeneratorStackless(BoxedCode* code);
+// Runs the generator until its next yield (returns true) or until it returns (returns false) or throws.  Also returns
+// true if a loop got hot, without yielding; the generator then has to leave stackless mode.
+bool resumeStacklessGenerator(BoxedGenerator* generator);
+// Checks whether the suspended generator is hot enough to continue on a generator stack of its own, where it can OSR
+// or run LLVM-compiled code.  If so, switches its interpreter out of stackless mode.
+bool leaveStacklessMode(BoxedGenerator* generator);
+// Releases the interpreter frame of the generator, also if it is still suspended.
+void freeStacklessGeneratorFrame(BoxedGenerator* generator);
+
 // Executes the equivalent of CPython's PRINT_EXPR opcode (call sys.displayhook)
 extern "C" void printExprHelper(Box* b);
 }
@@ -226,9 +226,10 @@ RewriterVar* JitFragmentWriter::imm(const void* val) {
     return loadConst((uint64_t)val);
 }
 
-RewriterVar* JitFragmentWriter::emitAugbinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type) {
-    return emitPPCall((void*)augbinop, { lhs, rhs, imm(op_type) }, 2 * 320, true /* record type */, node)
-        .first->setType(RefType::OWNED);
+RewriterVar* JitFragmentWriter::emitAugbinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                                             BoxedClass* operand_cls) {
+    return emitPPCall((void*)augbinop, { lhs, rhs, imm(op_type) }, 2 * 320, true /* record type */, node, {},
+                      getNumericFastPath((void*)augbinop, op_type, operand_cls)).first->setType(RefType::OWNED);
 }
 
 RewriterVar* JitFragmentWriter::emitApplySlice(RewriterVar* target, RewriterVar* lower, RewriterVar* upper) {
@@ -239,9 +240,10 @@ RewriterVar* JitFragmentWriter::emitApplySlice(RewriterVar* target, RewriterVar*
     return emitPPCall((void*)applySlice, { target, lower, upper }, 256).first->setType(RefType::OWNED);
 }
 
-RewriterVar* JitFragmentWriter::emitBinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type) {
-    return emitPPCall((void*)binop, { lhs, rhs, imm(op_type) }, 2 * 240, true /* record type */, node)
-        .first->setType(RefType::OWNED);
+RewriterVar* JitFragmentWriter::emitBinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                                          BoxedClass* operand_cls) {
+    return emitPPCall((void*)binop, { lhs, rhs, imm(op_type) }, 2 * 240, true /* record type */, node, {},
+                      getNumericFastPath((void*)binop, op_type, operand_cls)).first->setType(RefType::OWNED);
 }
 
 RewriterVar* JitFragmentWriter::emitCallattr(BST_stmt* node, RewriterVar* obj, BoxedString* attr, CallattrFlags flags,
@@ -298,13 +300,14 @@ RewriterVar* JitFragmentWriter::emitCallattr(BST_stmt* node, RewriterVar* obj, B
 #endif
 }
 
-RewriterVar* JitFragmentWriter::emitCompare(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type) {
+RewriterVar* JitFragmentWriter::emitCompare(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                                            BoxedClass* operand_cls) {
     if (op_type == AST_TYPE::Is || op_type == AST_TYPE::IsNot) {
         RewriterVar* cmp_result = lhs->cmp(op_type == AST_TYPE::IsNot ? AST_TYPE::NotEq : AST_TYPE::Eq, rhs);
         return call(false, (void*)boxBool, cmp_result)->setType(RefType::OWNED);
     }
-    return emitPPCall((void*)compare, { lhs, rhs, imm(op_type) }, 2 * 240, true /* record type */, node)
-        .first->setType(RefType::OWNED);
+    return emitPPCall((void*)compare, { lhs, rhs, imm(op_type) }, 2 * 240, true /* record type */, node, {},
+                      getNumericFastPath((void*)compare, op_type, operand_cls)).first->setType(RefType::OWNED);
 }
 
 RewriterVar* JitFragmentWriter::emitCreateDict() {
@@ -452,6 +455,7 @@ RewriterVar* JitFragmentWriter::emitGetLocal(InternedString name, int vreg) {
     RewriterVar* val_var = vregs_array->getAttr(vreg * 8);
     if (known_non_null_vregs.count(vreg) == 0) {
         addAction([=]() { _emitGetLocal(val_var, name.c_str()); }, { val_var }, ActionType::NORMAL);
+        markLastActionAsCall();
         known_non_null_vregs.insert(vreg);
     } else {
         val_var->incref();
@@ -582,7 +586,7 @@ std::vector<RewriterVar*> JitFragmentWriter::emitUnpackIntoArray(RewriterVar* v,
     return rtn;
 }
 
-RewriterVar* JitFragmentWriter::emitYield(RewriterVar* v) {
+RewriterVar* JitFragmentWriter::emitYield(BST_Yield* node, RewriterVar* v, bool can_continue) {
     llvm::SmallVector<RewriterVar*, 16> local_args;
     local_args.push_back(interp->getAttr(ASTInterpreterJitInterface::getCreatedClosureOffset()));
     // we have to pass all owned references which are not stored in the vregs to yield() so that the GC can traverse it
@@ -597,10 +601,12 @@ RewriterVar* JitFragmentWriter::emitYield(RewriterVar* v) {
     local_args.erase(std::unique(local_args.begin(), local_args.end()), local_args.end());
 
     auto&& args = allocArgs(local_args, RewriterVar::SetattrType::REF_USED);
-    RewriterVar* generator = interp->getAttr(ASTInterpreterJitInterface::getGeneratorOffset());
-    auto rtn = call(false, (void*)yield, { generator, v, args, imm(local_args.size()) }, {}, local_args)
-                   ->setType(RefType::OWNED);
+    // Without can_continue the helper never returns a reference, just the stackless_yield_dummy_value
+    auto rtn = call(false, (void*)ASTInterpreterJitInterface::yieldFromJITHelper,
+                    { interp, imm(node), v, imm(can_continue), args, imm(local_args.size()) }, {}, local_args)
+                   ->setType(can_continue ? RefType::OWNED : RefType::BORROWED);
     v->refConsumed();
+    addAction([=]() { _emitYieldExit(rtn, can_continue); }, { rtn }, ActionType::NORMAL);
     return rtn;
 }
 
@@ -943,11 +949,51 @@ uint64_t JitFragmentWriter::asUInt(InternedString s) {
 }
 #endif
 
+// The inline int and float paths allocate their result straight from the freelists, doing by hand what PyObject_INIT
+// does.  In the builds where that involves more than setting the class and the refcount we don't emit them.
+#if !defined(DISABLE_INT_FREELIST) && !defined(Py_TRACE_REFS) && !defined(COUNT_ALLOCS)
+#define ENABLE_BASELINEJIT_NUMERIC_FAST_PATHS 1
+#else
+#define ENABLE_BASELINEJIT_NUMERIC_FAST_PATHS 0
+#endif
+
+JitFragmentWriter::NumericFastPath JitFragmentWriter::getNumericFastPath(void* func_addr, int op_type,
+                                                                         BoxedClass* operand_cls) {
+    if (!ENABLE_BASELINEJIT_NUMERIC_FAST_PATHS || !ENABLE_BASELINEJIT_ICS)
+        return NumericFastPath::None;
+
+    if (func_addr == (void*)compare) {
+        if (operand_cls != int_cls)
+            return NumericFastPath::None;
+        switch (op_type) {
+            case AST_TYPE::Eq:
+            case AST_TYPE::NotEq:
+            case AST_TYPE::Lt:
+            case AST_TYPE::LtE:
+            case AST_TYPE::Gt:
+            case AST_TYPE::GtE:
+                return NumericFastPath::Int;
+            default:
+                return NumericFastPath::None;
+        }
+    }
+
+    // int and float don't implement the inplace operations, so augbinop ends up doing the same as binop.
+    assert(func_addr == (void*)binop || func_addr == (void*)augbinop);
+    if (operand_cls == int_cls && (op_type == AST_TYPE::Add || op_type == AST_TYPE::Sub))
+        return NumericFastPath::Int;
+    if (operand_cls == float_cls
+        && (op_type == AST_TYPE::Add || op_type == AST_TYPE::Sub || op_type == AST_TYPE::Mult))
+        return NumericFastPath::Float;
+    return NumericFastPath::None;
+}
+
 std::pair<RewriterVar*, RewriterAction*> JitFragmentWriter::emitPPCall(void* func_addr,
                                                                        llvm::ArrayRef<RewriterVar*> args,
                                                                        unsigned short pp_size, bool should_record_type,
                                                                        BST_stmt* ast_node,
-                                                                       llvm::ArrayRef<RewriterVar*> additional_uses) {
+                                                                       llvm::ArrayRef<RewriterVar*> additional_uses,
+                                                                       NumericFastPath fast_path) {
     if (LOG_BJIT_ASSEMBLY)
         comment("BJIT: emitPPCall() start");
 #if ENABLE_BASELINEJIT_ICS
@@ -965,11 +1011,12 @@ std::pair<RewriterVar*, RewriterAction*> JitFragmentWriter::emitPPCall(void* fun
         assert(ast_node);
 
     RewriterAction* call_action
-        = addAction([this, result, func_addr, ast_node, args_array, args_size, pp_size, num_additional]() {
+        = addAction([this, result, func_addr, ast_node, args_array, args_size, pp_size, num_additional, fast_path]() {
             auto all_args = llvm::makeArrayRef(args_array, args_size + num_additional);
             auto args = all_args.slice(0, args_size);
-            this->_emitPPCall(result, func_addr, args, pp_size, ast_node, all_args);
+            this->_emitPPCall(result, func_addr, args, pp_size, ast_node, all_args, fast_path);
         }, args_array_ref, ActionType::NORMAL);
+    markLastActionAsCall();
 
     if (should_record_type) {
         RewriterVar* obj_cls_var = result->getAttr(offsetof(Box, cls));
@@ -1118,6 +1165,131 @@ void JitFragmentWriter::_emitJump(CFGBlock* b, RewriterVar* block_next, ExitInfo
     block_next->bumpUse();
 }
 
+void JitFragmentWriter::_emitNumericFastPath(
+    void* func_addr, int op_type, NumericFastPath fast_path,
+    std::vector<std::unique_ptr<assembler::LargeForwardJump>>& slow_path_jumps) {
+    // This gets emitted by _emitPPCall after _setupCall, so lhs is in RDI, rhs in RSI and op_type in RDX.  They have to
+    // stay there because every jump in slow_path_jumps goes to the IC; the other caller-save registers are free to use.
+    // On success the result is in RAX, like the IC would return it.
+    assert(fast_path != NumericFastPath::None);
+    BoxedClass* cls = fast_path == NumericFastPath::Int ? int_cls : float_cls;
+    // Skips over the allocation if the int result is one of the interned ones:
+    std::unique_ptr<assembler::ForwardJump> interned_done;
+
+    // Subclasses could override anything, so both operands have to be exactly of that class.
+    const_loader.loadConstIntoReg((uint64_t)cls, assembler::R11);
+    for (assembler::Register reg : { assembler::RDI, assembler::RSI }) {
+        assembler->cmp(assembler::Indirect(reg, offsetof(Box, cls)), assembler::R11);
+        slow_path_jumps.emplace_back(new assembler::LargeForwardJump(*assembler, assembler::COND_NOT_EQUAL));
+    }
+
+    if (func_addr == (void*)compare) {
+        assert(fast_path == NumericFastPath::Int);
+        assembler::ConditionCode condition;
+        switch (op_type) {
+            case AST_TYPE::Eq:
+                condition = assembler::COND_EQUAL;
+                break;
+            case AST_TYPE::NotEq:
+                condition = assembler::COND_NOT_EQUAL;
+                break;
+            case AST_TYPE::Lt:
+                condition = assembler::COND_LESS;
+                break;
+            case AST_TYPE::LtE:
+                condition = assembler::COND_NOT_GREATER;
+                break;
+            case AST_TYPE::Gt:
+                condition = assembler::COND_GREATER;
+                break;
+            case AST_TYPE::GtE:
+                condition = assembler::COND_NOT_LESS;
+                break;
+            default:
+                RELEASE_ASSERT(0, "%d", op_type);
+        }
+
+        assembler->mov(assembler::Indirect(assembler::RDI, offsetof(BoxedInt, n)), assembler::RAX);
+        assembler->cmp(assembler::Indirect(assembler::RSI, offsetof(BoxedInt, n)), assembler::RAX);
+        // Plain movs, which leave the flags alone.
+        assembler->mov(assembler::Immediate((void*)Py_True), assembler::RAX);
+        {
+            assembler::ForwardJump jcc(*assembler, condition);
+            assembler->mov(assembler::Immediate((void*)Py_False), assembler::RAX);
+        }
+#ifndef Py_IMMORTAL_OBJECTS
+#ifdef Py_REF_DEBUG
+        assembler->incq(assembler::Immediate(&_Py_RefTotal));
+#endif
+        assembler->incq(assembler::Indirect(assembler::RAX, offsetof(Box, ob_refcnt)));
+#endif
+        return;
+    }
+
+    if (fast_path == NumericFastPath::Int) {
+        // On overflow the result would have to be a long; let the IC deal with that.
+        assembler->mov(assembler::Indirect(assembler::RDI, offsetof(BoxedInt, n)), assembler::RCX);
+        if (op_type == AST_TYPE::Add)
+            assembler->add(assembler::Indirect(assembler::RSI, offsetof(BoxedInt, n)), assembler::RCX);
+        else if (op_type == AST_TYPE::Sub)
+            assembler->sub(assembler::Indirect(assembler::RSI, offsetof(BoxedInt, n)), assembler::RCX);
+        else
+            RELEASE_ASSERT(0, "%d", op_type);
+        slow_path_jumps.emplace_back(new assembler::LargeForwardJump(*assembler, assembler::COND_OVERFLOW));
+
+        // Small results have to be the cached boxes, like boxInt() returns them (code can observe this with 'is').
+        // One unsigned compare of n - MIN_INTERNED_INT checks both ends of the range.
+        assembler->mov(assembler::RCX, assembler::R9);
+        assembler->sub(assembler::Immediate((uint64_t)(int64_t)MIN_INTERNED_INT), assembler::R9);
+        assembler->cmp(assembler::R9, assembler::Immediate((uint64_t)NUM_INTERNED_INTS));
+        {
+            assembler::ForwardJump jae(*assembler, assembler::COND_NOT_BELOW);
+            assembler->shl(assembler::Immediate(3ul), assembler::R9);
+            const_loader.loadConstIntoReg((uint64_t)&interned_ints[0], assembler::R8);
+            assembler->add(assembler::R9, assembler::R8);
+            assembler->mov(assembler::Indirect(assembler::R8, 0), assembler::RAX);
+#ifndef Py_IMMORTAL_OBJECTS
+#ifdef Py_REF_DEBUG
+            assembler->incq(assembler::Immediate(&_Py_RefTotal));
+#endif
+            assembler->incq(assembler::Indirect(assembler::RAX, offsetof(Box, ob_refcnt)));
+#endif
+            interned_done.reset(new assembler::ForwardJump(*assembler));
+        }
+    } else {
+        assembler->movsd(assembler::Indirect(assembler::RDI, offsetof(BoxedFloat, d)), assembler::XMM0);
+        if (op_type == AST_TYPE::Add)
+            assembler->addsd(assembler::Indirect(assembler::RSI, offsetof(BoxedFloat, d)), assembler::XMM0);
+        else if (op_type == AST_TYPE::Sub)
+            assembler->subsd(assembler::Indirect(assembler::RSI, offsetof(BoxedFloat, d)), assembler::XMM0);
+        else if (op_type == AST_TYPE::Mult)
+            assembler->mulsd(assembler::Indirect(assembler::RSI, offsetof(BoxedFloat, d)), assembler::XMM0);
+        else
+            RELEASE_ASSERT(0, "%d", op_type);
+    }
+
+    // Take the result box from the freelist, the same way BoxedInt/BoxedFloat::operator new does.  If the freelist is
+    // empty we leave refilling it to the slow path.  The freelist is linked through the class pointers.
+    void* free_list_addr
+        = fast_path == NumericFastPath::Int ? (void*)&BoxedInt::free_list : (void*)&BoxedFloat::free_list;
+    const_loader.loadConstIntoReg((uint64_t)free_list_addr, assembler::R8);
+    assembler->mov(assembler::Indirect(assembler::R8, 0), assembler::RAX);
+    assembler->test(assembler::RAX, assembler::RAX);
+    slow_path_jumps.emplace_back(new assembler::LargeForwardJump(*assembler, assembler::COND_EQUAL));
+    assembler->mov(assembler::Indirect(assembler::RAX, offsetof(Box, cls)), assembler::R9);
+    assembler->mov(assembler::R9, assembler::Indirect(assembler::R8, 0));
+
+    assembler->mov(assembler::R11, assembler::Indirect(assembler::RAX, offsetof(Box, cls)));
+    assembler->movq(assembler::Immediate(1ul), assembler::Indirect(assembler::RAX, offsetof(Box, ob_refcnt)));
+#ifdef Py_REF_DEBUG
+    assembler->incq(assembler::Immediate(&_Py_RefTotal));
+#endif
+    if (fast_path == NumericFastPath::Int)
+        assembler->mov(assembler::RCX, assembler::Indirect(assembler::RAX, offsetof(BoxedInt, n)));
+    else
+        assembler->movsd(assembler::XMM0, assembler::Indirect(assembler::RAX, offsetof(BoxedFloat, d)));
+}
+
 void JitFragmentWriter::_emitOSRPoint() {
     // We can't directly do OSR from the bjit frame because it will cause issues with exception handling.
     // Reason is that the bjit and the OSRed code share the same python frame and the way invokes are implemented in the
@@ -1149,9 +1321,37 @@ void JitFragmentWriter::_emitOSRPoint() {
     assertConsistent();
 }
 
+void JitFragmentWriter::_emitYieldExit(RewriterVar* yield_result, bool can_continue) {
+    // A stackless generator has to return to its caller, so we leave the block and let the interpreter loop handle it.
+    // The CFG ends the block right after a yield, so there are no block-local values which we would have to release.
+    // this generates code for:
+    // if (!can_continue || yield_result == ASTInterpreterJitInterface::stackless_yield_dummy_value)
+    //     return std::make_pair((CFGBlock*)0, ASTInterpreterJitInterface::stackless_yield_dummy_value);
+    std::unique_ptr<assembler::ForwardJump> jne;
+    if (can_continue) {
+        assembler->cmp(yield_result->getInReg(),
+                       assembler::Immediate(ASTInterpreterJitInterface::stackless_yield_dummy_value));
+        jne.reset(new assembler::ForwardJump(*assembler, assembler::COND_NOT_EQUAL));
+    }
+    assembler->clear_reg(assembler::RAX); // = next block to execute
+    assembler->mov(assembler::Immediate(ASTInterpreterJitInterface::stackless_yield_dummy_value), assembler::RDX);
+    assembler->add(assembler::Immediate(JitCodeBlock::sp_adjustment), assembler::RSP);
+    assembler->pop(assembler::RBX);
+    assembler->pop(assembler::R12);
+    assembler->pop(assembler::R13);
+    assembler->pop(assembler::R14);
+    assembler->pop(assembler::R15);
+    assembler->pop(assembler::RBP);
+    assembler->retq();
+    jne.reset();
+
+    yield_result->bumpUse();
+    assertConsistent();
+}
+
 void JitFragmentWriter::_emitPPCall(RewriterVar* result, void* func_addr, llvm::ArrayRef<RewriterVar*> args,
                                     unsigned short pp_size, BST_stmt* ast_node,
-                                    llvm::ArrayRef<RewriterVar*> vars_to_bump) {
+                                    llvm::ArrayRef<RewriterVar*> vars_to_bump, NumericFastPath fast_path) {
     assembler::Register r = allocReg(assembler::R11);
 
     if (args.size() > 6) { // only 6 args can get passed in registers.
@@ -1170,12 +1370,22 @@ void JitFragmentWriter::_emitPPCall(RewriterVar* result, void* func_addr, llvm::
     // make sure setupCall doesn't use R11
     assert(vars_by_location.count(assembler::R11) == 0);
 
+    // If the fast path handles the operation it jumps over the patchpoint, otherwise it falls through into it.
+    std::unique_ptr<assembler::LargeForwardJump> fast_path_done;
+    if (fast_path != NumericFastPath::None) {
+        assert(args.size() == 3 && args[2]->isConstant());
+        std::vector<std::unique_ptr<assembler::LargeForwardJump>> slow_path_jumps;
+        _emitNumericFastPath(func_addr, args[2]->constant_value, fast_path, slow_path_jumps);
+        fast_path_done.reset(new assembler::LargeForwardJump(*assembler));
+    }
+
     // make space for patchpoint
     uint8_t* pp_start = rewrite->getSlotStart() + assembler->bytesWritten();
     constexpr int call_size = 13;
     assembler->skipBytes(pp_size + call_size);
     uint8_t* pp_end = rewrite->getSlotStart() + assembler->bytesWritten();
     assert(assembler->hasFailed() || (pp_start + pp_size + call_size == pp_end));
+    fast_path_done.reset();
 
     assembler::RegisterSet regs = assembler::RegisterSet::stdAllocatable();
     for (assembler::Register reg : JitCodeBlock::additional_regs) {
@@ -1221,12 +1431,18 @@ void JitFragmentWriter::_emitRecordType(RewriterVar* obj_cls_var) {
     TypeRecorder* type_recorder = new TypeRecorder;
     pp_infos.back().type_recorder.reset(type_recorder);
 
-    // This directly emits the instructions of the recordType() function.
+    // This directly emits the instructions of the recordType() function.  First update the run of the last seen
+    // class, then walk the entries until we find either our class or an empty one to claim.  If all the entries are
+    // taken by other classes we end up pointing at the 'megamorphic' entry, which is laid out as if it were the entry
+    // after the last one.
+    static_assert(offsetof(TypeRecorder, megamorphic)
+                      == offsetof(TypeRecorder, entries) + TypeRecorder::NUM_ENTRIES * sizeof(TypeRecorder::Entry),
+                  "");
     assembler::Register obj_cls_reg = obj_cls_var->getInReg();
-    assembler::Register type_recorder_reg = allocReg(Location::any(), obj_cls_reg);
-    const_loader.loadConstIntoReg((uint64_t)type_recorder, type_recorder_reg);
-    assembler::Indirect last_seen_count = assembler::Indirect(type_recorder_reg, offsetof(TypeRecorder, last_count));
-    assembler::Indirect last_seen_indirect = assembler::Indirect(type_recorder_reg, offsetof(TypeRecorder, last_seen));
+    assembler::Register entry_reg = allocReg(Location::any(), obj_cls_reg);
+    const_loader.loadConstIntoReg((uint64_t)type_recorder, entry_reg);
+    assembler::Indirect last_seen_count = assembler::Indirect(entry_reg, offsetof(TypeRecorder, last_count));
+    assembler::Indirect last_seen_indirect = assembler::Indirect(entry_reg, offsetof(TypeRecorder, last_seen));
 
     assembler->cmp(last_seen_indirect, obj_cls_reg);
     {
@@ -1236,6 +1452,25 @@ void JitFragmentWriter::_emitRecordType(RewriterVar* obj_cls_var) {
     }
     assembler->incq(last_seen_count);
 
+    assembler->add(assembler::Immediate(offsetof(TypeRecorder, entries)), entry_reg);
+    assembler::Indirect entry_cls = assembler::Indirect(entry_reg, offsetof(TypeRecorder::Entry, cls));
+    assembler::Indirect entry_count = assembler::Indirect(entry_reg, offsetof(TypeRecorder::Entry, count));
+
+    {
+        std::vector<std::unique_ptr<assembler::LargeForwardJump>> found_jumps;
+        for (int i = 0; i < TypeRecorder::NUM_ENTRIES; i++) {
+            assembler->cmp(entry_cls, assembler::Immediate(0ul));
+            {
+                assembler::ForwardJump jne(*assembler, assembler::COND_NOT_EQUAL);
+                assembler->mov(obj_cls_reg, entry_cls);
+            }
+            assembler->cmp(entry_cls, obj_cls_reg);
+            found_jumps.emplace_back(new assembler::LargeForwardJump(*assembler, assembler::COND_EQUAL));
+            assembler->add(assembler::Immediate(sizeof(TypeRecorder::Entry)), entry_reg);
+        }
+    }
+    assembler->incq(entry_count);
+
     obj_cls_var->bumpUse();
 }
 
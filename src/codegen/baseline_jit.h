@@ -29,7 +29,9 @@ namespace pyston {
 #define ENABLE_BASELINEJIT_ICS 1
 
 class BST_stmt;
+class BST_Yield;
 class Box;
+class BoxedClass;
 class BoxedDict;
 class BoxedList;
 class BoxedTuple;
@@ -266,12 +268,17 @@ public:
     RewriterVar* imm(uint64_t val);
     RewriterVar* imm(const void* val);
 
-    RewriterVar* emitAugbinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type);
+    // For the binops and compares, operand_cls is the class both operands had when we JITed the node (or NULL if they
+    // had different ones).  If it is int or float we emit the common cases inline, in front of the IC.
+    RewriterVar* emitAugbinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                              BoxedClass* operand_cls = NULL);
     RewriterVar* emitApplySlice(RewriterVar* target, RewriterVar* lower, RewriterVar* upper);
-    RewriterVar* emitBinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type);
+    RewriterVar* emitBinop(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                           BoxedClass* operand_cls = NULL);
     RewriterVar* emitCallattr(BST_stmt* node, RewriterVar* obj, BoxedString* attr, CallattrFlags flags,
                               const llvm::ArrayRef<RewriterVar*> args, const std::vector<BoxedString*>* keyword_names);
-    RewriterVar* emitCompare(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type);
+    RewriterVar* emitCompare(BST_stmt* node, RewriterVar* lhs, RewriterVar* rhs, int op_type,
+                             BoxedClass* operand_cls = NULL);
     RewriterVar* emitCreateDict();
     void emitDictSet(RewriterVar* dict, RewriterVar* k, RewriterVar* v);
     RewriterVar* emitCreateList(const llvm::ArrayRef<STOLEN(RewriterVar*)> values);
@@ -305,7 +312,7 @@ public:
                                  const std::vector<BoxedString*>* keyword_names);
     RewriterVar* emitUnaryop(RewriterVar* v, int op_type);
     std::vector<RewriterVar*> emitUnpackIntoArray(RewriterVar* v, uint64_t num);
-    RewriterVar* emitYield(RewriterVar* v);
+    RewriterVar* emitYield(BST_Yield* node, RewriterVar* v, bool can_continue);
 
     void emitAssignSlice(RewriterVar* target, RewriterVar* lower, RewriterVar* upper, RewriterVar* value);
     void emitDelAttr(RewriterVar* target, BoxedString* attr);
@@ -353,10 +360,15 @@ private:
     // the allocArgs call.
     RewriterVar* emitCallWithAllocatedArgs(void* func_addr, const llvm::ArrayRef<RewriterVar*> args,
                                            const llvm::ArrayRef<RewriterVar*> additional_uses);
+    // Inline fast paths which emitPPCall can emit in front of the IC of a binop, augbinop or compare.
+    enum class NumericFastPath : unsigned char { None, Int, Float };
+    static NumericFastPath getNumericFastPath(void* func_addr, int op_type, BoxedClass* operand_cls);
+
     std::pair<RewriterVar*, RewriterAction*> emitPPCall(void* func_addr, llvm::ArrayRef<RewriterVar*> args,
                                                         unsigned short pp_size, bool should_record_type = false,
                                                         BST_stmt* bst_node = NULL,
-                                                        llvm::ArrayRef<RewriterVar*> additional_uses = {});
+                                                        llvm::ArrayRef<RewriterVar*> additional_uses = {},
+                                                        NumericFastPath fast_path = NumericFastPath::None);
 
     static void assertNameDefinedHelper(const char* id);
     static Box* callattrHelper(Box* obj, BoxedString* attr, CallattrFlags flags, Box** args,
@@ -376,11 +388,14 @@ private:
     void _emitJump(CFGBlock* b, RewriterVar* block_next, ExitInfo& exit_info);
     void _emitOSRPoint();
     void _emitPPCall(RewriterVar* result, void* func_addr, llvm::ArrayRef<RewriterVar*> args, unsigned short pp_size,
-                     BST_stmt* bst_node, llvm::ArrayRef<RewriterVar*> vars_to_bump);
+                     BST_stmt* bst_node, llvm::ArrayRef<RewriterVar*> vars_to_bump, NumericFastPath fast_path);
+    void _emitNumericFastPath(void* func_addr, int op_type, NumericFastPath fast_path,
+                              std::vector<std::unique_ptr<assembler::LargeForwardJump>>& slow_path_jumps);
     void _emitRecordType(RewriterVar* obj_cls_var);
     void _emitReturn(RewriterVar* v);
     void _emitSideExit(STOLEN(RewriterVar*) var, RewriterVar* val_constant, CFGBlock* next_block,
                        RewriterVar* false_path);
+    void _emitYieldExit(RewriterVar* yield_result, bool can_continue);
 };
 }
 
@@ -31,6 +31,7 @@
 #include "codegen/compvars.h"
 #include "core/bst.h"
 #include "core/cfg.h"
+#include "core/stats.h"
 #include "core/util.h"
 #include "runtime/types.h"
 
@@ -72,6 +73,20 @@ SourceInfo::~SourceInfo() {
     delete cfg;
 }
 
+void BoxedCode::computeLazyCFG() {
+    STAT_TIMER(t0, "us_timer_lazy_cfg", 0);
+    static StatCounter num_lazy_cfgs_computed("num_lazy_cfgs_computed");
+    num_lazy_cfgs_computed.log();
+
+    assert(source && !source->cfg);
+    RELEASE_ASSERT(source->lazy_cfg, "");
+
+    // Only drop the AST / serialized data once we succeeded, so that if this throws the next call can retry:
+    source->lazy_cfg->compute(this);
+    assert(source->cfg);
+    source->lazy_cfg.reset();
+}
+
 void FunctionAddressRegistry::registerFunction(const std::string& name, void* addr, int length,
                                                llvm::Function* llvm_func) {
     assert(addr);
@@ -0,0 +1,291 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codegen/compile_queue.h"
+
+#include <atomic>
+#include <deque>
+#include <pthread.h>
+
+#include "llvm/ADT/DenseSet.h"
+
+#include "codegen/codegen.h"
+#include "codegen/osrentry.h"
+#include "core/options.h"
+#include "core/stats.h"
+#include "core/threading.h"
+#include "core/util.h"
+#include "runtime/types.h"
+
+namespace pyston {
+
+namespace {
+struct CompileRequest {
+    BoxedCode* code; // owned reference
+    FunctionSpecialization* spec;
+    EffortLevel effort;
+    OSREntryDescriptor* entry; // non-NULL for OSR-entry compiles
+    uint64_t enqueued_at;
+
+    std::pair<BoxedCode*, BST_Jump*> key() const { return std::make_pair(code, entry ? entry->backedge : NULL); }
+};
+}
+
+// Protects the queue itself; the compiler threads wait on it without holding the GIL.
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_nonempty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_idle = PTHREAD_COND_INITIALIZER;
+static std::deque<CompileRequest> queue;
+static int num_in_flight = 0;
+
+// These are only accessed with the GIL held:
+static llvm::DenseSet<std::pair<BoxedCode*, BST_Jump*>> pending;
+static int num_threads_started = 0;
+static bool shutting_down = false;
+
+// llvm_busy only gets modified with the GIL held, but gets waited on without it:
+static pthread_mutex_t llvm_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t llvm_available = PTHREAD_COND_INITIALIZER;
+static std::atomic<bool> llvm_busy(false);
+
+static __thread bool is_compile_thread = false;
+
+static StatCounter num_background_compiles_queued("num_background_compiles_queued");
+static StatCounter num_background_compiles_dropped("num_background_compiles_dropped");
+
+static void updateQueueDepthStats() {
+    static uint64_t* depth = Stats::getStatCounter("background_compile_queue_depth");
+    static uint64_t* max_depth = Stats::getStatCounter("background_compile_queue_depth_max");
+    if (!depth)
+        return;
+
+    *depth = queue.size();
+    if (*depth > *max_depth)
+        *max_depth = *depth;
+}
+
+LLVMCompileRegion::LLVMCompileRegion() {
+    // Whoever holds the region might be a compiler thread that is currently running without the GIL, and
+    // it will need the GIL again to finish; so wait for it with the GIL released.
+    while (llvm_busy.load()) {
+        static StatCounter num_llvm_region_waits("num_background_compile_llvm_waits");
+        num_llvm_region_waits.log();
+
+        threading::GLAllowThreadsReadRegion _allow_threads;
+        pthread_mutex_lock(&llvm_lock);
+        while (llvm_busy.load())
+            pthread_cond_wait(&llvm_available, &llvm_lock);
+        pthread_mutex_unlock(&llvm_lock);
+    }
+    llvm_busy = true;
+}
+
+LLVMCompileRegion::~LLVMCompileRegion() {
+    pthread_mutex_lock(&llvm_lock);
+    llvm_busy = false;
+    pthread_cond_broadcast(&llvm_available);
+    pthread_mutex_unlock(&llvm_lock);
+}
+
+BackgroundCompileUnlockedRegion::BackgroundCompileUnlockedRegion() : released(is_compile_thread), start(0) {
+    if (released) {
+        start = getCPUTicks();
+        threading::beginAllowThreads();
+    }
+}
+
+BackgroundCompileUnlockedRegion::~BackgroundCompileUnlockedRegion() {
+    if (released) {
+        threading::endAllowThreads();
+
+        // Compare with us_background_compiling to see how much of the work happens without the GIL:
+        static StatCounter us_background_compiling_unlocked("us_background_compiling_unlocked");
+        us_background_compiling_unlocked.log(getCPUTicks() - start);
+    }
+}
+
+static void runCompileRequest(const CompileRequest& req) {
+    static StatCounter num_background_compiles("num_background_compiles");
+    static StatCounter us_background_compiling("us_background_compiling");
+    static StatCounter us_background_install_latency("us_background_compile_install_latency");
+
+    BoxedCode* code = req.code;
+    uint64_t start = getCPUTicks();
+
+    if (req.entry) {
+        compileFunction(code, NULL, EffortLevel::MAXIMAL, req.entry, true, req.entry->exception_style);
+    } else {
+        // this pushes the new CompiledFunction to the back of the version list:
+        compileFunction(code, req.spec, req.effort, NULL);
+
+        // Callsites that got rewritten to call into the interpreter need to start using the new version:
+        code->dependent_interp_callsites.invalidateAll();
+    }
+
+    pending.erase(req.key());
+
+    uint64_t end = getCPUTicks();
+    num_background_compiles.log();
+    us_background_compiling.log(end - start);
+    us_background_install_latency.log(end - req.enqueued_at);
+
+    Py_DECREF(code);
+}
+
+static void* compileThreadMain(Box*, Box*, Box*) {
+    is_compile_thread = true;
+
+    // We never exit this loop: at shutdown, the queue stops accepting requests and we just stay blocked
+    // (without holding the GIL) until the process exits.
+    while (true) {
+        CompileRequest req;
+        {
+            threading::GLAllowThreadsReadRegion _allow_threads;
+
+            pthread_mutex_lock(&queue_lock);
+            while (queue.empty())
+                pthread_cond_wait(&queue_nonempty, &queue_lock);
+
+            req = queue.front();
+            queue.pop_front();
+            num_in_flight++;
+            updateQueueDepthStats();
+            pthread_mutex_unlock(&queue_lock);
+        }
+
+        runCompileRequest(req);
+
+        pthread_mutex_lock(&queue_lock);
+        num_in_flight--;
+        pthread_cond_broadcast(&queue_idle);
+        pthread_mutex_unlock(&queue_lock);
+    }
+
+    return NULL;
+}
+
+// The compiler threads don't survive a fork.  Forget about them (they will get restarted on demand), and reset
+// the state they might have owned at the time of the fork.  If a thread was in the middle of running the LLVM
+// passes its module just gets leaked.
+static void compileQueueAfterForkChild() {
+    pthread_mutex_init(&queue_lock, NULL);
+    pthread_mutex_init(&llvm_lock, NULL);
+    pthread_cond_init(&queue_nonempty, NULL);
+    pthread_cond_init(&queue_idle, NULL);
+    pthread_cond_init(&llvm_available, NULL);
+
+    if (llvm_busy.load()) {
+        g.cur_module = NULL;
+        llvm_busy = false;
+    }
+
+    num_threads_started = 0;
+    num_in_flight = 0;
+
+    // Requests that were being compiled are lost; only the queued ones are still pending.
+    pending.clear();
+    for (auto&& req : queue)
+        pending.insert(req.key());
+}
+
+static void startCompileThreads() {
+    static bool registered_fork_handler = false;
+    if (!registered_fork_handler) {
+        pthread_atfork(NULL, NULL, compileQueueAfterForkChild);
+        registered_fork_handler = true;
+    }
+
+    while (num_threads_started < BACKGROUND_COMPILE_THREADS) {
+        threading::start_thread(&compileThreadMain, NULL, NULL, NULL);
+        num_threads_started++;
+    }
+}
+
+static bool enqueue(BoxedCode* code, FunctionSpecialization* spec, EffortLevel effort, OSREntryDescriptor* entry) {
+    if (shutting_down || BACKGROUND_COMPILE_THREADS <= 0)
+        return false;
+
+    CompileRequest req;
+    req.code = code;
+    req.spec = spec;
+    req.effort = effort;
+    req.entry = entry;
+    req.enqueued_at = getCPUTicks();
+
+    auto key = req.key();
+    if (pending.count(key)) {
+        delete spec;
+        delete entry;
+        return true;
+    }
+
+    startCompileThreads();
+
+    pending.insert(key);
+    Py_INCREF(code);
+    num_background_compiles_queued.log();
+
+    pthread_mutex_lock(&queue_lock);
+    queue.push_back(req);
+    updateQueueDepthStats();
+    pthread_cond_signal(&queue_nonempty);
+    pthread_mutex_unlock(&queue_lock);
+
+    return true;
+}
+
+bool enqueueBackgroundCompile(BoxedCode* code, FunctionSpecialization* spec, EffortLevel effort) {
+    assert(spec);
+    return enqueue(code, spec, effort, NULL);
+}
+
+bool enqueueBackgroundOSRCompile(BoxedCode* code, OSREntryDescriptor* entry) {
+    assert(entry && entry->code == code);
+    return enqueue(code, NULL, EffortLevel::MAXIMAL, entry);
+}
+
+bool isBackgroundCompilePending(BoxedCode* code, BST_Jump* backedge) {
+    if (pending.empty())
+        return false;
+    return pending.count(std::make_pair(code, backedge));
+}
+
+void shutdownCompileQueue() {
+    if (!num_threads_started)
+        return;
+
+    shutting_down = true;
+
+    std::deque<CompileRequest> dropped;
+    pthread_mutex_lock(&queue_lock);
+    dropped.swap(queue);
+    updateQueueDepthStats();
+    pthread_mutex_unlock(&queue_lock);
+
+    for (auto&& req : dropped) {
+        pending.erase(req.key());
+        delete req.spec;
+        delete req.entry;
+        Py_DECREF(req.code);
+        num_background_compiles_dropped.log();
+    }
+
+    // The compiles that are already running need the GIL to finish:
+    threading::GLAllowThreadsReadRegion _allow_threads;
+    pthread_mutex_lock(&queue_lock);
+    while (num_in_flight)
+        pthread_cond_wait(&queue_idle, &queue_lock);
+    pthread_mutex_unlock(&queue_lock);
+}
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CODEGEN_COMPILEQUEUE_H
+#define PYSTON_CODEGEN_COMPILEQUEUE_H
+
+#include "core/types.h"
+
+namespace pyston {
+
+class BST_Jump;
+class BoxedCode;
+class OSREntryDescriptor;
+
+// Background ("asynchronous") compilation into the LLVM tier.
+//
+// When ENABLE_BACKGROUND_COMPILATION is set, functions that trip the reopt / OSR thresholds get put on a
+// compile queue instead of being compiled on the spot, and keep running in the interpreter / baseline JIT.
+// One or more compiler threads pick the requests up and run the normal compileFunction() path.  They need
+// the GIL for everything that touches the runtime (irgen, type feedback, installing the new version and
+// invalidating the dependent callsites), so the result always gets installed at a point where the
+// mutator threads are at a safepoint; the GIL is only dropped while the LLVM optimization passes and the
+// machine code generation run.  The code generation doesn't drop it if the JIT object cache is disabled, since
+// we use the object cache callbacks to find out where it starts and ends.
+
+// Queues a full-function compile of 'code'.  Takes ownership of 'spec'.
+// Returns false if the request could not be queued and the caller should compile synchronously.
+bool enqueueBackgroundCompile(BoxedCode* code, FunctionSpecialization* spec, EffortLevel effort);
+
+// Queues an OSR-entry compile for the given entry descriptor.  Returns false if the caller should OSR
+// synchronously instead.
+bool enqueueBackgroundOSRCompile(BoxedCode* code, OSREntryDescriptor* entry);
+
+// Returns whether there is a queued or in-progress compile for 'code' (or for its OSR entry at 'backedge').
+bool isBackgroundCompilePending(BoxedCode* code, BST_Jump* backedge = NULL);
+
+// Drops all queued requests and waits for the in-progress ones to finish.  Called at shutdown.
+void shutdownCompileQueue();
+
+// The LLVM state (g.context, g.cur_module, the execution engine) is not thread safe; every compile holds this
+// region for its full duration.  It has to be entered with the GIL held, and releases the GIL while waiting.
+class LLVMCompileRegion {
+public:
+    LLVMCompileRegion();
+    ~LLVMCompileRegion();
+};
+
+// Drops the GIL for the duration of the region if we are running on a background compiler thread.
+// Only code that works purely on LLVM IR or machine code is allowed to run inside it.
+class BackgroundCompileUnlockedRegion {
+private:
+    bool released;
+    uint64_t start;
+
+public:
+    BackgroundCompileUnlockedRegion();
+    ~BackgroundCompileUnlockedRegion();
+};
+}
+
+#endif
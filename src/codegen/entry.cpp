@@ -14,10 +14,16 @@
 
 #include "codegen/entry.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <fcntl.h>
 #include <iostream>
 #include <lz4frame.h>
 #include <openssl/evp.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <unordered_map>
 
 #include "llvm/Analysis/Passes.h"
@@ -38,11 +44,13 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/irgen.h"
 #include "codegen/memmgr.h"
 #include "codegen/profiling/profiling.h"
 #include "codegen/stackmaps.h"
 #include "core/options.h"
+#include "core/stats.h"
 #include "core/types.h"
 #include "core/util.h"
 #include "runtime/objmodel.h"
@@ -121,55 +129,33 @@ static llvm::Module* loadStdlib() {
     return m;
 }
 
-class CompressedFile {
+class Compression {
 public:
-    static bool writeFile(llvm::StringRef file_name, llvm::StringRef data) {
-        std::error_code error_code;
-        llvm::raw_fd_ostream file(file_name, error_code, llvm::sys::fs::F_RW);
-        if (error_code)
-            return false;
-
-        int uncompressed_size = data.size();
-        // Write the uncompressed size to the beginning of the file as a simple checksum.
-        // It looks like each lz4 block has its own data checksum, but we need to also
-        // make sure that we have all the blocks that we expected.
-        // In particular, without this, an empty file seems to be a valid lz4 stream.
-        file.write(reinterpret_cast<const char*>(&uncompressed_size), 4);
-
+    static bool compress(llvm::StringRef data, std::vector<char>& compressed) {
         LZ4F_preferences_t preferences;
         memset(&preferences, 0, sizeof(preferences));
         preferences.frameInfo.contentChecksumFlag = contentChecksumEnabled;
         preferences.frameInfo.contentSize = data.size();
 
-        std::vector<char> compressed;
         size_t max_size = LZ4F_compressFrameBound(data.size(), &preferences);
         compressed.resize(max_size);
         size_t compressed_size = LZ4F_compressFrame(&compressed[0], max_size, data.data(), data.size(), &preferences);
         if (LZ4F_isError(compressed_size))
             return false;
-        file.write(compressed.data(), compressed_size);
+        compressed.resize(compressed_size);
         return true;
     }
 
-    static std::unique_ptr<llvm::MemoryBuffer> getFile(llvm::StringRef file_name) {
-        auto compressed_content = llvm::MemoryBuffer::getFile(file_name, -1, false);
-        if (!compressed_content)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
+    static std::unique_ptr<llvm::MemoryBuffer> decompress(llvm::StringRef compressed, size_t orig_uncompressed_size) {
         LZ4F_decompressionContext_t context;
         LZ4F_createDecompressionContext(&context, LZ4F_VERSION);
 
         LZ4F_frameInfo_t frame_info;
         memset(&frame_info, 0, sizeof(frame_info));
 
-        const char* start = (*compressed_content)->getBufferStart();
+        const char* start = compressed.data();
         size_t pos = 0;
-        size_t compressed_size = (*compressed_content)->getBufferSize();
-        if (compressed_size < 4)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
-        int orig_uncompressed_size = *reinterpret_cast<const int*>(start);
-        pos += 4;
+        size_t compressed_size = compressed.size();
 
         size_t remaining = compressed_size - pos;
         LZ4F_getFrameInfo(context, &frame_info, start + pos, &remaining);
@@ -195,6 +181,8 @@ public:
         if (uncompressed.size() != frame_info.contentSize)
             return std::unique_ptr<llvm::MemoryBuffer>();
 
+        // The uncompressed size works as a simple checksum: it looks like each lz4 block has its own data checksum,
+        // but we need to also make sure that we have all the blocks that we expected.
         if (uncompressed.size() != orig_uncompressed_size)
             return std::unique_ptr<llvm::MemoryBuffer>();
 
@@ -226,22 +214,217 @@ public:
         int ret = EVP_DigestFinal_ex(md_ctx, md_value, &md_len);
         RELEASE_ASSERT(ret == 1, "");
 
+        // Use two digits per byte, so that all hashes have the same length:
         std::string str;
         str.reserve(md_len * 2 + 1);
-        llvm::raw_string_ostream stream(str);
-        for (int i = 0; i < md_len; ++i)
-            stream.write_hex(md_value[i]);
-        return stream.str();
+        for (int i = 0; i < md_len; ++i) {
+            char buf[3];
+            snprintf(buf, sizeof(buf), "%02x", md_value[i]);
+            str += buf;
+        }
+        return str;
     }
 };
 
-PystonObjectCache::PystonObjectCache() {
+// The object cache is a single file, which consists of a list of records:
+//   [ObjectCacheRecordHeader][lz4 compressed object file]
+// Readers mmap the file and index it by scanning over the record headers, which doesn't require touching the object
+// data itself.  The scan stops at the first header which doesn't validate: that's either a record which is still
+// getting written, or one which a writer failed to write completely (short write, crash).
+// Writers hold an exclusive flock() on the file, and write their record right after the last valid one, ie they
+// overwrite whatever a failed writer left behind.  The file never shrinks, so readers can't fault on their mapping.
+// A reader can see a header before the data behind it got written; since we checksum the object data when we use it,
+// that's just a cache miss.
+#define OBJECT_CACHE_RECORD_MAGIC 0x3259484f // "OHY2"
+
+struct ObjectCacheRecordHeader {
+    uint32_t magic;
+    uint32_t header_checksum;   // of the header, with this field set to zero
+    uint32_t data_size;         // size of the compressed data following this header
+    uint32_t uncompressed_size; // size of the object file
+    uint32_t checksum;          // of the compressed data
+    char hash[64];              // the hex encoded module hash
+};
+static_assert(sizeof(ObjectCacheRecordHeader) == 84, "");
+
+static uint32_t objectCacheChecksum(const char* data, size_t size) {
+    // 32bit FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t objectCacheHeaderChecksum(const ObjectCacheRecordHeader* header) {
+    ObjectCacheRecordHeader copy = *header;
+    copy.header_checksum = 0;
+    return objectCacheChecksum((const char*)&copy, sizeof(copy));
+}
+
+PystonObjectCache::PystonObjectCache() : fd(-1), mapped(NULL), mapped_size(0), indexed_size(0) {
+    llvm::SmallString<128> cache_dir;
     llvm::sys::path::home_directory(cache_dir);
     llvm::sys::path::append(cache_dir, ".cache");
     llvm::sys::path::append(cache_dir, "pyston");
-    llvm::sys::path::append(cache_dir, "object_cache");
+    if (!llvm::sys::fs::exists(cache_dir.str()) && llvm::sys::fs::create_directories(cache_dir.str()))
+        return;
+
+    llvm::sys::path::append(cache_dir, "object_cache.pack");
+    cache_file = cache_dir.str();
+
+    openCacheFile();
+    compactCacheFileIfNeeded();
+}
+
+PystonObjectCache::~PystonObjectCache() {
+    closeCacheFile();
+}
+
+void PystonObjectCache::openCacheFile() {
+    fd = open(cache_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1)
+        return;
+    refreshIndex();
+}
+
+void PystonObjectCache::closeCacheFile() {
+    if (mapped)
+        munmap((void*)mapped, mapped_size);
+    if (fd != -1)
+        close(fd);
+
+    fd = -1;
+    mapped = NULL;
+    mapped_size = indexed_size = 0;
+    index.clear();
+}
+
+void PystonObjectCache::refreshIndex() {
+    if (fd == -1)
+        return;
+
+    // If another process compacted the cache, its path points to a new file now; switch over to it.
+    struct stat path_stat, fd_stat;
+    if (fstat(fd, &fd_stat) != 0)
+        return;
+    if (stat(cache_file.c_str(), &path_stat) == 0 && path_stat.st_ino != fd_stat.st_ino) {
+        closeCacheFile();
+        fd = open(cache_file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1 || fstat(fd, &fd_stat) != 0)
+            return;
+    }
+
+    size_t file_size = fd_stat.st_size;
+    if (file_size == mapped_size) {
+        // A writer might have replaced an invalid tail with a record of the same size.
+        if (indexed_size < mapped_size)
+            indexRecords();
+        return;
+    }
+
+    if (mapped)
+        munmap((void*)mapped, mapped_size);
+    mapped = NULL;
+    mapped_size = 0;
+
+    if (file_size == 0)
+        return;
+
+    void* p = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return;
+    mapped = (const char*)p;
+    mapped_size = file_size;
+
+    indexRecords();
+}
+
+void PystonObjectCache::indexRecords() {
+    while (indexed_size + sizeof(ObjectCacheRecordHeader) <= mapped_size) {
+        auto header = reinterpret_cast<const ObjectCacheRecordHeader*>(mapped + indexed_size);
+        if (header->magic != OBJECT_CACHE_RECORD_MAGIC || header->header_checksum != objectCacheHeaderChecksum(header))
+            break;
+
+        size_t record_size = sizeof(ObjectCacheRecordHeader) + header->data_size;
+        if (indexed_size + record_size > mapped_size)
+            break;
+
+        // Later records win, so that a record which was corrupted can get replaced.
+        index[llvm::StringRef(header->hash, sizeof(header->hash))] = indexed_size;
+        indexed_size += record_size;
+    }
+}
+
+bool PystonObjectCache::lockForWriting() {
+    // A compaction might replace the file while we wait for the lock; in that case we have to lock the new one.
+    for (int tries = 0; tries < 3 && fd != -1; tries++) {
+        if (flock(fd, LOCK_EX) != 0)
+            return false;
+
+        struct stat path_stat, fd_stat;
+        if (fstat(fd, &fd_stat) == 0 && stat(cache_file.c_str(), &path_stat) == 0
+            && path_stat.st_ino == fd_stat.st_ino)
+            return true;
+
+        flock(fd, LOCK_UN);
+        refreshIndex();
+    }
+    return false;
+}
+
+const ObjectCacheRecordHeader* PystonObjectCache::lookup(const std::string& hash) {
+    if (!mapped)
+        return NULL;
+
+    auto it = index.find(hash);
+    if (it == index.end())
+        return NULL;
+    return reinterpret_cast<const ObjectCacheRecordHeader*>(mapped + it->second);
+}
+
+void PystonObjectCache::compactCacheFileIfNeeded() {
+    if (fd == -1 || (int)index.size() <= MAX_OBJECT_CACHE_ENTRIES)
+        return;
 
-    cleanupCacheDirectory();
+    // Only one process needs to do this; everyone else just continues using the old file until they notice
+    // that it got replaced.
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+        return;
+
+    // Keep the newest half of the entries.  The file offsets tell us the order in which they got added.
+    std::vector<std::pair<uint64_t, const ObjectCacheRecordHeader*>> records;
+    for (auto&& e : index)
+        records.emplace_back(e.second, reinterpret_cast<const ObjectCacheRecordHeader*>(mapped + e.second));
+    std::sort(records.begin(), records.end());
+    int first_kept = records.size() - MAX_OBJECT_CACHE_ENTRIES / 2;
+
+    std::string tmp_file = cache_file + ".tmp" + std::to_string(getpid());
+    int tmp_fd = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool success = tmp_fd != -1;
+    for (int i = std::max(first_kept, 0); success && i < records.size(); i++) {
+        auto header = records[i].second;
+        size_t record_size = sizeof(ObjectCacheRecordHeader) + header->data_size;
+        success = write(tmp_fd, header, record_size) == (ssize_t)record_size;
+    }
+    if (tmp_fd != -1)
+        close(tmp_fd);
+
+    if (success)
+        success = rename(tmp_file.c_str(), cache_file.c_str()) == 0;
+    if (!success)
+        remove(tmp_file.c_str());
+
+    flock(fd, LOCK_UN);
+
+    if (success) {
+        static StatCounter num_jit_objectcache_compactions("num_jit_objectcache_compactions");
+        num_jit_objectcache_compactions.log();
+
+        closeCacheFile();
+        openCacheFile();
+    }
 }
 
 #if LLVMREV < 216002
@@ -250,15 +433,63 @@ void PystonObjectCache::notifyObjectCompiled(const llvm::Module* M, const llvm::
 void PystonObjectCache::notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef Obj)
 #endif
 {
+    // Takes the GIL again once we are done writing the object:
+    std::unique_ptr<BackgroundCompileUnlockedRegion> unlocked_region = std::move(codegen_unlocked_region);
+
     RELEASE_ASSERT(module_identifier == M->getModuleIdentifier(), "");
     RELEASE_ASSERT(!hash_before_codegen.empty(), "");
+    RELEASE_ASSERT(hash_before_codegen.size() == sizeof(ObjectCacheRecordHeader::hash), "");
 
-    llvm::SmallString<128> cache_file = cache_dir;
-    llvm::sys::path::append(cache_file, hash_before_codegen);
-    if (!llvm::sys::fs::exists(cache_dir.str()) && llvm::sys::fs::create_directories(cache_dir.str()))
+    if (fd == -1)
+        return;
+
+    std::vector<char> compressed;
+    if (!Compression::compress(Obj.getBuffer(), compressed))
         return;
 
-    CompressedFile::writeFile(cache_file, Obj.getBuffer());
+    // Build the whole record up front so that readers see it appear with a single write:
+    std::vector<char> record(sizeof(ObjectCacheRecordHeader) + compressed.size());
+    auto header = reinterpret_cast<ObjectCacheRecordHeader*>(record.data());
+    header->magic = OBJECT_CACHE_RECORD_MAGIC;
+    header->data_size = compressed.size();
+    header->uncompressed_size = Obj.getBufferSize();
+    header->checksum = objectCacheChecksum(compressed.data(), compressed.size());
+    memcpy(header->hash, hash_before_codegen.data(), sizeof(header->hash));
+    header->header_checksum = 0;
+    header->header_checksum = objectCacheHeaderChecksum(header);
+    memcpy(record.data() + sizeof(ObjectCacheRecordHeader), compressed.data(), compressed.size());
+
+    if (!lockForWriting())
+        return;
+
+    // Since nobody else is writing, everything past the last valid record is left over from a failed write.  We only
+    // know where that is if we managed to map and index the whole file.
+    refreshIndex();
+    struct stat fd_stat;
+    if (fstat(fd, &fd_stat) == 0 && (size_t)fd_stat.st_size == mapped_size) {
+        if (indexed_size < mapped_size) {
+            static StatCounter num_jit_objectcache_overwritten_tails("num_jit_objectcache_overwritten_tails");
+            num_jit_objectcache_overwritten_tails.log();
+        }
+
+        ssize_t written = pwrite(fd, record.data(), record.size(), indexed_size);
+        if (written != (ssize_t)record.size()) {
+            // The next writer will overwrite whatever part of the record made it into the file.
+            static StatCounter num_jit_objectcache_failed_writes("num_jit_objectcache_failed_writes");
+            num_jit_objectcache_failed_writes.log();
+        }
+    }
+
+    flock(fd, LOCK_UN);
+}
+
+// LLVM is going to generate the machine code for the module now.
+void PystonObjectCache::noteMiss() {
+    static StatCounter jit_objectcache_misses("num_jit_objectcache_misses");
+    jit_objectcache_misses.log();
+
+    assert(!codegen_unlocked_region);
+    codegen_unlocked_region.reset(new BackgroundCompileUnlockedRegion());
 }
 
 #if LLVMREV < 215566
@@ -268,44 +499,28 @@ std::unique_ptr<llvm::MemoryBuffer> PystonObjectCache::getObject(const llvm::Mod
 #endif
 {
     static StatCounter jit_objectcache_hits("num_jit_objectcache_hits");
-    static StatCounter jit_objectcache_misses("num_jit_objectcache_misses");
 
     module_identifier = M->getModuleIdentifier();
 
     RELEASE_ASSERT(!hash_before_codegen.empty(), "hash should have already got calculated");
 
-    if (!haveCacheFileForHash()) {
-#if 0
-            // This code helps with identifying why we got a cache miss for a file.
-            // - clear the cache directory
-            // - run pyston
-            // - run pyston a second time
-            // - Now look for "*_second.ll" files in the cache directory and compare them to the "*_first.ll" IR dump
-            std::string llvm_ir;
-            llvm::raw_string_ostream sstr(llvm_ir);
-            M->print(sstr, 0);
-            sstr.flush();
-
-            llvm::sys::fs::create_directories(cache_dir.str());
-            std::string filename = cache_dir.str().str() + "/" + module_identifier + "_first.ll";
-            if (llvm::sys::fs::exists(filename))
-                filename = cache_dir.str().str() + "/" + module_identifier + "_second.ll";
-            FILE* f = fopen(filename.c_str(), "wt");
-            ASSERT(f, "%s", strerror(errno));
-            fwrite(llvm_ir.c_str(), 1, llvm_ir.size(), f);
-            fclose(f);
-#endif
+    const ObjectCacheRecordHeader* header = lookup(hash_before_codegen);
+    if (!header) {
+        // This module isn't in our cache
+        noteMiss();
+        return NULL;
+    }
 
-        // This file isn't in our cache
-        jit_objectcache_misses.log();
+    const char* data = reinterpret_cast<const char*>(header + 1);
+    if (objectCacheChecksum(data, header->data_size) != header->checksum) {
+        noteMiss();
         return NULL;
     }
 
-    llvm::SmallString<128> cache_file = cache_dir;
-    llvm::sys::path::append(cache_file, hash_before_codegen);
-    std::unique_ptr<llvm::MemoryBuffer> mem_buff = CompressedFile::getFile(cache_file);
+    std::unique_ptr<llvm::MemoryBuffer> mem_buff
+        = Compression::decompress(llvm::StringRef(data, header->data_size), header->uncompressed_size);
     if (!mem_buff) {
-        jit_objectcache_misses.log();
+        noteMiss();
         return NULL;
     }
 
@@ -313,32 +528,6 @@ std::unique_ptr<llvm::MemoryBuffer> PystonObjectCache::getObject(const llvm::Mod
     return mem_buff;
 }
 
-void PystonObjectCache::cleanupCacheDirectory() {
-    // Find all files inside the cache directory, if the number of files is larger than
-    // MAX_OBJECT_CACHE_ENTRIES,
-    // sort them by last modification time and remove the oldest excessive ones.
-    typedef std::pair<std::string, llvm::sys::TimeValue> CacheFileEntry;
-    std::vector<CacheFileEntry> cache_files;
-
-    std::error_code ec;
-    for (llvm::sys::fs::directory_iterator file(cache_dir.str(), ec), end; !ec && file != end; file.increment(ec)) {
-        llvm::sys::fs::file_status status;
-        if (file->status(status))
-            continue; // ignore files where we can't retrieve the file status.
-        cache_files.emplace_back(std::make_pair(file->path(), status.getLastModificationTime()));
-    }
-
-    int num_expired = cache_files.size() - MAX_OBJECT_CACHE_ENTRIES;
-    if (num_expired <= 0)
-        return;
-
-    std::stable_sort(cache_files.begin(), cache_files.end(),
-                     [](const CacheFileEntry& lhs, const CacheFileEntry& rhs) { return lhs.second < rhs.second; });
-
-    for (int i = 0; i < num_expired; ++i)
-        llvm::sys::fs::remove(cache_files[i].first);
-}
-
 void PystonObjectCache::calculateModuleHash(const llvm::Module* M, EffortLevel effort) {
     HashOStream hash_stream;
     llvm::WriteBitcodeToFile(M, hash_stream);
@@ -347,10 +536,13 @@ void PystonObjectCache::calculateModuleHash(const llvm::Module* M, EffortLevel e
     hash_before_codegen = hash_stream.getHash();
 }
 
-bool PystonObjectCache::haveCacheFileForHash() {
-    llvm::SmallString<128> cache_file = cache_dir;
-    llvm::sys::path::append(cache_file, hash_before_codegen);
-    return llvm::sys::fs::exists(cache_file.str());
+bool PystonObjectCache::haveCacheEntryForHash() {
+    if (lookup(hash_before_codegen))
+        return true;
+
+    // Another process might have added it since we last looked:
+    refreshIndex();
+    return lookup(hash_before_codegen) != NULL;
 }
 
 
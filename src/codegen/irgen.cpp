@@ -41,6 +41,7 @@
 #include "analysis/scoping_analysis.h"
 #include "analysis/type_analysis.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/gcbuilder.h"
 #include "codegen/irgen/irgenerator.h"
@@ -51,6 +52,7 @@
 #include "codegen/osrentry.h"
 #include "codegen/patchpoints.h"
 #include "codegen/stackmaps.h"
+#include "codegen/type_recording.h"
 #include "core/bst.h"
 #include "core/cfg.h"
 #include "core/options.h"
@@ -1111,7 +1113,8 @@ std::pair<CompiledFunction*, llvm::Function*> doCompile(BoxedCode* code, SourceI
     else
         types = doTypeAnalysis(source->cfg, *param_names, spec->arg_types, effort, speculation_level,
                                code->code_constants);
-
+    if (speculation_level != TypeAnalysis::NONE)
+        decayTypeRecorders(source->cfg);
 
     _t2.split();
 
@@ -1175,11 +1178,15 @@ std::pair<CompiledFunction*, llvm::Function*> doCompile(BoxedCode* code, SourceI
     // but the disadvantage that optimizations are not allowed to add new symbolic constants...
     if (ENABLE_JIT_OBJECT_CACHE) {
         g.object_cache->calculateModuleHash(g.cur_module, effort);
-        if (ENABLE_LLVMOPTS && !g.object_cache->haveCacheFileForHash())
+        if (ENABLE_LLVMOPTS && !g.object_cache->haveCacheEntryForHash()) {
+            BackgroundCompileUnlockedRegion _unlocked;
             optimizeIR(f, effort);
+        }
     } else {
-        if (ENABLE_LLVMOPTS)
+        if (ENABLE_LLVMOPTS) {
+            BackgroundCompileUnlockedRegion _unlocked;
             optimizeIR(f, effort);
+        }
     }
 
     g.cur_module = NULL;
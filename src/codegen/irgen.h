@@ -17,6 +17,7 @@
 
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Function.h"
@@ -180,14 +181,35 @@ public:
 };
 
 
+struct ObjectCacheRecordHeader;
+class BackgroundCompileUnlockedRegion;
 class PystonObjectCache : public llvm::ObjectCache {
 private:
-    llvm::SmallString<128> cache_dir;
+    // All cached objects live in a single file, which we mmap and index by module hash.
+    std::string cache_file;
+    int fd;
+    const char* mapped;
+    size_t mapped_size;
+    size_t indexed_size;             // how far into the file we have scanned the records
+    llvm::StringMap<uint64_t> index; // module hash -> offset of the record
     std::string module_identifier;
     std::string hash_before_codegen;
+    // On a background compiler thread, LLVM generates the machine code without the GIL: from the cache miss in
+    // getObject() until notifyObjectCompiled().  Loading the object afterwards calls back into the runtime.
+    std::unique_ptr<BackgroundCompileUnlockedRegion> codegen_unlocked_region;
+
+    void openCacheFile();
+    void closeCacheFile();
+    void refreshIndex();
+    void indexRecords();
+    bool lockForWriting();
+    void compactCacheFileIfNeeded();
+    const ObjectCacheRecordHeader* lookup(const std::string& hash);
+    void noteMiss();
 
 public:
     PystonObjectCache();
+    ~PystonObjectCache();
 
 
 #if LLVMREV < 216002
@@ -202,10 +224,8 @@ public:
     virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* M);
 #endif
 
-    void cleanupCacheDirectory();
-
     void calculateModuleHash(const llvm::Module* M, EffortLevel effort);
-    bool haveCacheFileForHash();
+    bool haveCacheEntryForHash();
 };
 
 class IRGenState;
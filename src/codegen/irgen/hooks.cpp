@@ -33,6 +33,7 @@
 #include "codegen/ast_interpreter.h"
 #include "codegen/baseline_jit.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/irgen.h"
 #include "codegen/irgen/future.h"
@@ -40,6 +41,8 @@
 #include "codegen/osrentry.h"
 #include "codegen/parser.h"
 #include "codegen/patchpoints.h"
+#include "codegen/profile_cache.h"
+#include "codegen/serialize_cfg.h"
 #include "codegen/stackmaps.h"
 #include "codegen/unwinding.h"
 #include "core/bst.h"
@@ -108,11 +111,13 @@ static void compileIR(CompiledFunction* cf, llvm::Function* func, EffortLevel ef
 
 // Compiles a new version of the function with the given signature and adds it to the list;
 // should only be called after checking to see if the other versions would work.
-// The codegen_lock needs to be held in W mode before calling this function:
+// The GIL needs to be held before calling this function; it might get released while waiting for a concurrent
+// background compile to finish.
 CompiledFunction* compileFunction(BoxedCode* code, FunctionSpecialization* spec, EffortLevel effort,
                                   const OSREntryDescriptor* entry_descriptor, bool force_exception_style,
                                   ExceptionStyle forced_exception_style) {
     UNAVOIDABLE_STAT_TIMER(t0, "us_timer_compileFunction");
+    LLVMCompileRegion _llvm_region;
     Timer _t("for compileFunction()", 1000);
 
     assert((entry_descriptor != NULL) + (spec != NULL) == 1);
@@ -120,6 +125,9 @@ CompiledFunction* compileFunction(BoxedCode* code, FunctionSpecialization* spec,
     SourceInfo* source = code->source.get();
     assert(source);
 
+    if (ENABLE_PROFILE_CACHE)
+        profileCacheNoteTierUp(code);
+
     BoxedString* name = code->name;
 
     ASSERT(code->versions.size() < 20, "%s %u", name->c_str(), code->versions.size());
@@ -176,8 +184,7 @@ CompiledFunction* compileFunction(BoxedCode* code, FunctionSpecialization* spec,
         printf("%s", ss.str().c_str());
     }
 
-    assert(source->cfg);
-
+    code->ensureCFG();
 
     CompiledFunction* cf = NULL;
     llvm::Function* func = NULL;
@@ -224,16 +231,7 @@ CompiledFunction* compileFunction(BoxedCode* code, FunctionSpecialization* spec,
     return cf;
 }
 
-void compileAndRunModule(AST_Module* m, BoxedModule* bm) {
-    Timer _t("for compileModule()");
-
-    const char* fn = PyModule_GetFilename(bm);
-    RELEASE_ASSERT(fn, "");
-
-    FutureFlags future_flags = getFutureFlags(m->body, fn);
-    BoxedCode* code = computeAllCFGs(m, /* globals_from_module */ true, future_flags, autoDecref(boxString(fn)), bm);
-    AUTO_DECREF(code);
-
+static void runModuleCode(BoxedCode* code, BoxedModule* bm) {
     static BoxedString* doc_str = getStaticString("__doc__");
     bm->setattr(doc_str, code->_doc, NULL);
 
@@ -247,6 +245,59 @@ void compileAndRunModule(AST_Module* m, BoxedModule* bm) {
     Py_DECREF(r);
 }
 
+void compileAndRunModule(AST_Module* m, BoxedModule* bm, std::unique_ptr<ASTAllocator> ast_allocator) {
+    Timer _t("for compileModule()");
+
+    const char* fn = PyModule_GetFilename(bm);
+    RELEASE_ASSERT(fn, "");
+
+    FutureFlags future_flags = getFutureFlags(m->body, fn);
+    BoxedCode* code = computeAllCFGs(m, /* globals_from_module */ true, future_flags, autoDecref(boxString(fn)), bm,
+                                     std::move(ast_allocator));
+    AUTO_DECREF(code);
+
+    runModuleCode(code, bm);
+}
+
+void cachingCompileAndRunModule(const char* fn, BoxedModule* bm) {
+    BoxedString* boxed_fn = boxString(fn);
+    AUTO_DECREF(boxed_fn);
+
+    std::vector<char> cached_bytecode;
+    AST_Module* m;
+    std::unique_ptr<ASTAllocator> ast_allocator;
+    std::tie(m, ast_allocator)
+        = caching_parse_file(fn, /* future_flags = */ 0, false, ENABLE_BYTECODE_CACHE ? &cached_bytecode : NULL);
+
+    BoxedCode* code = NULL;
+    if (!m) {
+        code = deserializeCFG(std::move(cached_bytecode), boxed_fn, bm);
+        if (!code) {
+            static StatCounter num_pyc_bytecode_invalid("num_pyc_bytecode_invalid");
+            num_pyc_bytecode_invalid.log();
+            std::tie(m, ast_allocator) = caching_parse_file(fn, /* future_flags = */ 0);
+        }
+    }
+
+    if (!code) {
+        Timer _t("for compileModule()");
+
+        FutureFlags future_flags = getFutureFlags(m->body, fn);
+        // The serializer needs all the CFGs anyway, so only defer computing them if we don't write the cache.
+        code = computeAllCFGs(m, /* globals_from_module */ true, future_flags, boxed_fn, bm,
+                              ENABLE_BYTECODE_CACHE ? nullptr : std::move(ast_allocator));
+
+        if (ENABLE_BYTECODE_CACHE) {
+            std::vector<char> bytecode;
+            if (serializeCFG(code, bytecode))
+                cache_module_bytecode(fn, bytecode);
+        }
+    }
+    AUTO_DECREF(code);
+
+    runModuleCode(code, bm);
+}
+
 Box* evalOrExec(BoxedCode* code, Box* globals, Box* boxedLocals) {
     RELEASE_ASSERT(!code->source->scoping.areGlobalsFromModule(), "");
 
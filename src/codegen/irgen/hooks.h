@@ -15,6 +15,7 @@
 #ifndef PYSTON_CODEGEN_IRGEN_HOOKS_H
 #define PYSTON_CODEGEN_IRGEN_HOOKS_H
 
+#include <memory>
 #include <string>
 
 #include "core/types.h"
@@ -31,9 +32,13 @@ void* compilePartialFunc(OSRExit*);
 extern "C" CompiledFunction* reoptCompiledFuncInternal(CompiledFunction*);
 extern "C" char* reoptCompiledFunc(CompiledFunction*);
 
+class ASTAllocator;
 class AST_Module;
 class BoxedModule;
-void compileAndRunModule(AST_Module* m, BoxedModule* bm);
+// If the allocator of the AST gets passed in, the CFGs of the functions in the module get computed lazily.
+void compileAndRunModule(AST_Module* m, BoxedModule* bm, std::unique_ptr<ASTAllocator> ast_allocator = nullptr);
+// Parses and compiles the module's source file, using the .pyc file as a cache for both the AST and the bytecode.
+void cachingCompileAndRunModule(const char* fn, BoxedModule* bm);
 
 // will we always want to generate unique function names? (ie will this function always be reasonable?)
 CompiledFunction* cfForMachineFunctionName(const std::string&);
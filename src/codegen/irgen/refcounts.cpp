@@ -254,10 +254,29 @@ void addIncrefs(llvm::Value* v, bool nullable, int num_refs, llvm::Instruction*
 
     auto refcount_ptr = builder.CreateConstInBoundsGEP2_32(v, 0, REFCOUNT_IDX);
     auto refcount = builder.CreateLoad(refcount_ptr);
+
+#ifdef Py_IMMORTAL_OBJECTS
+    // Don't touch the refcount of immortal objects (see object.h):
+    if (!nullable) {
+        cur_block = incref_pt->getParent();
+        continue_block = cur_block->splitBasicBlock(incref_pt);
+
+        assert(llvm::isa<llvm::BranchInst>(cur_block->getTerminator()));
+        cur_block->getTerminator()->eraseFromParent();
+        builder.SetInsertPoint(cur_block);
+    }
+
+    auto mortal_block
+        = llvm::BasicBlock::Create(g.context, "incref_mortal", incref_pt->getParent()->getParent(), continue_block);
+    auto is_immortal = builder.CreateICmpSGE(refcount, getConstantInt(_Py_IMMORTAL_REFCNT, g.i64));
+    builder.CreateCondBr(is_immortal, continue_block, mortal_block);
+    builder.SetInsertPoint(mortal_block);
+#endif
+
     auto new_refcount = builder.CreateAdd(refcount, getConstantInt(num_refs, g.i64));
     builder.CreateStore(new_refcount, refcount_ptr);
 
-    if (nullable)
+    if (continue_block)
         builder.CreateBr(continue_block);
 }
 
@@ -845,7 +864,8 @@ void RefcountTracker::addRefcounts(IRGenState* irstate) {
     }
 
     std::vector<llvm::InvokeInst*> invokes;
-    std::vector<llvm::CallInst*> yields;
+    // Adding the increfs and decrefs can split blocks, so remember which block each yield started out in.
+    std::vector<std::pair<llvm::CallInst*, int>> yields;
     for (auto&& II : llvm::inst_range(f)) {
         llvm::Instruction* inst = &II;
 
@@ -853,7 +873,7 @@ void RefcountTracker::addRefcounts(IRGenState* irstate) {
         if (llvm::isa<llvm::CallInst>(inst)) {
             llvm::CallInst* call = llvm::cast<llvm::CallInst>(inst);
             if (call->getCalledValue() == g.funcs.yield_capi)
-                yields.push_back(call);
+                yields.emplace_back(call, bbg.bb_idx[call->getParent()]);
         }
 
         // invoke specific code
@@ -1251,8 +1271,9 @@ void RefcountTracker::addRefcounts(IRGenState* irstate) {
     // we pass all object which we own at the point of the yield call to the yield so that we can traverse them in
     // tp_traverse.
     // we have to create a new call instruction because we can't add arguments to an existing call instruction
-    for (auto&& old_yield : yields) {
-        auto&& state = states[bbg.bb_idx[old_yield->getParent()]];
+    for (auto&& p : yields) {
+        llvm::CallInst* old_yield = p.first;
+        auto&& state = states[p.second];
         assert(old_yield->getNumArgOperands() == 3);
         llvm::Value* yield_value = old_yield->getArgOperand(1);
 
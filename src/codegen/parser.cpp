@@ -23,6 +23,8 @@
 #include <sstream>
 #include <stdint.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
@@ -46,6 +48,11 @@ const char* MAGIC = "a\nCR";
 #define LENGTH_LENGTH sizeof(int)
 #define CHECKSUM_LENGTH 1
 
+// The AST can be followed by a second section with the computed bytecode of the module (see codegen/serialize_cfg.h),
+// which has the same layout (magic string, length, checksum and the data), except that the checksum is a CRC32.
+const char* BYTECODE_MAGIC = "a\nCB";
+#define BYTECODE_CHECKSUM_LENGTH sizeof(uint32_t)
+
 class BufferedReader {
 private:
     static const int BUFSIZE = 1024;
@@ -1101,11 +1108,106 @@ static std::vector<char> _reparse(const char* fn, const std::string& cache_fn, A
     return file_data;
 }
 
+static uint32_t bytecodeChecksum(const char* data, size_t size) {
+    return crc32(0, (const Bytef*)data, size);
+}
+
+// Returns whether there is a valid bytecode section starting at 'start'.
+static bool readBytecodeSection(const std::vector<char>& file_data, int start, std::vector<char>& bytecode) {
+    int header_size = MAGIC_STRING_LENGTH + LENGTH_LENGTH + BYTECODE_CHECKSUM_LENGTH;
+    if (file_data.size() < start + header_size)
+        return false;
+
+    if (strncmp(&file_data[start], BYTECODE_MAGIC, MAGIC_STRING_LENGTH) != 0)
+        return false;
+
+    int length = *reinterpret_cast<const int*>(&file_data[start + MAGIC_STRING_LENGTH]);
+    if (length <= 0 || start + header_size + length != file_data.size())
+        return false;
+
+    uint32_t checksum = *reinterpret_cast<const uint32_t*>(&file_data[start + MAGIC_STRING_LENGTH + LENGTH_LENGTH]);
+    if (checksum != bytecodeChecksum(&file_data[start + header_size], length)) {
+        if (VERBOSITY())
+            fprintf(stderr, "pyc bytecode checksum failed!\n");
+        return false;
+    }
+
+    bytecode.assign(file_data.begin() + start + header_size, file_data.end());
+    return true;
+}
+
+void cache_module_bytecode(const char* fn, const std::vector<char>& bytecode) {
+    std::string cache_fn = std::string(fn) + "c";
+
+    // Only add the bytecode to a .pyc which is still up to date (we just parsed it or wrote it), since
+    // otherwise it might belong to a different version of the source file.
+    struct stat source_stat, cache_stat;
+    if (stat(fn, &source_stat) != 0 || stat(cache_fn.c_str(), &cache_stat) != 0)
+        return;
+    if (cache_stat.st_mtime < source_stat.st_mtime
+        || (cache_stat.st_mtime == source_stat.st_mtime && cache_stat.st_mtim.tv_nsec <= source_stat.st_mtim.tv_nsec))
+        return;
+
+    std::vector<char> file_data;
+    {
+        FileHandle cache_fp(cache_fn.c_str(), "r");
+        if (!cache_fp)
+            return;
+
+        char header[MAGIC_STRING_LENGTH + LENGTH_LENGTH];
+        if (fread(header, 1, sizeof(header), cache_fp) != sizeof(header))
+            return;
+        if (strncmp(header, MAGIC, MAGIC_STRING_LENGTH) != 0)
+            return;
+
+        int length = *reinterpret_cast<int*>(&header[MAGIC_STRING_LENGTH]);
+        long ast_end = MAGIC_STRING_LENGTH + LENGTH_LENGTH + CHECKSUM_LENGTH + length;
+        if (length <= 0 || cache_stat.st_size < ast_end)
+            return;
+
+        // Keep the AST section and replace any existing bytecode section:
+        file_data.resize(ast_end);
+        memcpy(&file_data[0], header, sizeof(header));
+        long rest = ast_end - sizeof(header);
+        if (fread(&file_data[sizeof(header)], 1, rest, cache_fp) != rest)
+            return;
+    }
+
+    int bytecode_length = bytecode.size();
+    static_assert(sizeof(bytecode_length) == LENGTH_LENGTH, "");
+    uint32_t checksum = bytecodeChecksum(bytecode.data(), bytecode.size());
+    static_assert(sizeof(checksum) == BYTECODE_CHECKSUM_LENGTH, "");
+
+    file_data.insert(file_data.end(), BYTECODE_MAGIC, BYTECODE_MAGIC + MAGIC_STRING_LENGTH);
+    file_data.insert(file_data.end(), (char*)&bytecode_length, (char*)&bytecode_length + LENGTH_LENGTH);
+    file_data.insert(file_data.end(), (char*)&checksum, (char*)&checksum + BYTECODE_CHECKSUM_LENGTH);
+    file_data.insert(file_data.end(), bytecode.begin(), bytecode.end());
+
+    // Write a new file and rename it over the old one, so that other processes which import the module at the same
+    // time never see a partially written file.
+    std::string tmp_fn = cache_fn + ".tmp" + std::to_string(getpid());
+    bool success;
+    {
+        FileHandle tmp_fp(tmp_fn.c_str(), "w");
+        if (!tmp_fp)
+            return;
+        success = fwrite(file_data.data(), 1, file_data.size(), tmp_fp) == file_data.size() && fflush(tmp_fp) == 0;
+    }
+    if (success)
+        success = rename(tmp_fn.c_str(), cache_fn.c_str()) == 0;
+    if (!success) {
+        remove(tmp_fn.c_str());
+        if (VERBOSITY())
+            fprintf(stderr, "Warning: could not write the bytecode to %s\n", cache_fn.c_str());
+    }
+}
+
 // Parsing the file is somewhat expensive since we have to shell out to cpython;
 // it's not a huge deal right now, but this caching version can significantly cut down
 // on the startup time (40ms -> 10ms).
 std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const char* fn, FutureFlags inherited_flags,
-                                                                         bool force_reparse) {
+                                                                         bool force_reparse,
+                                                                         std::vector<char>* cached_bytecode) {
     std::ostringstream oss;
 
     UNAVOIDABLE_STAT_TIMER(t0, "us_timer_caching_parse_file");
@@ -1174,6 +1276,7 @@ std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const c
             }
         }
 
+        int ast_end = 0;
         if (good) {
             int length;
             static_assert(sizeof(length) == LENGTH_LENGTH, "");
@@ -1181,7 +1284,8 @@ std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const c
 
             int expected_total_length = MAGIC_STRING_LENGTH + LENGTH_LENGTH + CHECKSUM_LENGTH + length;
 
-            if (expected_total_length != file_data.size()) {
+            // Anything after the AST is the (optional) bytecode section
+            if (length < 0 || expected_total_length > file_data.size()) {
                 oss << "length did not match\n";
                 if (VERBOSITY() || tries == MAX_TRIES) {
                     fprintf(stderr, "Warning: truncated .pyc file found; ignoring\n");
@@ -1190,6 +1294,7 @@ std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const c
             } else {
                 RELEASE_ASSERT(length > 0 && length < 10 * 1048576, "invalid file length: %d (file size is %ld)",
                                length, file_data.size());
+                ast_end = expected_total_length;
             }
         }
 
@@ -1198,7 +1303,7 @@ std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const c
             static_assert(sizeof(checksum) == CHECKSUM_LENGTH, "");
             checksum = *reinterpret_cast<uint8_t*>(&file_data[MAGIC_STRING_LENGTH + LENGTH_LENGTH]);
 
-            for (int i = MAGIC_STRING_LENGTH + LENGTH_LENGTH + CHECKSUM_LENGTH; i < file_data.size(); i++) {
+            for (int i = MAGIC_STRING_LENGTH + LENGTH_LENGTH + CHECKSUM_LENGTH; i < ast_end; i++) {
                 checksum ^= file_data[i];
             }
 
@@ -1210,7 +1315,14 @@ std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const c
             }
         }
 
+        if (good && cached_bytecode && readBytecodeSection(file_data, ast_end, *cached_bytecode)) {
+            static StatCounter num_pyc_bytecode_hits("num_pyc_bytecode_hits");
+            num_pyc_bytecode_hits.log();
+            return std::make_pair((AST_Module*)NULL, std::unique_ptr<ASTAllocator>());
+        }
+
         if (good) {
+            file_data.resize(ast_end);
             std::unique_ptr<BufferedReader> reader(
                 new BufferedReader(file_data, MAGIC_STRING_LENGTH + LENGTH_LENGTH + CHECKSUM_LENGTH));
             AST* rtn = readASTMisc(reader.get());
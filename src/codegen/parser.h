@@ -15,6 +15,8 @@
 #ifndef PYSTON_CODEGEN_PARSER_H
 #define PYSTON_CODEGEN_PARSER_H
 
+#include <vector>
+
 #include "core/ast.h"
 #include "core/types.h"
 
@@ -25,8 +27,13 @@ class ASTAllocator;
 
 std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> parse_string(const char* code, FutureFlags inherited_flags);
 std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> parse_file(const char* fn, FutureFlags inherited_flags);
+// If 'cached_bytecode' is passed and the .pyc file also contains the serialized bytecode of the module, this fills it in
+// and returns a NULL module instead of reading the AST.
 std::pair<AST_Module*, std::unique_ptr<ASTAllocator>> caching_parse_file(const char* fn, FutureFlags inherited_flags,
-                                                                         bool force_reparse = false);
+                                                                         bool force_reparse = false,
+                                                                         std::vector<char>* cached_bytecode = NULL);
+// Adds the serialized bytecode of the module to its .pyc file, if that file is up to date.
+void cache_module_bytecode(const char* fn, const std::vector<char>& bytecode);
 }
 
 #endif
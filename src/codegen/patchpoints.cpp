@@ -151,14 +151,19 @@ static LiveOutSet extractLiveOuts(StackMap::Record* r, llvm::CallingConv::ID cc)
 
 #if !defined(Py_REF_DEBUG) && !defined(Py_TRACE_REFS)
 
-static char decref_code[] = "\x48\xff\x0f"     // decq (%rdi)
+// We skip immortal objects (the upper half of the refcount is nonzero), see object.h.
+static char decref_code[] = "\x83\x7f\x04\x00" // cmpl $0x0,0x4(%rdi)
+                            "\x75\x0c"         // jne +12
+                            "\x48\xff\x0f"     // decq (%rdi)
                             "\x75\x07"         // jne +7
                             "\x48\x8b\x47\x08" // mov 0x8(%rdi),%rax
                             "\xff\x50\x30"     // callq *0x30(%rax)
     ;
 
 static char xdecref_code[] = "\x48\x85\xff"     // test %rdi,%rdi
-                             "\x74\x0c"         // je +12
+                             "\x74\x12"         // je +18
+                             "\x83\x7f\x04\x00" // cmpl $0x0,0x4(%rdi)
+                             "\x75\x0c"         // jne +12
                              "\x48\xff\x0f"     // decq (%rdi)
                              "\x75\x07"         // jne +7
                              "\x48\x8b\x47\x08" // mov 0x8(%rdi),%rax
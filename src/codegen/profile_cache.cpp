@@ -0,0 +1,389 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codegen/profile_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <openssl/evp.h>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+#include "codegen/type_recording.h"
+#include "core/cfg.h"
+#include "core/options.h"
+#include "core/stats.h"
+#include "core/types.h"
+#include "runtime/types.h"
+
+namespace pyston {
+
+// Bump this whenever the bytecode layout or the file format changes.
+#define PROFILE_CACHE_VERSION "pyston-profile-cache 4"
+
+enum ProfileTier {
+    TIER_INTERPRETER = 0,
+    TIER_BASELINE_JIT = 1,
+    TIER_LLVM = 2,
+};
+
+namespace {
+struct FunctionKey {
+    int firstlineno;
+    int bytecode_size;
+    std::string name;
+
+    bool operator<(const FunctionKey& rhs) const {
+        return std::tie(firstlineno, bytecode_size, name) < std::tie(rhs.firstlineno, rhs.bytecode_size, rhs.name);
+    }
+};
+
+struct FunctionProfile {
+    int tier = TIER_INTERPRETER;
+    // bytecode offset -> predicted class
+    std::map<int, BoxedClass*> predictions;
+};
+
+struct FileProfile {
+    std::string hash; // empty if we couldn't read the source file
+    std::map<FunctionKey, FunctionProfile> functions;
+    // Keys which belong to several functions (e.g. two lambdas of the same size on the same line).  We can't tell
+    // which profile belongs to which of them, so we don't cache anything for those.
+    std::set<FunctionKey> ambiguous;
+    // The code object which we saw for each key in this process, to detect the ambiguous ones.
+    std::map<FunctionKey, BoxedCode*> seen_codes;
+};
+}
+
+static std::unordered_map<std::string, FileProfile> file_profiles;
+static llvm::DenseMap<BST_stmt*, BoxedClass*> cached_predictions;
+static llvm::DenseSet<BoxedCode*> applied_codes;
+// Functions which got to a higher tier in this process; we hold a reference to them so that we can still look at
+// their type recorders at exit.
+static std::vector<BoxedCode*> hot_codes;
+static llvm::DenseSet<BoxedCode*> hot_code_set;
+
+static std::string getCacheDir() {
+    llvm::SmallString<128> cache_dir;
+    llvm::sys::path::home_directory(cache_dir);
+    llvm::sys::path::append(cache_dir, ".cache");
+    llvm::sys::path::append(cache_dir, "pyston");
+    llvm::sys::path::append(cache_dir, "profile_cache");
+    return cache_dir.str();
+}
+
+static std::string hashFile(llvm::StringRef filename) {
+    auto content = llvm::MemoryBuffer::getFile(filename, -1, false);
+    if (!content)
+        return "";
+
+    unsigned char md_value[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0;
+    int ret = EVP_Digest((*content)->getBufferStart(), (*content)->getBufferSize(), md_value, &md_len, EVP_sha256(),
+                         NULL);
+    if (ret != 1)
+        return "";
+
+    // Use two digits per byte, so that all hashes have the same length:
+    std::string str;
+    str.reserve(md_len * 2 + 1);
+    for (int i = 0; i < md_len; ++i) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", md_value[i]);
+        str += buf;
+    }
+    return str;
+}
+
+// We only ever speculate on builtin classes, which we can find again by name:
+static bool isCacheableClass(BoxedClass* cls) {
+    return cls && cls->is_constant && !cls->is_user_defined;
+}
+
+static BoxedClass* findBuiltinClass(llvm::StringRef name) {
+    static llvm::StringMap<BoxedClass*> builtin_classes;
+    if (builtin_classes.empty()) {
+        for (BoxedClass* cls : classes) {
+            if (isCacheableClass(cls))
+                builtin_classes[cls->tp_name] = cls;
+        }
+    }
+
+    auto it = builtin_classes.find(name);
+    if (it == builtin_classes.end())
+        return NULL;
+    return it->second;
+}
+
+static FunctionKey getFunctionKey(BoxedCode* code) {
+    return FunctionKey{ code->firstlineno, code->source->cfg->bytecode.getSize(), code->name->s() };
+}
+
+static void loadFileProfile(FileProfile& profile) {
+    std::ifstream f(getCacheDir() + "/" + profile.hash);
+    if (!f)
+        return;
+
+    std::string line;
+    if (!std::getline(f, line) || line != PROFILE_CACHE_VERSION)
+        return;
+
+    FunctionProfile* cur = NULL;
+    while (std::getline(f, line)) {
+        std::istringstream ss(line);
+        std::string kind;
+        ss >> kind;
+        if (kind == "func") {
+            FunctionKey key;
+            int tier;
+            ss >> key.firstlineno >> key.bytecode_size >> tier >> key.name;
+            if (!ss)
+                return;
+            cur = &profile.functions[key];
+            cur->tier = tier;
+        } else if (kind == "ambiguous") {
+            FunctionKey key;
+            ss >> key.firstlineno >> key.bytecode_size >> key.name;
+            if (!ss)
+                return;
+            profile.ambiguous.insert(key);
+            cur = NULL;
+        } else if (kind == "type") {
+            int offset;
+            std::string cls_name;
+            ss >> offset >> cls_name;
+            if (!ss || !cur)
+                return;
+            BoxedClass* cls = findBuiltinClass(cls_name);
+            if (cls)
+                cur->predictions[offset] = cls;
+        } else {
+            return;
+        }
+    }
+}
+
+static FileProfile& getFileProfile(BoxedString* filename) {
+    auto it = file_profiles.find(filename->s());
+    if (it != file_profiles.end())
+        return it->second;
+
+    FileProfile& profile = file_profiles[filename->s()];
+    profile.hash = hashFile(filename->s());
+    if (!profile.hash.empty()) {
+        loadFileProfile(profile);
+        for (auto&& key : profile.ambiguous)
+            profile.functions.erase(key);
+    }
+    return profile;
+}
+
+static void forgetPredictions(BoxedCode* code) {
+    CFG* cfg = code->source->cfg;
+    for (CFGBlock* block : cfg->blocks) {
+        for (BST_stmt* stmt : *block)
+            cached_predictions.erase(stmt);
+    }
+}
+
+// Returns false if other functions have the same key as this one.
+static bool noteFunctionKey(FileProfile& file_profile, BoxedCode* code, const FunctionKey& key) {
+    if (file_profile.ambiguous.count(key))
+        return false;
+
+    BoxedCode*& seen = file_profile.seen_codes[key];
+    if (!seen || seen == code) {
+        seen = code;
+        return true;
+    }
+
+    static StatCounter num_profile_cache_ambiguous_functions("num_profile_cache_ambiguous_functions");
+    num_profile_cache_ambiguous_functions.log();
+
+    // The other function might already be using a profile which was not its own:
+    if (applied_codes.count(seen))
+        forgetPredictions(seen);
+    file_profile.ambiguous.insert(key);
+    file_profile.functions.erase(key);
+    file_profile.seen_codes.erase(key);
+    return false;
+}
+
+// Takes a snapshot of the current type predictions of the function.
+static void recordPredictions(BoxedCode* code, FunctionProfile& profile) {
+    CFG* cfg = code->source->cfg;
+    for (CFGBlock* block : cfg->blocks) {
+        for (BST_stmt* stmt : *block) {
+            BoxedClass* cls = predictClassFor(stmt);
+            if (isCacheableClass(cls))
+                profile.predictions[cfg->bytecode.getOffset(stmt)] = cls;
+        }
+    }
+}
+
+void applyProfileCache(BoxedCode* code) {
+    if (!code->source || !code->source->cfg || !code->filename)
+        return;
+
+    if (!applied_codes.insert(code).second)
+        return;
+
+    FileProfile& file_profile = getFileProfile(code->filename);
+    FunctionKey key = getFunctionKey(code);
+    if (!noteFunctionKey(file_profile, code, key))
+        return;
+    auto it = file_profile.functions.find(key);
+    if (it == file_profile.functions.end())
+        return;
+    FunctionProfile& profile = it->second;
+
+    static StatCounter num_profile_cache_functions_applied("num_profile_cache_functions_applied");
+    num_profile_cache_functions_applied.log();
+
+    // The predictions are keyed by the statements of the bytecode; profileCacheForgetCode removes them again.
+    CFG* cfg = code->source->cfg;
+    for (CFGBlock* block : cfg->blocks) {
+        for (BST_stmt* stmt : *block) {
+            auto pred_it = profile.predictions.find(cfg->bytecode.getOffset(stmt));
+            if (pred_it != profile.predictions.end())
+                cached_predictions[stmt] = pred_it->second;
+        }
+    }
+
+    // Pretend that we already saw enough calls of this function to move it to the tier it got to last time.
+    if (profile.tier >= TIER_LLVM && ENABLE_REOPT)
+        code->times_interpreted = std::max(code->times_interpreted, REOPT_THRESHOLD_BASELINE + 1);
+    else if (profile.tier >= TIER_BASELINE_JIT)
+        code->times_interpreted = std::max(code->times_interpreted, REOPT_THRESHOLD_INTERPRETER);
+}
+
+void profileCacheNoteTierUp(BoxedCode* code) {
+    if (!code->source || !code->filename)
+        return;
+
+    if (hot_code_set.insert(code).second) {
+        Py_INCREF(code);
+        hot_codes.push_back(code);
+    }
+
+    // The baseline JIT code (and with it its type recorders) gets freed once we compile the function with the LLVM
+    // tier, so take the snapshot now:
+    FileProfile& file_profile = getFileProfile(code->filename);
+    FunctionKey key = getFunctionKey(code);
+    if (noteFunctionKey(file_profile, code, key))
+        recordPredictions(code, file_profile.functions[key]);
+}
+
+void profileCacheForgetCode(BoxedCode* code) {
+    if (!applied_codes.erase(code))
+        return;
+
+    forgetPredictions(code);
+
+    auto it = file_profiles.find(code->filename->s());
+    if (it == file_profiles.end())
+        return;
+    auto seen_it = it->second.seen_codes.find(getFunctionKey(code));
+    if (seen_it != it->second.seen_codes.end() && seen_it->second == code)
+        it->second.seen_codes.erase(seen_it);
+}
+
+BoxedClass* profileCachePredictClassFor(BST_stmt* node) {
+    if (cached_predictions.empty())
+        return NULL;
+
+    auto it = cached_predictions.find(node);
+    if (it == cached_predictions.end())
+        return NULL;
+    return it->second;
+}
+
+static void writeFileProfile(const std::string& cache_dir, const FileProfile& profile) {
+    std::string cache_file = cache_dir + "/" + profile.hash;
+    std::string tmp_file = cache_file + ".tmp" + std::to_string(getpid());
+
+    FILE* f = fopen(tmp_file.c_str(), "w");
+    if (!f)
+        return;
+
+    fprintf(f, "%s\n", PROFILE_CACHE_VERSION);
+    for (auto&& key : profile.ambiguous)
+        fprintf(f, "ambiguous %d %d %s\n", key.firstlineno, key.bytecode_size, key.name.c_str());
+    for (auto&& p : profile.functions) {
+        if (p.second.tier == TIER_INTERPRETER)
+            continue;
+
+        fprintf(f, "func %d %d %d %s\n", p.first.firstlineno, p.first.bytecode_size, p.second.tier,
+                p.first.name.c_str());
+        for (auto&& pred : p.second.predictions)
+            fprintf(f, "type %d %s\n", pred.first, pred.second->tp_name);
+    }
+    fclose(f);
+
+    // Other processes might be writing the same file; the rename makes sure readers never see a partial one.
+    if (rename(tmp_file.c_str(), cache_file.c_str()) != 0)
+        remove(tmp_file.c_str());
+}
+
+void writeProfileCache() {
+    if (!ENABLE_PROFILE_CACHE || hot_codes.empty())
+        return;
+
+    llvm::DenseSet<FileProfile*> changed;
+    for (BoxedCode* code : hot_codes) {
+        FileProfile& file_profile = getFileProfile(code->filename);
+        if (file_profile.hash.empty())
+            continue;
+        changed.insert(&file_profile);
+
+        FunctionKey key = getFunctionKey(code);
+        if (file_profile.ambiguous.count(key))
+            continue;
+
+        FunctionProfile& profile = file_profile.functions[key];
+        recordPredictions(code, profile);
+
+        int tier = TIER_INTERPRETER;
+        if (!code->versions.empty() || !code->osr_versions.empty())
+            tier = TIER_LLVM;
+        else if (!code->code_blocks.empty())
+            tier = TIER_BASELINE_JIT;
+        profile.tier = std::max(profile.tier, tier);
+    }
+
+    std::string cache_dir = getCacheDir();
+    if (!llvm::sys::fs::exists(cache_dir) && llvm::sys::fs::create_directories(cache_dir))
+        return;
+
+    for (FileProfile* file_profile : changed)
+        writeFileProfile(cache_dir, *file_profile);
+
+    for (BoxedCode* code : hot_codes)
+        Py_DECREF(code);
+    hot_codes.clear();
+    hot_code_set.clear();
+}
+}
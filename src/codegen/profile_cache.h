@@ -0,0 +1,51 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CODEGEN_PROFILECACHE_H
+#define PYSTON_CODEGEN_PROFILECACHE_H
+
+namespace pyston {
+
+class BST_stmt;
+class BoxedClass;
+class BoxedCode;
+
+// Persistent warmup ("profile") cache.
+//
+// When ENABLE_PROFILE_CACHE is set, we remember which functions made it into the baseline JIT or the LLVM tier,
+// together with the classes that their type recorders predicted, and write that out at exit into
+// ~/.cache/pyston/profile_cache, keyed by the hash of the source file.  Functions are identified by their
+// first line, name and bytecode size (functions which we can't tell apart that way don't get cached), and statements
+// by their offset into the function's bytecode.
+// A later process which runs the same source file then moves those functions straight to the same tier,
+// and the LLVM tier uses the cached predictions for statements which don't have type feedback of their own.
+// Only predictions of builtin classes get saved, since those are the only ones we speculate on.
+
+// Called the first time a function gets interpreted.
+void applyProfileCache(BoxedCode* code);
+
+// Called when a function gets baseline-jitted or compiled with the LLVM tier.
+void profileCacheNoteTierUp(BoxedCode* code);
+
+// Called when a code object gets freed, since the cached predictions are keyed by its statements.
+void profileCacheForgetCode(BoxedCode* code);
+
+// Returns the cached prediction for the given statement, if there is one.
+BoxedClass* profileCachePredictClassFor(BST_stmt* node);
+
+// Writes out the profiles of this process.  Called at shutdown.
+void writeProfileCache();
+}
+
+#endif
@@ -0,0 +1,857 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codegen/serialize_cfg.h"
+
+#include <cstring>
+#include <elf.h>
+#include <link.h>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "llvm/ADT/DenseMap.h"
+
+#include "analysis/scoping_analysis.h"
+#include "codegen/irgen/future.h"
+#include "codegen/parser.h"
+#include "core/ast.h"
+#include "core/bst.h"
+#include "core/cfg.h"
+#include "core/stats.h"
+#include "core/types.h"
+#include "runtime/complex.h"
+#include "runtime/long.h"
+#include "runtime/objmodel.h"
+#include "runtime/types.h"
+
+namespace pyston {
+
+// Bump this whenever the layout of the bytecode or of this format changes.
+#define CFG_CACHE_VERSION 5
+
+// Identifies the pyston binary which wrote the data, since the layout of the bytecode can change without anyone
+// remembering to bump CFG_CACHE_VERSION.  This is the GNU build-id of the executable, or its size and mtime if it
+// doesn't have one.
+static const std::string& buildID() {
+    static std::string build_id = []() {
+        std::string id;
+        dl_iterate_phdr([](struct dl_phdr_info* info, size_t size, void* data) -> int {
+            std::string& id = *static_cast<std::string*>(data);
+            for (int i = 0; i < info->dlpi_phnum && id.empty(); i++) {
+                const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+                if (phdr.p_type != PT_NOTE)
+                    continue;
+
+                size_t align = phdr.p_align == 8 ? 8 : 4;
+                auto align_up = [align](size_t n) { return (n + align - 1) & ~(align - 1); };
+                const char* note = (const char*)(info->dlpi_addr + phdr.p_vaddr);
+                const char* end = note + phdr.p_memsz;
+                while (note + sizeof(ElfW(Nhdr)) <= end) {
+                    const ElfW(Nhdr)* nhdr = (const ElfW(Nhdr)*)note;
+                    const char* name = note + sizeof(ElfW(Nhdr));
+                    const char* desc = name + align_up(nhdr->n_namesz);
+                    if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+                        id.assign(desc, nhdr->n_descsz);
+                        break;
+                    }
+                    note = desc + align_up(nhdr->n_descsz);
+                }
+            }
+            // The first entry is the executable itself, we don't care about the shared libraries.
+            return 1;
+        }, &id);
+
+        struct stat exe_stat;
+        if (id.empty() && stat("/proc/self/exe", &exe_stat) == 0)
+            id = std::to_string(exe_stat.st_size) + ":" + std::to_string(exe_stat.st_mtime);
+        return id;
+    }();
+    return build_id;
+}
+
+enum class ConstantKind : unsigned char {
+    Str,
+    Unicode,
+    Int,
+    Float,
+    Long,
+    Imaginary,
+    None,
+    Ellipsis,
+    Code,
+};
+
+// Calls 'f' with the offset of every CFGBlock* which is stored inside the bytecode.
+// Returns false if the bytecode is malformed.
+template <typename Func> static bool forEachBlockSlot(unsigned char* bytecode, int size, Func f) {
+    int offset = 0;
+    while (offset < size) {
+        BST_stmt* stmt = (BST_stmt*)&bytecode[offset];
+        int stmt_size = stmt->size_in_bytes();
+        if (stmt_size <= 0 || offset + stmt_size > size)
+            return false;
+
+        if (stmt->type() == BST_TYPE::Branch) {
+            BST_Branch* branch = bst_cast<BST_Branch>(stmt);
+            f(offset + ((unsigned char*)&branch->iftrue - (unsigned char*)stmt));
+            f(offset + ((unsigned char*)&branch->iffalse - (unsigned char*)stmt));
+        } else if (stmt->type() == BST_TYPE::Jump) {
+            BST_Jump* jump = bst_cast<BST_Jump>(stmt);
+            f(offset + ((unsigned char*)&jump->target - (unsigned char*)stmt));
+        }
+
+        if (stmt->is_invoke()) {
+            f(offset + stmt_size - 2 * sizeof(CFGBlock*));
+            f(offset + stmt_size - sizeof(CFGBlock*));
+        }
+
+        offset += stmt_size;
+    }
+    return true;
+}
+
+class CFGSerializer {
+private:
+    std::vector<char>& out;
+    bool failed;
+
+public:
+    CFGSerializer(std::vector<char>& out) : out(out), failed(false) {}
+
+    template <typename T> void write(T v) { out.insert(out.end(), (char*)&v, (char*)&v + sizeof(v)); }
+
+    void writeString(llvm::StringRef s) {
+        write<int>(s.size());
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    void writeInternedString(InternedString s) {
+        write<bool>(s != InternedString());
+        if (s != InternedString())
+            writeString(s.s());
+    }
+
+    void writeConstant(Box* o) {
+        if (o == Py_None) {
+            write(ConstantKind::None);
+        } else if (o == Ellipsis) {
+            write(ConstantKind::Ellipsis);
+        } else if (o->cls == str_cls) {
+            write(ConstantKind::Str);
+            writeString(static_cast<BoxedString*>(o)->s());
+        } else if (o->cls == unicode_cls) {
+            Box* utf8 = PyUnicode_AsUTF8String(o);
+            if (!utf8) {
+                PyErr_Clear();
+                failed = true;
+                return;
+            }
+            AUTO_DECREF(utf8);
+            write(ConstantKind::Unicode);
+            writeString(static_cast<BoxedString*>(utf8)->s());
+        } else if (o->cls == int_cls) {
+            write(ConstantKind::Int);
+            write<int64_t>(static_cast<BoxedInt*>(o)->n);
+        } else if (o->cls == float_cls) {
+            write(ConstantKind::Float);
+            write<double>(static_cast<BoxedFloat*>(o)->d);
+        } else if (o->cls == long_cls) {
+            Box* s = PyObject_Str(o);
+            if (!s) {
+                PyErr_Clear();
+                failed = true;
+                return;
+            }
+            AUTO_DECREF(s);
+            write(ConstantKind::Long);
+            writeString(static_cast<BoxedString*>(s)->s());
+        } else if (o->cls == complex_cls && static_cast<BoxedComplex*>(o)->real == 0.0) {
+            write(ConstantKind::Imaginary);
+            write<double>(static_cast<BoxedComplex*>(o)->imag);
+        } else if (o->cls == code_cls && static_cast<BoxedCode*>(o)->source) {
+            write(ConstantKind::Code);
+            writeCode(static_cast<BoxedCode*>(o));
+        } else {
+            failed = true;
+        }
+    }
+
+    void writeCode(BoxedCode* code) {
+        code->ensureCFG();
+
+        SourceInfo* source = code->source.get();
+        CFG* cfg = source->cfg;
+        const CodeConstants& code_constants = code->code_constants;
+        const ParamNames& param_names = code->param_names;
+
+        if (!cfg->getVRegInfo().hasVRegsAssigned() || !param_names.all_args_contains_names) {
+            failed = true;
+            return;
+        }
+
+        writeString(code->name->s());
+        write<bool>(code->_doc != Py_None);
+        if (code->_doc != Py_None) {
+            if (code->_doc->cls != str_cls) {
+                failed = true;
+                return;
+            }
+            writeString(static_cast<BoxedString*>(code->_doc)->s());
+        }
+        write<int>(code->firstlineno);
+        write<int>(code->num_args);
+        write<bool>(code->takes_varargs);
+        write<bool>(code->takes_kwargs);
+
+        write<int>(source->ast_type);
+        write<bool>(source->is_generator);
+        write<FutureFlags>(source->future_flags);
+
+        const ScopingResults& scoping = source->scoping;
+        write<bool>(scoping.areLocalsFromModule());
+        write<bool>(scoping.areGlobalsFromModule());
+        write<bool>(scoping.createsClosure());
+        write<bool>(scoping.takesClosure());
+        write<bool>(scoping.passesThroughClosure());
+        write<bool>(scoping.usesNameLookup());
+        write<int>(scoping.createsClosure() ? scoping.getClosureSize() : 0);
+        write<int>(scoping.getAllDerefVarsAndInfo().size());
+        for (auto&& p : scoping.getAllDerefVarsAndInfo()) {
+            writeInternedString(p.first);
+            write<uint64_t>(p.second.num_parents_from_passed_closure);
+            write<uint64_t>(p.second.offset);
+        }
+
+        write<bool>(param_names.has_vararg_name);
+        write<bool>(param_names.has_kwarg_name);
+        write<int>(param_names.totalParameters());
+        for (BST_Name* name : param_names.allArgsAsName()) {
+            writeInternedString(name->id);
+            write(name->lookup_type);
+            write<int>(name->vreg);
+            write<int>(name->closure_offset);
+        }
+
+        // The size of the rest, so that we can skip over it and only read it once the function gets called.
+        int body_size_pos = out.size();
+        write<int>(0);
+        writeBody(code);
+
+        int body_size = out.size() - body_size_pos - sizeof(int);
+        memcpy(&out[body_size_pos], &body_size, sizeof(body_size));
+    }
+
+    void writeBody(BoxedCode* code) {
+        CFG* cfg = code->source->cfg;
+        const CodeConstants& code_constants = code->code_constants;
+
+        llvm::ArrayRef<Box*> constants = code_constants.getAllConstants();
+        write<int>(constants.size());
+        for (Box* o : constants) {
+            writeConstant(o);
+            if (failed)
+                return;
+        }
+
+        write<int>(code_constants.getNumKeywordNames());
+        for (int i = 0; i < code_constants.getNumKeywordNames(); i++) {
+            const std::vector<BoxedString*>* names = code_constants.getKeywordNames(i);
+            write<int>(names->size());
+            for (BoxedString* s : *names)
+                writeString(s->s());
+        }
+
+        writeCFG(cfg);
+        writeVRegInfo(cfg->getVRegInfo());
+    }
+
+    void writeCFG(CFG* cfg) {
+        llvm::DenseMap<CFGBlock*, int> block_positions;
+        for (int i = 0; i < cfg->blocks.size(); i++)
+            block_positions[cfg->blocks[i]] = i;
+
+        write<int>(cfg->blocks.size());
+        for (CFGBlock* block : cfg->blocks) {
+            write<int>(block->idx);
+            write<int>(block->offset_of_first_stmt);
+            write<int>(block->predecessors.size());
+            for (CFGBlock* pred : block->predecessors) {
+                auto it = block_positions.find(pred);
+                if (it == block_positions.end()) {
+                    failed = true;
+                    return;
+                }
+                write<int>(it->second);
+            }
+        }
+
+        int size = cfg->bytecode.getSize();
+        write<int>(size);
+        int bytecode_start = out.size();
+        out.insert(out.end(), cfg->bytecode.getData(), cfg->bytecode.getData() + size);
+
+        // Replace the block pointers with the positions of the blocks:
+        bool valid = forEachBlockSlot(cfg->bytecode.getData(), size, [&](int offset) {
+            CFGBlock* block;
+            memcpy(&block, &cfg->bytecode.getData()[offset], sizeof(block));
+            auto it = block_positions.find(block);
+            if (it == block_positions.end()) {
+                failed = true;
+                return;
+            }
+            intptr_t position = it->second;
+            memcpy(&out[bytecode_start + offset], &position, sizeof(position));
+        });
+        if (!valid) {
+            failed = true;
+            return;
+        }
+
+        // The interpreter's quickening only applies to this process:
+        for (int offset = 0; offset < size;) {
+            BST_stmt* stmt = (BST_stmt*)&out[bytecode_start + offset];
+            stmt->set_quickened(false);
+            offset += stmt->size_in_bytes();
+        }
+    }
+
+    void writeVRegInfo(const VRegInfo& vreg_info) {
+        write<int>(vreg_info.getNumOfUserVisibleVRegs());
+        write<int>(vreg_info.getNumOfCrossBlockVRegs());
+        write<int>(vreg_info.getTotalNumOfVRegs());
+        for (int i = 0; i < vreg_info.getNumOfCrossBlockVRegs(); i++)
+            writeInternedString(vreg_info.getName(i));
+
+#ifndef NDEBUG
+        for (auto* map : { &vreg_info.getUserVisibleSymVRegMap(), &vreg_info.getSymVRegMap() }) {
+            write<int>(map->size());
+            for (auto&& p : *map) {
+                writeInternedString(p.first);
+                write<int>(p.second);
+            }
+        }
+#endif
+    }
+
+    bool serialize(BoxedCode* code) {
+        write<int>(CFG_CACHE_VERSION);
+        writeString(buildID());
+#ifndef NDEBUG
+        write<bool>(true);
+#else
+        write<bool>(false);
+#endif
+        writeCode(code);
+        return !failed;
+    }
+};
+
+// The data of a whole module.  It has to stay around until the bodies of all its functions got deserialized.
+struct SerializedModule {
+    std::vector<char> data;
+    // whether the data contains the vreg maps of the debug build
+    bool has_debug_info;
+
+    InternedStringPool stringpool;
+    BoxedString* fn;
+    BoxedModule* bm;
+    // The modification time of the source file when we loaded the data.
+    struct timespec source_mtime;
+
+    SerializedModule(std::vector<char> data, BoxedString* fn, BoxedModule* bm)
+        : data(std::move(data)), has_debug_info(false), fn(incref(fn)), bm(bm), source_mtime() {}
+    ~SerializedModule() { Py_DECREF(fn); }
+};
+
+class CFGDeserializer {
+private:
+    std::shared_ptr<SerializedModule> module;
+    const std::vector<char>& data;
+    int pos;
+    bool failed;
+    // The indices of the constants which lead from the module's code object to the one we are reading.
+    std::vector<int> constant_path;
+
+    InternedStringPool& stringpool;
+    BoxedString* fn;
+    BoxedModule* bm;
+
+public:
+    CFGDeserializer(std::shared_ptr<SerializedModule> module, int pos, std::vector<int> constant_path = {})
+        : module(std::move(module)),
+          data(this->module->data),
+          pos(pos),
+          failed(false),
+          constant_path(std::move(constant_path)),
+          stringpool(this->module->stringpool),
+          fn(this->module->fn),
+          bm(this->module->bm) {}
+
+    template <typename T> T read() {
+        T v = T();
+        if (failed || pos + sizeof(T) > data.size()) {
+            failed = true;
+            return v;
+        }
+        memcpy(&v, &data[pos], sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    // Reads a count of elements which each take up at least 'min_elt_size' bytes.
+    int readCount(int min_elt_size = 1) {
+        int n = read<int>();
+        if (n < 0 || (long)n * min_elt_size > (long)data.size() - pos)
+            failed = true;
+        return failed ? 0 : n;
+    }
+
+    llvm::StringRef readString() {
+        int size = readCount();
+        if (failed)
+            return "";
+        llvm::StringRef rtn(&data[pos], size);
+        pos += size;
+        return rtn;
+    }
+
+    InternedString readInternedString() {
+        if (!read<bool>())
+            return InternedString();
+        llvm::StringRef s = readString();
+        if (failed)
+            return InternedString();
+        return stringpool.get(s);
+    }
+
+    // Returns an owned reference, or NULL.
+    Box* readConstant(const CodeConstants& code_constants) {
+        ConstantKind kind = read<ConstantKind>();
+        if (failed)
+            return NULL;
+
+        switch (kind) {
+            case ConstantKind::None:
+                return incref(Py_None);
+            case ConstantKind::Ellipsis:
+                return incref(Ellipsis);
+            case ConstantKind::Str: {
+                llvm::StringRef s = readString();
+                if (failed)
+                    return NULL;
+                // we always intern the string constants, see CFGVisitor::createConstObject
+                return internStringMortal(s);
+            }
+            case ConstantKind::Unicode: {
+                llvm::StringRef s = readString();
+                if (failed)
+                    return NULL;
+                return decodeUTF8StringPtr(s);
+            }
+            case ConstantKind::Int: {
+                int64_t n = read<int64_t>();
+                if (failed)
+                    return NULL;
+                return incref(code_constants.getIntConstant(n));
+            }
+            case ConstantKind::Float: {
+                double d = read<double>();
+                if (failed)
+                    return NULL;
+                return incref(code_constants.getFloatConstant(d));
+            }
+            case ConstantKind::Long: {
+                // createLong wants a null terminated string:
+                std::string s = readString().str();
+                if (failed || s.empty())
+                    return NULL;
+                return createLong(s);
+            }
+            case ConstantKind::Imaginary: {
+                double d = read<double>();
+                if (failed)
+                    return NULL;
+                return createPureImaginary(d);
+            }
+            case ConstantKind::Code:
+                return readCode();
+        }
+
+        failed = true;
+        return NULL;
+    }
+
+    BoxedCode* readCode();
+
+    // Reads the constants and the bytecode of the given code object.
+    bool readBody(BoxedCode* code, int body_size) {
+        int body_end = pos + body_size;
+
+        CodeConstants code_constants;
+        int num_constants = readCount();
+        for (int i = 0; i < num_constants && !failed; i++) {
+            constant_path.push_back(i);
+            Box* o = readConstant(code_constants);
+            constant_path.pop_back();
+            if (!o) {
+                failed = true;
+                break;
+            }
+            code_constants.createVRegEntryForConstant(o);
+        }
+
+        int num_keyword_names = readCount();
+        for (int i = 0; i < num_keyword_names && !failed; i++) {
+            int n = readCount();
+            llvm::SmallVector<BoxedString*, 8> keyword_names;
+            for (int j = 0; j < n && !failed; j++)
+                keyword_names.push_back(stringpool.get(readString()).getBox());
+            code_constants.addKeywordNames(keyword_names);
+        }
+
+        std::unique_ptr<CFG> cfg(new CFG());
+        readCFG(cfg.get());
+        readVRegInfo(cfg->getVRegInfo());
+
+        if (failed || pos != body_end)
+            return false;
+
+        code_constants.optimizeSize();
+        code->code_constants = std::move(code_constants);
+        code->source->cfg = cfg.release();
+        return true;
+    }
+
+    void readCFG(CFG* cfg) {
+        int num_blocks = readCount(3 * sizeof(int));
+        for (int i = 0; i < num_blocks && !failed; i++) {
+            CFGBlock* block = new CFGBlock(cfg, read<int>());
+            block->offset_of_first_stmt = read<int>();
+            cfg->blocks.push_back(block);
+            cfg->next_idx = std::max(cfg->next_idx, block->idx + 1);
+        }
+        for (int i = 0; i < num_blocks && !failed; i++) {
+            int num_preds = readCount(sizeof(int));
+            for (int j = 0; j < num_preds && !failed; j++) {
+                int pred = read<int>();
+                if (pred < 0 || pred >= num_blocks) {
+                    failed = true;
+                    break;
+                }
+                cfg->blocks[i]->predecessors.push_back(cfg->blocks[pred]);
+            }
+        }
+
+        int size = readCount();
+        if (failed || size == 0) {
+            failed = true;
+            return;
+        }
+        memcpy(cfg->bytecode.allocate(size), &data[pos], size);
+        pos += size;
+
+        for (CFGBlock* block : cfg->blocks) {
+            if (block->offset_of_first_stmt < 0 || block->offset_of_first_stmt > size)
+                failed = true;
+        }
+
+        unsigned char* bytecode = cfg->bytecode.getData();
+        bool valid = forEachBlockSlot(bytecode, size, [&](int offset) {
+            intptr_t position;
+            memcpy(&position, &bytecode[offset], sizeof(position));
+            if (position < 0 || position >= num_blocks) {
+                failed = true;
+                return;
+            }
+            CFGBlock* block = cfg->blocks[position];
+            memcpy(&bytecode[offset], &block, sizeof(block));
+        });
+        if (!valid)
+            failed = true;
+    }
+
+    void readVRegInfo(VRegInfo& vreg_info) {
+        vreg_info.num_vregs_user_visible = read<int>();
+        vreg_info.num_vregs_cross_block = read<int>();
+        vreg_info.num_vregs = read<int>();
+        if (vreg_info.num_vregs_user_visible < 0 || vreg_info.num_vregs_cross_block < vreg_info.num_vregs_user_visible
+            || vreg_info.num_vregs < vreg_info.num_vregs_cross_block) {
+            failed = true;
+            return;
+        }
+
+        int num_names = vreg_info.num_vregs_cross_block;
+        if (num_names > (long)data.size() - pos) {
+            failed = true;
+            return;
+        }
+        vreg_info.vreg_sym_map.reserve(num_names);
+        for (int i = 0; i < num_names && !failed; i++)
+            vreg_info.vreg_sym_map.push_back(readInternedString());
+
+        if (!module->has_debug_info)
+            return;
+
+#ifndef NDEBUG
+        auto& sym_vreg_map_user_visible = vreg_info.sym_vreg_map_user_visible;
+        auto& sym_vreg_map = vreg_info.sym_vreg_map;
+#else
+        // only the debug build keeps these maps, so just skip over them
+        llvm::DenseMap<InternedString, DefaultedInt<VREG_UNDEFINED>> sym_vreg_map_user_visible, sym_vreg_map;
+#endif
+        for (auto* map : { &sym_vreg_map_user_visible, &sym_vreg_map }) {
+            int n = readCount();
+            for (int i = 0; i < n && !failed; i++) {
+                InternedString name = readInternedString();
+                (*map)[name] = read<int>();
+            }
+        }
+    }
+
+    BoxedCode* deserialize() {
+        if (read<int>() != CFG_CACHE_VERSION)
+            return NULL;
+        if (readString() != buildID())
+            return NULL;
+
+        module->has_debug_info = read<bool>();
+#ifndef NDEBUG
+        // The debug build needs the additional vreg maps
+        if (!module->has_debug_info)
+            return NULL;
+#endif
+
+        BoxedCode* code = readCode();
+        if (failed || pos != data.size()) {
+            Py_XDECREF(code);
+            return NULL;
+        }
+        return code;
+    }
+};
+
+static bool sameScoping(const ScopingResults& a, const ScopingResults& b) {
+    if (a.areLocalsFromModule() != b.areLocalsFromModule() || a.areGlobalsFromModule() != b.areGlobalsFromModule()
+        || a.createsClosure() != b.createsClosure() || a.takesClosure() != b.takesClosure()
+        || a.passesThroughClosure() != b.passesThroughClosure() || a.usesNameLookup() != b.usesNameLookup())
+        return false;
+    if (a.createsClosure() && a.getClosureSize() != b.getClosureSize())
+        return false;
+
+    auto& a_deref = a.getAllDerefVarsAndInfo();
+    auto& b_deref = b.getAllDerefVarsAndInfo();
+    if (a_deref.size() != b_deref.size())
+        return false;
+    for (int i = 0; i < a_deref.size(); i++) {
+        if (a_deref[i].first != b_deref[i].first
+            || a_deref[i].second.num_parents_from_passed_closure != b_deref[i].second.num_parents_from_passed_closure
+            || a_deref[i].second.offset != b_deref[i].second.offset)
+            return false;
+    }
+    return true;
+}
+
+// Returns whether the bytecode of 'b' can be used for 'a': the callers of 'a' and its closure already depend on
+// its signature, parameter vregs and scoping.
+static bool sameInterface(BoxedCode* a, BoxedCode* b) {
+    if (a->name->s() != b->name->s() || a->firstlineno != b->firstlineno || a->num_args != b->num_args
+        || a->takes_varargs != b->takes_varargs || a->takes_kwargs != b->takes_kwargs)
+        return false;
+
+    SourceInfo* a_source = a->source.get();
+    SourceInfo* b_source = b->source.get();
+    if (a_source->ast_type != b_source->ast_type || a_source->is_generator != b_source->is_generator
+        || a_source->future_flags != b_source->future_flags || !sameScoping(a_source->scoping, b_source->scoping))
+        return false;
+
+    const ParamNames& a_params = a->param_names;
+    const ParamNames& b_params = b->param_names;
+    if (!a_params.all_args_contains_names || !b_params.all_args_contains_names
+        || a_params.totalParameters() != b_params.totalParameters()
+        || a_params.has_vararg_name != b_params.has_vararg_name || a_params.has_kwarg_name != b_params.has_kwarg_name)
+        return false;
+    for (int i = 0; i < a_params.totalParameters(); i++) {
+        BST_Name* a_name = a_params.all_args[i].name;
+        BST_Name* b_name = b_params.all_args[i].name;
+        if (a_name->id != b_name->id || a_name->lookup_type != b_name->lookup_type || a_name->vreg != b_name->vreg
+            || a_name->closure_offset != b_name->closure_offset)
+            return false;
+    }
+    return true;
+}
+
+// Deserializes the body of a function the first time it gets called.
+class LazyCFGFromData : public LazyCFG {
+private:
+    std::shared_ptr<SerializedModule> module;
+    int body_pos, body_size;
+    std::vector<int> constant_path;
+
+    // We already handed out the code object, so unlike cachingCompileAndRunModule we can't just use the AST of the
+    // module instead.  Compute the CFGs of the module from the source again and take the one of this function.
+    void computeFromSource(BoxedCode* code) {
+        const char* fn = module->fn->c_str();
+
+        struct stat source_stat;
+        if (stat(fn, &source_stat) != 0 || source_stat.st_mtim.tv_sec != module->source_mtime.tv_sec
+            || source_stat.st_mtim.tv_nsec != module->source_mtime.tv_nsec)
+            raiseExcHelper(SystemError, "invalid bytecode in the .pyc file of %s, and the source file changed", fn);
+
+        AST_Module* m;
+        std::unique_ptr<ASTAllocator> ast_allocator;
+        std::tie(m, ast_allocator) = caching_parse_file(fn, /* future_flags = */ 0);
+        FutureFlags future_flags = getFutureFlags(m->body, fn);
+        BoxedCode* module_code
+            = computeAllCFGs(m, /* globals_from_module */ true, future_flags, module->fn, module->bm);
+        AUTO_DECREF(module_code);
+
+        BoxedCode* fresh = module_code;
+        for (int i : constant_path) {
+            llvm::ArrayRef<Box*> constants = fresh->code_constants.getAllConstants();
+            if (i >= constants.size() || constants[i]->cls != code_cls) {
+                fresh = NULL;
+                break;
+            }
+            fresh = static_cast<BoxedCode*>(constants[i]);
+        }
+
+        if (!fresh || !fresh->source->cfg || !sameInterface(code, fresh))
+            raiseExcHelper(SystemError, "invalid bytecode in the .pyc file of %s, and could not recompute it", fn);
+
+        code->code_constants = std::move(fresh->code_constants);
+        code->source->cfg = fresh->source->cfg;
+        fresh->source->cfg = NULL;
+    }
+
+public:
+    LazyCFGFromData(std::shared_ptr<SerializedModule> module, int body_pos, int body_size,
+                    std::vector<int> constant_path)
+        : module(std::move(module)),
+          body_pos(body_pos),
+          body_size(body_size),
+          constant_path(std::move(constant_path)) {}
+
+    void compute(BoxedCode* code) override {
+        if (CFGDeserializer(module, body_pos, constant_path).readBody(code, body_size))
+            return;
+
+        static StatCounter num_pyc_bytecode_invalid_lazy("num_pyc_bytecode_invalid_lazy");
+        num_pyc_bytecode_invalid_lazy.log();
+
+        // Make sure that nobody else picks up the broken data again:
+        unlink((std::string(module->fn->s()) + "c").c_str());
+
+        computeFromSource(code);
+    }
+};
+
+BoxedCode* CFGDeserializer::readCode() {
+    InternedString name = readInternedString();
+    if (failed || name == InternedString()) {
+        failed = true;
+        return NULL;
+    }
+
+    Box* doc;
+    if (read<bool>())
+        doc = boxString(readString());
+    else
+        doc = incref(Py_None);
+    AUTO_DECREF(doc);
+
+    int firstlineno = read<int>();
+    int num_args = read<int>();
+    bool takes_varargs = read<bool>();
+    bool takes_kwargs = read<bool>();
+
+    int ast_type = read<int>();
+    bool is_generator = read<bool>();
+    FutureFlags future_flags = read<FutureFlags>();
+
+    ScopingResults scoping;
+    scoping.are_locals_from_module = read<bool>();
+    scoping.are_globals_from_module = read<bool>();
+    scoping.creates_closure = read<bool>();
+    scoping.takes_closure = read<bool>();
+    scoping.passes_through_closure = read<bool>();
+    scoping.uses_name_lookup = read<bool>();
+    scoping.closure_size = read<int>();
+    int num_deref = readCount();
+    for (int i = 0; i < num_deref && !failed; i++) {
+        InternedString deref_name = readInternedString();
+        DerefInfo deref_info;
+        deref_info.num_parents_from_passed_closure = read<uint64_t>();
+        deref_info.offset = read<uint64_t>();
+        scoping.deref_info.emplace_back(deref_name, deref_info);
+    }
+
+    std::unique_ptr<SourceInfo> si(new SourceInfo(bm, std::move(scoping), future_flags, ast_type, is_generator));
+
+    bool has_vararg_name = read<bool>();
+    bool has_kwarg_name = read<bool>();
+    int num_params = readCount();
+    std::vector<ParamNames::NameOrStr> names;
+    for (int i = 0; i < num_params && !failed; i++) {
+        InternedString id = readInternedString();
+        BST_Name* name = new BST_Name(id);
+        name->lookup_type = read<ScopeInfo::VarScopeType>();
+        name->vreg = read<int>();
+        name->closure_offset = read<int>();
+        names.emplace_back(name);
+    }
+    ParamNames param_names(std::move(names), has_vararg_name, has_kwarg_name);
+
+    int body_size = readCount();
+    if (failed)
+        return NULL;
+
+    if (param_names.numNormalArgs() != 0 && param_names.numNormalArgs() != num_args) {
+        failed = true;
+        return NULL;
+    }
+
+    // Functions (unlike class bodies, comprehensions and the module itself) don't run when their parent does,
+    // so we only deserialize their bodies once they get called.
+    bool read_lazily = ast_type == AST_TYPE::FunctionDef || ast_type == AST_TYPE::Lambda;
+    if (read_lazily) {
+        si->lazy_cfg.reset(new LazyCFGFromData(module, pos, body_size, constant_path));
+        pos += body_size;
+    }
+
+    BoxedCode* code = new BoxedCode(num_args, takes_varargs, takes_kwargs, firstlineno, std::move(si),
+                                    CodeConstants(), std::move(param_names), fn, name.getBox(), doc);
+    if (!read_lazily && !readBody(code, body_size)) {
+        failed = true;
+        Py_DECREF(code);
+        return NULL;
+    }
+    return code;
+}
+
+bool serializeCFG(BoxedCode* code, std::vector<char>& out) {
+    STAT_TIMER(t0, "us_timer_serialize_cfg", 0);
+    return CFGSerializer(out).serialize(code);
+}
+
+BoxedCode* deserializeCFG(std::vector<char> data, BoxedString* fn, BoxedModule* bm) {
+    STAT_TIMER(t0, "us_timer_deserialize_cfg", 0);
+    auto module = std::make_shared<SerializedModule>(std::move(data), fn, bm);
+    struct stat source_stat;
+    if (stat(fn->c_str(), &source_stat) != 0)
+        return NULL;
+    module->source_mtime = source_stat.st_mtim;
+    return CFGDeserializer(module, 0).deserialize();
+}
+}
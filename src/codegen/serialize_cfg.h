@@ -0,0 +1,39 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CODEGEN_SERIALIZECFG_H
+#define PYSTON_CODEGEN_SERIALIZECFG_H
+
+#include <vector>
+
+namespace pyston {
+
+class BoxedCode;
+class BoxedModule;
+class BoxedString;
+
+// Serializes the output of computeAllCFGs(): the bytecode, constants, vreg assignment and scoping results of the
+// module and of all the functions nested inside of it, so that we can store it in the .pyc file and don't have to
+// recompute it from the AST next time.
+// The format is specific to this build of pyston (the data starts with its build-id); the CFGBlock pointers get
+// stored as block indices.
+// Returns false if the code contains constants which we can't serialize.
+bool serializeCFG(BoxedCode* code, std::vector<char>& out);
+
+// Recreates the code object from the data generated by serializeCFG.  Returns NULL if the data is not valid.
+// The bodies of the nested functions only get deserialized once they get called, which is why this keeps the data.
+BoxedCode* deserializeCFG(std::vector<char> data, BoxedString* fn, BoxedModule* bm);
+}
+
+#endif // PYSTON_CODEGEN_SERIALIZECFG_H
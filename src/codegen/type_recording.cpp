@@ -15,6 +15,8 @@
 #include "codegen/type_recording.h"
 
 #include "asm_writing/icinfo.h"
+#include "codegen/profile_cache.h"
+#include "core/cfg.h"
 #include "core/options.h"
 #include "core/types.h"
 
@@ -37,26 +39,79 @@ Box* recordType(TypeRecorder* self, Box* obj) {
         self->last_count++;
     }
 
-    // printf("Seen %s %ld times\n", getNameOfClass(cls)->c_str(), self->last_count);
+    for (auto& e : self->entries) {
+        if (!e.cls)
+            e.cls = cls;
 
+        if (e.cls == cls) {
+            e.count++;
+            return obj;
+        }
+    }
+
+    self->megamorphic.count++;
     return obj;
 }
 
 BoxedClass* predictClassFor(BST_stmt* node) {
     ICInfo* ic = ICInfo::getICInfoForNode(node);
     if (!ic || !ic->getTypeRecorder())
-        return NULL;
+        return ENABLE_PROFILE_CACHE ? profileCachePredictClassFor(node) : NULL;
 
     return ic->getTypeRecorder()->predict();
 }
 
+int64_t TypeRecorder::totalCount() const {
+    int64_t total = megamorphic.count;
+    for (auto& e : entries)
+        total += e.count;
+    return total;
+}
+
+void TypeRecorder::decay() {
+    for (auto& e : entries)
+        e.count /= 2;
+    megamorphic.count /= 2;
+}
+
+void decayTypeRecorders(CFG* cfg) {
+    for (CFGBlock* block : cfg->blocks) {
+        for (BST_stmt* stmt : *block) {
+            ICInfo* ic = ICInfo::getICInfoForNode(stmt);
+            if (ic && ic->getTypeRecorder())
+                ic->getTypeRecorder()->decay();
+        }
+    }
+}
+
+// We only speculate on a class if all the other classes together were seen at most once for every
+// SPECULATION_MIN_DOMINANCE times that we saw it.  Every miss is a deopt, and CompiledFunction::speculationFailed()
+// throws the function version away after its 4th one: with a 1/20 miss rate that happens after ~80 executions of the
+// site, so we would pay for a full recompile almost immediately.  At 1/1000 the version lives for ~4000 executions,
+// which is in the same range as the ~REOPT_THRESHOLD_T2 observations the profile was gathered from.
+#define SPECULATION_MIN_DOMINANCE 1000
+
 BoxedClass* TypeRecorder::predict() {
     if (!ENABLE_TYPE_FEEDBACK)
         return NULL;
 
+    // A long enough run of the same class means that's what the site produces now, whatever it did before:
     if (last_count > SPECULATION_THRESHOLD)
         return last_seen;
 
-    return NULL;
+    const Entry* best = NULL;
+    for (auto& e : entries) {
+        if (e.cls && (!best || e.count > best->count))
+            best = &e;
+    }
+
+    if (!best || best->count <= SPECULATION_THRESHOLD)
+        return NULL;
+
+    int64_t others = totalCount() - best->count;
+    if (others * SPECULATION_MIN_DOMINANCE > best->count)
+        return NULL;
+
+    return best->cls;
 }
 }
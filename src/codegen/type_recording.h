@@ -22,6 +22,7 @@ namespace pyston {
 class BST_stmt;
 class Box;
 class BoxedClass;
+class CFG;
 
 class TypeRecorder;
 // Have this be a non-function-scoped friend function;
@@ -34,17 +35,40 @@ class TypeRecorder;
 extern "C" Box* recordType(TypeRecorder* recorder, Box* obj);
 class TypeRecorder {
 public:
+    static const int NUM_ENTRIES = 4;
+
+    struct Entry {
+        BoxedClass* cls;
+        int64_t count;
+    };
+
+    // The class we saw last, and how many times in a row we have seen it.
     BoxedClass* last_seen;
     int64_t last_count;
 
-    constexpr TypeRecorder() : last_seen(nullptr), last_count(0) {}
+    // A small polymorphic profile: the first NUM_ENTRIES distinct classes get their own entry, in the order
+    // they were first seen, and observations of any other class get counted in 'megamorphic'.
+    // The counts get halved every time the function gets compiled (see decay()), so old phases fade out.
+    // The baseline JIT emits an inlined version of recordType() which depends on this exact layout.
+    Entry entries[NUM_ENTRIES];
+    Entry megamorphic;
+
+    constexpr TypeRecorder() : last_seen(nullptr), last_count(0), entries{}, megamorphic{ nullptr, 0 } {}
 
+    int64_t totalCount() const;
+    void decay();
+
+    // Returns the class to speculate on: the one we have seen more than SPECULATION_THRESHOLD times in a row,
+    // or else the one which dominates the (decayed) profile of this site.
     BoxedClass* predict();
 
     friend Box* recordType(TypeRecorder*, Box*);
 };
 
 BoxedClass* predictClassFor(BST_stmt* node);
+
+// To be called once the predictions for a compilation of this CFG have been made.
+void decayTypeRecorders(CFG* cfg);
 }
 
 #endif
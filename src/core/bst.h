@@ -155,6 +155,9 @@ private:
 class BST_stmt {
 public:
     static constexpr unsigned char invoke_flag = 64;
+    // Set by the interpreter on statements which it specialized ("quickened") for the operands it saw, see
+    // ASTInterpreter::visit_loadattr and visit_binop.  All other users of the bytecode ignore it.
+    static constexpr unsigned char quickened_flag = 128;
 
     // contains the opcode which can have the invoke bit set which signals that this stmt is inside a invoke and that a
     // pointer to the normal CFGBlock and the exception block follow directly after the last field in the instruction.
@@ -163,9 +166,18 @@ public:
     uint32_t lineno;
 
 
-    BST_TYPE::BST_TYPE type() const { return (BST_TYPE::BST_TYPE)(type_and_flags & (~invoke_flag)); }
+    BST_TYPE::BST_TYPE type() const {
+        return (BST_TYPE::BST_TYPE)(type_and_flags & ~(invoke_flag | quickened_flag));
+    }
 
     bool is_invoke() const { return type_and_flags & invoke_flag; }
+    bool is_quickened() const { return type_and_flags & quickened_flag; }
+    void set_quickened(bool quickened) {
+        if (quickened)
+            type_and_flags |= quickened_flag;
+        else
+            type_and_flags &= ~quickened_flag;
+    }
     CFGBlock* get_normal_block() const {
         assert(is_invoke());
         return ((CFGBlock * const*)&((const unsigned char*)this)[size_in_bytes()])[-2];
@@ -181,7 +193,7 @@ public:
     bool is_terminator() const __attribute__((always_inline)) {
         if (is_invoke())
             return true;
-        switch (type_and_flags) {
+        switch (type()) {
             case BST_TYPE::Assert:
             case BST_TYPE::Branch:
             case BST_TYPE::Jump:
@@ -381,6 +393,8 @@ public:
     int index_attr = VREG_UNDEFINED;
     int vreg_value = VREG_UNDEFINED;
     bool clsonly = false;
+    // index into BoxedCode::interp_attr_caches; gets assigned by the interpreter
+    int cache_slot = -1;
 
     BSTFIXEDVREGS(LoadAttr, BST_stmt_with_dest)
 } PACKED;
@@ -307,20 +307,30 @@ enum Why : int8_t {
 static const Why why_values[] = { FALLTHROUGH, CONTINUE, BREAK, RETURN, EXCEPTION };
 
 // A class that manages the computation of all CFGs in a module
-class ModuleCFGProcessor {
+class ModuleCFGProcessor : public std::enable_shared_from_this<ModuleCFGProcessor> {
 public:
+    // If set, we own the AST and compute the CFGs of nested functions lazily, see LazyCFGFromAST.
+    std::unique_ptr<ASTAllocator> ast_allocator;
+    // For AST nodes which we create while computing the CFGs and which the lazily computed ones can reference.
+    ASTAllocator extra_ast_allocator;
+
     ScopingAnalysis scoping;
     InternedStringPool& stringpool;
     FutureFlags future_flags;
     BoxedString* fn;
     BoxedModule* bm;
 
-    ModuleCFGProcessor(AST* ast, bool globals_from_module, FutureFlags future_flags, BoxedString* fn, BoxedModule* bm)
-        : scoping(ast, globals_from_module),
+    ModuleCFGProcessor(AST* ast, bool globals_from_module, FutureFlags future_flags, BoxedString* fn, BoxedModule* bm,
+                       std::unique_ptr<ASTAllocator> ast_allocator)
+        : ast_allocator(std::move(ast_allocator)),
+          scoping(ast, globals_from_module),
           stringpool(ast->getStringpool()),
           future_flags(future_flags),
-          fn(fn),
+          fn(incref(fn)),
           bm(bm) {}
+    ~ModuleCFGProcessor() { Py_DECREF(fn); }
+
+    bool computesCFGsLazily() const { return (bool)ast_allocator; }
 
     // orig_node is the node from the original ast, but 'ast' can be a desugared version.
     // For example if we convert a generator expression into a function, the new function
@@ -1531,8 +1541,8 @@ private:
     }
 
     TmpValue remapLambda(AST_Lambda* node) {
-        ASTAllocator allocator;
-        auto stmt = new (allocator) AST_Return;
+        // The body might get CFG'ed lazily, so it has to stay around for as long as the AST:
+        auto stmt = new (cfgizer->extra_ast_allocator) AST_Return;
         stmt->lineno = node->lineno;
 
         stmt->value = node->body; // don't remap now; will be CFG'ed later
@@ -1742,6 +1752,15 @@ private:
 
         TmpValue val = createDstName(rtn);
 
+        // Inside of a try the yield is an invoke and ends the block anyway.  Otherwise we end it here, so that no
+        // block-local value lives across the yield: the baseline JIT returns to the interpreter loop at the yields of
+        // stackless generators, and only what is in the vregs survives that.
+        if (exc_handlers.empty()) {
+            CFGBlock* yield_cont = cfg->addDeferredBlock();
+            pushJump(yield_cont);
+            setInsertPoint(yield_cont);
+        }
+
         allocAndPush<BST_UncacheExcInfo>();
 
         if (root_type != AST_TYPE::FunctionDef && root_type != AST_TYPE::Lambda)
@@ -3251,6 +3270,16 @@ static int pruneUnnecessaryBlocks(CFG* rtn) {
 
             assert(last_stmt->type() == BST_TYPE::Jump);
 
+            // Don't undo the split which remapYield() does after a yield:
+            BST_stmt* prev_stmt = NULL;
+            for (BST_stmt* stmt : *b) {
+                if (stmt == last_stmt)
+                    break;
+                prev_stmt = stmt;
+            }
+            if (prev_stmt && prev_stmt->type() == BST_TYPE::Yield)
+                continue;
+
             if (VERBOSITY("cfg") >= 2) {
                 // rtn->print();
                 printf("Joining blocks %d and %d\n", b->idx, b2->idx);
@@ -3515,8 +3544,6 @@ static std::pair<CFG*, CodeConstants> computeCFG(llvm::ArrayRef<AST_stmt*> body,
     static StatCounter bst_bytecode_bytes("num_bst_bytecode_bytes");
     bst_bytecode_bytes.log(rtn->bytecode.getSize());
 
-    // TODO add code which serializes the final bytecode to disk
-
     if (VERBOSITY("cfg") >= 2) {
         printf("Final cfg:\n");
         rtn->print(visitor.code_constants, llvm::outs());
@@ -3526,6 +3553,127 @@ static std::pair<CFG*, CodeConstants> computeCFG(llvm::ArrayRef<AST_stmt*> body,
 }
 
 
+// Keeps the AST (and the scoping analysis) of the whole module alive until the function runs for the first time.
+class LazyCFGFromAST : public LazyCFG {
+private:
+    std::shared_ptr<ModuleCFGProcessor> cfgizer;
+    std::vector<AST_stmt*> body;
+    AST_TYPE::AST_TYPE ast_type;
+    int lineno;
+    AST_arguments* args;
+    ScopeInfo* scope_info;
+
+public:
+    LazyCFGFromAST(std::shared_ptr<ModuleCFGProcessor> cfgizer, llvm::ArrayRef<AST_stmt*> body,
+                   AST_TYPE::AST_TYPE ast_type, int lineno, AST_arguments* args, ScopeInfo* scope_info)
+        : cfgizer(std::move(cfgizer)),
+          body(body.begin(), body.end()),
+          ast_type(ast_type),
+          lineno(lineno),
+          args(args),
+          scope_info(scope_info) {}
+
+    void compute(BoxedCode* code) override {
+        std::tie(code->source->cfg, code->code_constants)
+            = computeCFG(body, ast_type, lineno, args, cfgizer->fn, code->source.get(), code->param_names,
+                         scope_info, cfgizer.get());
+    }
+};
+
+// computeCFG reports a few syntax errors ('return' outside function, 'break' outside loop, ...) which would only get
+// raised on the first call of a function whose CFG gets computed lazily.  So in that case we look for them upfront.
+class LazyCFGSyntaxChecker : public NoopASTVisitor {
+private:
+    BoxedString* filename;
+    bool in_function, in_loop;
+
+    // Visits the nodes as if they were part of a different scope or loop body.
+    template <typename T> void visitNested(const std::vector<T*>& nodes, bool function, bool loop) {
+        LazyCFGSyntaxChecker nested(filename, function, loop);
+        for (auto node : nodes)
+            node->accept(&nested);
+    }
+
+    template <typename T> void visitVector(const std::vector<T*>& nodes) {
+        for (auto node : nodes)
+            node->accept(this);
+    }
+
+public:
+    LazyCFGSyntaxChecker(BoxedString* filename, bool in_function = false, bool in_loop = false)
+        : filename(filename), in_function(in_function), in_loop(in_loop) {}
+
+    bool visit_functiondef(AST_FunctionDef* node) override {
+        visitVector(node->decorator_list);
+        node->args->accept(this);
+        visitNested(node->body, true, false);
+        return true;
+    }
+    bool visit_lambda(AST_Lambda* node) override {
+        node->args->accept(this);
+        visitNested(std::vector<AST_expr*>{ node->body }, true, false);
+        return true;
+    }
+    bool visit_classdef(AST_ClassDef* node) override {
+        visitVector(node->bases);
+        visitVector(node->decorator_list);
+        visitNested(node->body, false, false);
+        return true;
+    }
+    // These get turned into functions (see runRecursively), so they are allowed to contain a yield:
+    bool visit_generatorexp(AST_GeneratorExp* node) override {
+        visitNested(std::vector<AST*>{ node->elt }, true, false);
+        visitNested(node->generators, true, false);
+        return true;
+    }
+    bool visit_dictcomp(AST_DictComp* node) override {
+        visitNested(std::vector<AST*>{ node->key, node->value }, true, false);
+        visitNested(node->generators, true, false);
+        return true;
+    }
+    bool visit_setcomp(AST_SetComp* node) override {
+        visitNested(std::vector<AST*>{ node->elt }, true, false);
+        visitNested(node->generators, true, false);
+        return true;
+    }
+
+    bool visit_for(AST_For* node) override {
+        node->iter->accept(this);
+        node->target->accept(this);
+        visitNested(node->body, in_function, true);
+        visitVector(node->orelse);
+        return true;
+    }
+    bool visit_while(AST_While* node) override {
+        node->test->accept(this);
+        visitNested(node->body, in_function, true);
+        visitVector(node->orelse);
+        return true;
+    }
+
+    bool visit_break(AST_Break* node) override {
+        if (!in_loop)
+            raiseSyntaxError("'break' outside loop", node->lineno, node->col_offset, filename->s(), "", true);
+        return true;
+    }
+    bool visit_continue(AST_Continue* node) override {
+        if (!in_loop)
+            raiseSyntaxError("'continue' not properly in loop", node->lineno, node->col_offset, filename->s(), "",
+                             true);
+        return true;
+    }
+    bool visit_return(AST_Return* node) override {
+        if (!in_function)
+            raiseExcHelper(SyntaxError, "'return' outside function");
+        return false;
+    }
+    bool visit_yield(AST_Yield* node) override {
+        if (!in_function)
+            raiseExcHelper(SyntaxError, "'yield' outside function");
+        return false;
+    }
+};
+
 BoxedCode* ModuleCFGProcessor::runRecursively(llvm::ArrayRef<AST_stmt*> body, BoxedString* name, int lineno,
                                               AST_arguments* args, AST* orig_node) {
     ScopeInfo* scope_info = scoping.getScopeInfoForNode(orig_node);
@@ -3569,9 +3717,19 @@ BoxedCode* ModuleCFGProcessor::runRecursively(llvm::ArrayRef<AST_stmt*> body, Bo
     for (auto e : param_names.allArgsAsName())
         fillScopingInfo(e, scope_info);
 
+    // We can only compute the CFG of a function later if it doesn't run as part of the code which contains it:
+    bool compute_lazily = computesCFGsLazily()
+                          && (orig_node->type == AST_TYPE::FunctionDef || orig_node->type == AST_TYPE::Lambda);
+
     CodeConstants code_constants;
-    std::tie(si->cfg, code_constants)
-        = computeCFG(body, ast_type, lineno, args, fn, si.get(), param_names, scope_info, this);
+    if (compute_lazily) {
+        static StatCounter num_lazy_cfgs("num_lazy_cfgs");
+        num_lazy_cfgs.log();
+        si->lazy_cfg.reset(new LazyCFGFromAST(shared_from_this(), body, ast_type, lineno, args, scope_info));
+    } else {
+        std::tie(si->cfg, code_constants)
+            = computeCFG(body, ast_type, lineno, args, fn, si.get(), param_names, scope_info, this);
+    }
 
     BoxedCode* code;
     if (args)
@@ -3586,9 +3744,15 @@ BoxedCode* ModuleCFGProcessor::runRecursively(llvm::ArrayRef<AST_stmt*> body, Bo
 }
 
 BoxedCode* computeAllCFGs(AST* ast, bool globals_from_module, FutureFlags future_flags, BoxedString* fn,
-                          BoxedModule* bm) {
-    return ModuleCFGProcessor(ast, globals_from_module, future_flags, fn, bm)
-        .runRecursively(ast->getBody(), ast->getName(), ast->lineno, nullptr, ast);
+                          BoxedModule* bm, std::unique_ptr<ASTAllocator> ast_allocator) {
+    if (ast_allocator) {
+        LazyCFGSyntaxChecker checker(fn);
+        ast->accept(&checker);
+    }
+
+    auto cfgizer = std::make_shared<ModuleCFGProcessor>(ast, globals_from_module, future_flags, fn, bm,
+                                                        std::move(ast_allocator));
+    return cfgizer->runRecursively(ast->getBody(), ast->getName(), ast->lineno, nullptr, ast);
 }
 
 void printCFG(CFG* cfg, const CodeConstants& code_constants) {
@@ -27,6 +27,7 @@
  * llvm SSA)
  */
 
+#include <memory>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -38,6 +39,7 @@
 
 namespace pyston {
 
+class ASTAllocator;
 class BST_stmt;
 class Box;
 
@@ -172,6 +174,8 @@ private:
     int num_vregs_user_visible = -1;
     int num_vregs = -1;
 
+    friend class CFGDeserializer;
+
 public:
 #ifndef NDEBUG
     // map of all assigned names. if the name is block local the vreg number is not unique because this vregs get reused
@@ -229,6 +233,8 @@ private:
     int next_idx;
     VRegInfo vreg_info;
 
+    friend class CFGDeserializer;
+
 public:
     std::vector<CFGBlock*> blocks;
     BSTAllocator bytecode;
@@ -412,8 +418,10 @@ public:
     iterator end() const { return iterator(*this, this->v.size()); }
 };
 
+// If the AST gets passed in (together with its allocator), the CFGs of the nested functions only get computed
+// once they get called for the first time.
 BoxedCode* computeAllCFGs(AST* ast, bool globals_from_module, FutureFlags future_flags, BoxedString* fn,
-                          BoxedModule* bm);
+                          BoxedModule* bm, std::unique_ptr<ASTAllocator> ast_allocator = nullptr);
 void printCFG(CFG* cfg, const CodeConstants& code_constants);
 }
 
@@ -0,0 +1,587 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CORE_COMPACTMAP_H
+#define PYSTON_CORE_COMPACTMAP_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "Python.h"
+
+namespace pyston {
+
+// The keys of a CompactMap which are shared between several split maps; see CompactMap::trySplit().
+struct CompactMapSharedKeys {
+    int64_t refcount;
+    uint32_t num_items;
+    uint32_t log2_size;
+    // Followed by the index array and the entries of the map (with space for as many entries as fit into the index
+    // array).  The values in the entries are unused.
+};
+
+// A hash map with the layout of the CPython 3.6 dicts: the hash table itself is only an array of small integers
+// (int8 for small maps, growing to int16/int32/int64 as needed) which index into a dense array of the entries.
+// Compared to DenseMap, which stores the 24-byte buckets inline in a table that is at least 1/3 empty, this saves a
+// lot of memory for the small maps, and iteration only has to walk the index array.
+//
+// The probing, tombstone and growth policies are the same as the ones of our DenseMap (which match CPython 2.7's), and
+// the iteration follows the order of the index array, so the iteration order is the same as before -- python 2 code
+// tends to depend on the iteration order of the dicts matching CPython's.
+//
+// The interface is the subset of DenseMap's that BoxedDict uses, and KeyInfoT is the same as for DenseMap (only
+// isEqual, getHashValue and getTombstoneKey get used).  Some differences to DenseMap:
+// - iterators are positions in the index array.  They don't get invalidated by insertions or removals; if the map
+//   gets resized while iterating, the iteration might skip or repeat entries, but it will stay in bounds.
+// - isEqual is allowed to modify the map (it calls arbitrary Python code for BoxedDict); the lookup gets restarted
+//   in that case.
+// - an all-zeroes object is a valid empty map, which doesn't allocate any memory until the first insertion.
+//
+// Maps can also be "split" (like the PEP 412 dicts of CPython 3.3+): several maps with the same keys, stored in the
+// same layout, share one copy of the index array and the entries, and each of them only stores an array of its values.
+// A split map contains the first num_items of the shared entries; the ones after that got added by other maps.
+// Changing the value of an existing key keeps the map split, and so does adding the next key of the shared keys, or a
+// new key if the map has all of them and the index array doesn't need to grow (which adds it to the shared keys).
+// Any other modification gives the map its own copy of the keys again.
+template <typename KeyT, typename ValueT, typename KeyInfoT> class CompactMap {
+public:
+    struct value_type {
+        KeyT first;
+        ValueT second;
+    };
+    static_assert(std::is_trivially_copyable<value_type>::value, "we memcpy the entries around");
+
+    // What iterators point to.  The key and the value are not necessarily stored next to each other (see trySplit()),
+    // so this is not a value_type&.
+    struct reference {
+        const KeyT& first;
+        ValueT& second;
+    };
+
+    typedef CompactMapSharedKeys SharedKeys;
+
+private:
+    static const int MIN_LOG2_SIZE = 3;
+    static const int64_t IX_EMPTY = -1;
+    static const int64_t IX_DUMMY = -2; // the entry got removed; lookups have to continue probing
+
+    // A single allocation holding the index array, followed by the entries.  For split maps, this points into the
+    // SharedKeys allocation.
+    char* table;
+    union {
+        struct {
+            uint32_t num_tombstones; // number of IX_DUMMY slots in the index array
+            uint32_t num_entries;    // number of used entries, including removed ones
+        };
+        // Split maps don't have tombstones or removed entries, so they can use this space for their values:
+        ValueT* values;
+    };
+    uint32_t num_items; // number of live entries
+    uint8_t log2_size;  // log2 of the length of the index array; 0 if there is no table
+    bool split;
+
+    // The maximum number of live entries: we grow once 2/3 of the index array is used.
+    static size_t capacityFor(int log2_size) { return ((size_t)1 << log2_size) * 2 / 3 + 1; }
+    static int indexShiftFor(int log2_size) {
+        if (log2_size <= 7)
+            return 0;
+        if (log2_size <= 15)
+            return 1;
+        if (log2_size <= 31)
+            return 2;
+        return 3;
+    }
+    static size_t indexBytesFor(int log2_size) { return (size_t)1 << (log2_size + indexShiftFor(log2_size)); }
+    static int log2SizeFor(size_t at_least) {
+        int log2_size = MIN_LOG2_SIZE;
+        while (((size_t)1 << log2_size) < at_least)
+            log2_size++;
+        return log2_size;
+    }
+
+    static int64_t getIndex(const char* table, int log2_size, size_t slot) {
+        switch (indexShiftFor(log2_size)) {
+            case 0:
+                return ((const int8_t*)table)[slot];
+            case 1:
+                return ((const int16_t*)table)[slot];
+            case 2:
+                return ((const int32_t*)table)[slot];
+            default:
+                return ((const int64_t*)table)[slot];
+        }
+    }
+
+    size_t numSlots() const { return table ? (size_t)1 << log2_size : 0; }
+    size_t mask() const { return ((size_t)1 << log2_size) - 1; }
+    size_t capacity() const { return capacityFor(log2_size); }
+    size_t indexBytes() const { return indexBytesFor(log2_size); }
+    value_type* entries() const { return (value_type*)(table + indexBytes()); }
+    int64_t getIndex(size_t slot) const { return getIndex(table, log2_size, slot); }
+
+    void setIndex(size_t slot, int64_t ix) {
+        switch (indexShiftFor(log2_size)) {
+            case 0:
+                ((int8_t*)table)[slot] = ix;
+                break;
+            case 1:
+                ((int16_t*)table)[slot] = ix;
+                break;
+            case 2:
+                ((int32_t*)table)[slot] = ix;
+                break;
+            default:
+                ((int64_t*)table)[slot] = ix;
+                break;
+        }
+    }
+
+    static SharedKeys* sharedKeysOf(char* table) { return (SharedKeys*)table - 1; }
+    static char* tableOf(SharedKeys* keys) { return (char*)(keys + 1); }
+
+    ValueT& valueAt(int64_t ix) const { return split ? values[ix] : entries()[ix].second; }
+
+    // The index stored in the slot as this map sees it: the entries which other maps added to the shared keys are not
+    // part of a split map.
+    int64_t indexAt(size_t slot) const {
+        int64_t ix = getIndex(slot);
+        if (split && ix >= (int64_t)num_items)
+            return IX_EMPTY;
+        return ix;
+    }
+
+    // Gives a split map its own copy of the keys again.  Doesn't change the layout of the map.
+    void unsplit() {
+        assert(split);
+        char* shared_table = table;
+        ValueT* old_values = values;
+
+        table = (char*)PyObject_Malloc(indexBytes() + capacity() * sizeof(value_type));
+        for (size_t slot = 0; slot < numSlots(); slot++) {
+            int64_t ix = getIndex(shared_table, log2_size, slot);
+            setIndex(slot, ix < (int64_t)num_items ? ix : IX_EMPTY);
+        }
+        memcpy(entries(), shared_table + indexBytes(), num_items * sizeof(value_type));
+        for (uint32_t ix = 0; ix < num_items; ix++)
+            entries()[ix].second = old_values[ix];
+        num_tombstones = 0;
+        num_entries = num_items;
+        split = false;
+
+        PyObject_Free(old_values);
+        decrefSharedKeys(sharedKeysOf(shared_table));
+    }
+
+    static bool isRemoved(const value_type& e) { return KeyInfoT::isEqual(e.first, KeyInfoT::getTombstoneKey()); }
+
+    // Returns true and the position of the key in the index array if the key is in the map.  Otherwise, returns false
+    // and the position where the key should get inserted: the first tombstone on the probe sequence, or the empty
+    // slot at its end.
+    bool lookup(const KeyT& key, size_t& found_slot) {
+    restart:
+        if (!table)
+            return false;
+
+        bool found_tombstone = false;
+        size_t perturb = KeyInfoT::getHashValue(key);
+        for (size_t i = perturb & mask();; i = (i * 5 + perturb + 1) & mask(), perturb >>= 5) {
+            int64_t ix = indexAt(i);
+            if (ix == IX_EMPTY) {
+                if (!found_tombstone)
+                    found_slot = i;
+                return false;
+            }
+
+            if (ix == IX_DUMMY) {
+                if (!found_tombstone) {
+                    found_tombstone = true;
+                    found_slot = i;
+                }
+                continue;
+            }
+
+            char* old_table = table;
+            uint32_t old_num_items = num_items, old_num_tombstones = split ? 0 : num_tombstones;
+            bool equal = KeyInfoT::isEqual(key, entries()[ix].first);
+            if (table != old_table || num_items != old_num_items || (split ? 0 : num_tombstones) != old_num_tombstones)
+                goto restart;
+            if (equal) {
+                found_slot = i;
+                return true;
+            }
+        }
+    }
+
+    size_t findEmptySlot(size_t hash) const {
+        size_t perturb = hash;
+        size_t i = perturb & mask();
+        while (getIndex(i) != IX_EMPTY) {
+            i = (i * 5 + perturb + 1) & mask();
+            perturb >>= 5;
+        }
+        return i;
+    }
+
+    size_t findSlotOf(size_t hash, int64_t ix) const {
+        size_t perturb = hash;
+        size_t i = perturb & mask();
+        while (getIndex(i) != ix) {
+            assert(getIndex(i) != IX_EMPTY);
+            i = (i * 5 + perturb + 1) & mask();
+            perturb >>= 5;
+        }
+        return i;
+    }
+
+    // Reallocates the table and reinserts the live entries, visiting them in iteration order like DenseMap does.
+    // The entries end up in that order in the new entries array, so that iteration walks them sequentially.
+    // Returns the new position of the entry which was at index track_ix.
+    int64_t rehash(int new_log2_size, int64_t track_ix = IX_EMPTY) {
+        char* old_table = table;
+        size_t old_num_slots = numSlots();
+        int old_log2_size = log2_size;
+        value_type* old_entries = old_table ? entries() : NULL;
+
+        table = (char*)PyObject_Malloc(indexBytesFor(new_log2_size) + capacityFor(new_log2_size) * sizeof(value_type));
+        log2_size = new_log2_size;
+        // IX_EMPTY is all ones in all of the index widths:
+        memset(table, 0xff, indexBytes());
+
+        value_type* new_entries = entries();
+        int64_t tracked = IX_EMPTY;
+        int64_t n = 0;
+        for (size_t i = 0; i < old_num_slots; i++) {
+            int64_t ix = getIndex(old_table, old_log2_size, i);
+            if (ix < 0)
+                continue;
+
+            if (ix == track_ix)
+                tracked = n;
+            new_entries[n] = old_entries[ix];
+            setIndex(findEmptySlot(KeyInfoT::getHashValue(new_entries[n].first)), n);
+            n++;
+        }
+        assert(n == num_items);
+        num_entries = n;
+        num_tombstones = 0;
+
+        PyObject_Free(old_table);
+        return tracked;
+    }
+
+    // Moves the live entries to the beginning of the entries array, without changing the index array (and with that
+    // the iteration order).
+    void compactEntries() {
+        value_type* e = entries();
+        uint32_t n = 0;
+        for (uint32_t ix = 0; ix < num_entries; ix++) {
+            if (isRemoved(e[ix]))
+                continue;
+            if (ix != n) {
+                setIndex(findSlotOf(KeyInfoT::getHashValue(e[ix].first), ix), n);
+                e[n] = e[ix];
+            }
+            n++;
+        }
+        assert(n == num_items);
+        num_entries = n;
+    }
+
+    // Adds the key to a split map without giving it its own copy of the keys, if possible: see the class comment.
+    bool appendSplit(const KeyT& key, const ValueT& value, size_t slot) {
+        assert(split);
+        SharedKeys* keys = sharedKeysOf(table);
+        int64_t ix = getIndex(slot);
+        if (ix == IX_EMPTY) {
+            // Same growth policy as in insertNew():
+            if (num_items != keys->num_items || (num_items + 1) * 3 >= numSlots() * 2)
+                return false;
+            entries()[num_items] = value_type{ key, ValueT() };
+            setIndex(slot, num_items);
+            keys->num_items++;
+        } else {
+            assert(ix >= (int64_t)num_items);
+            if (ix != (int64_t)num_items || memcmp(&entries()[ix].first, &key, sizeof(KeyT)) != 0)
+                return false;
+        }
+        values[num_items++] = value;
+        return true;
+    }
+
+    // Inserts the key, which is not in the map, at the position returned by lookup().  Returns its final position.
+    size_t insertNew(const KeyT& key, const ValueT& value, size_t slot) {
+        if (split) {
+            if (appendSplit(key, value, slot))
+                return slot;
+            // Split maps don't have tombstones, so the slot stays the right one:
+            unsplit();
+        }
+
+        if (!table) {
+            rehash(log2SizeFor(4));
+            slot = findEmptySlot(KeyInfoT::getHashValue(key));
+        }
+
+        if (getIndex(slot) == IX_DUMMY)
+            num_tombstones--;
+
+        if (num_entries == capacity())
+            compactEntries();
+        assert(num_entries < capacity());
+
+        int64_t ix = num_entries++;
+        entries()[ix] = value_type{ key, value };
+        setIndex(slot, ix);
+        num_items++;
+
+        // Same growth policy as DenseMap::growMaybe:
+        size_t num_slots = numSlots();
+        if (num_items * 3 >= num_slots * 2) {
+            ix = rehash(log2SizeFor(num_items * (num_items > 50000 ? 2 : 4)), ix);
+            slot = findSlotOf(KeyInfoT::getHashValue(key), ix);
+        } else if (num_slots - (num_items + num_tombstones) <= num_slots / 8) {
+            ix = rehash(log2_size, ix);
+            slot = findSlotOf(KeyInfoT::getHashValue(key), ix);
+        }
+        return slot;
+    }
+
+public:
+    class iterator {
+    private:
+        CompactMap* map;
+        size_t slot;
+
+        void skipEmpty() {
+            while (slot < map->numSlots() && map->indexAt(slot) < 0)
+                slot++;
+        }
+
+    public:
+        iterator() : map(NULL), slot(0) {}
+        iterator(CompactMap* map, size_t slot) : map(map), slot(slot) { skipEmpty(); }
+
+        size_t index() const { return slot; }
+        bool atEnd() const { return slot >= map->numSlots(); }
+
+        // The map might have shrunk since we got created (see freeAllMemory()), so all iterators past the end are
+        // equal:
+        bool operator==(const iterator& rhs) const { return slot == rhs.slot || (atEnd() && rhs.atEnd()); }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+        iterator& operator++() {
+            slot++;
+            skipEmpty();
+            return *this;
+        }
+
+        reference operator*() const {
+            int64_t ix = map->indexAt(slot);
+            assert(!atEnd() && ix >= 0);
+            return reference{ map->entries()[ix].first, map->valueAt(ix) };
+        }
+
+        class pointer {
+        private:
+            reference r;
+
+        public:
+            pointer(reference r) : r(r) {}
+            reference* operator->() { return &r; }
+        };
+        pointer operator->() const { return pointer(**this); }
+    };
+
+    CompactMap() : table(NULL), num_tombstones(0), num_entries(0), num_items(0), log2_size(0), split(false) {}
+    CompactMap(const CompactMap& rhs) : CompactMap() { *this = rhs; }
+    ~CompactMap() { freeAllMemory(); }
+
+    CompactMap& operator=(const CompactMap& rhs) {
+        if (this == &rhs)
+            return *this;
+
+        freeAllMemory();
+        if (!rhs.table)
+            return *this;
+
+        if (rhs.split) {
+            // The copy can share the keys as well:
+            table = rhs.table;
+            sharedKeysOf(table)->refcount++;
+            values = (ValueT*)PyObject_Malloc(rhs.capacity() * sizeof(ValueT));
+            memcpy(values, rhs.values, rhs.num_items * sizeof(ValueT));
+            split = true;
+        } else {
+            table = (char*)PyObject_Malloc(rhs.indexBytes() + rhs.capacity() * sizeof(value_type));
+            memcpy(table, rhs.table, rhs.indexBytes() + rhs.num_entries * sizeof(value_type));
+            num_tombstones = rhs.num_tombstones;
+            num_entries = rhs.num_entries;
+        }
+        num_items = rhs.num_items;
+        log2_size = rhs.log2_size;
+        return *this;
+    }
+
+    unsigned size() const { return num_items; }
+    bool empty() const { return num_items == 0; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, numSlots()); }
+    // The first entry at or after the given position in the iteration order.
+    iterator iteratorAt(size_t slot) { return iterator(this, slot); }
+
+    iterator find(const KeyT& key) {
+        size_t slot;
+        if (!lookup(key, slot))
+            return end();
+        return iterator(this, slot);
+    }
+
+    size_t count(const KeyT& key) {
+        size_t slot;
+        return lookup(key, slot) ? 1 : 0;
+    }
+
+    ValueT& operator[](const KeyT& key) {
+        size_t slot;
+        if (!lookup(key, slot))
+            slot = insertNew(key, ValueT(), slot);
+        return valueAt(getIndex(slot));
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT>& kv) {
+        size_t slot;
+        if (lookup(kv.first, slot))
+            return std::make_pair(iterator(this, slot), false);
+        slot = insertNew(kv.first, kv.second, slot);
+        return std::make_pair(iterator(this, slot), true);
+    }
+
+    void erase(iterator it) {
+        if (split)
+            unsplit();
+
+        size_t slot = it.index();
+        int64_t ix = getIndex(slot);
+        assert(ix >= 0);
+
+        value_type& e = entries()[ix];
+        e.first = KeyInfoT::getTombstoneKey();
+        e.second = ValueT();
+        setIndex(slot, IX_DUMMY);
+        num_items--;
+        num_tombstones++;
+
+        // Reuse the removed entries at the end of the entries array right away:
+        while (num_entries && isRemoved(entries()[num_entries - 1]))
+            num_entries--;
+    }
+
+    // Makes sure that the index array has at least at_least slots.
+    void grow(unsigned at_least) {
+        int new_log2_size = log2SizeFor(at_least);
+        if (table && new_log2_size <= log2_size)
+            return;
+        if (split)
+            unsplit();
+        rehash(new_log2_size);
+    }
+
+    void freeAllMemory() {
+        if (split) {
+            PyObject_Free(values);
+            decrefSharedKeys(sharedKeysOf(table));
+        } else {
+            PyObject_Free(table);
+        }
+        table = NULL;
+        num_tombstones = num_entries = 0;
+        num_items = 0;
+        log2_size = 0;
+        split = false;
+    }
+
+    bool isSplit() const { return split; }
+
+    // Returns a copy of the keys of this map that other maps can share with trySplit(), or NULL if the map is empty,
+    // split or has removed entries.  The caller owns a reference to the returned keys.
+    SharedKeys* shareKeys() {
+        if (!table || split || num_tombstones || num_entries != num_items)
+            return NULL;
+
+        SharedKeys* keys
+            = (SharedKeys*)PyObject_Malloc(sizeof(SharedKeys) + indexBytes() + capacity() * sizeof(value_type));
+        keys->refcount = 1;
+        keys->num_items = num_items;
+        keys->log2_size = log2_size;
+        memcpy(tableOf(keys), table, indexBytes() + num_items * sizeof(value_type));
+        return keys;
+    }
+
+    // The entries of the shared keys; only their keys are meaningful.
+    static const value_type* sharedEntries(SharedKeys* keys) {
+        return (const value_type*)(tableOf(keys) + indexBytesFor(keys->log2_size));
+    }
+
+    static void decrefSharedKeys(SharedKeys* keys) {
+        assert(keys->refcount > 0);
+        if (--keys->refcount == 0)
+            PyObject_Free(keys);
+    }
+
+    // If this map has the first num_items of the shared keys (compared bytewise), in the same layout, switches it to
+    // only storing its values.  Since the layout is the same, this doesn't change the iteration order.
+    bool trySplit(SharedKeys* keys) {
+        if (split)
+            return table == tableOf(keys);
+
+        if (!table || !num_items || num_items > keys->num_items || log2_size != keys->log2_size || num_tombstones
+            || num_entries != num_items)
+            return false;
+
+        char* shared_table = tableOf(keys);
+        value_type* shared_entries = (value_type*)(shared_table + indexBytes());
+        // Maps which are still getting their keys can end up here for each of them, so reject most other maps cheaply:
+        if (memcmp(&entries()[num_items - 1].first, &shared_entries[num_items - 1].first, sizeof(KeyT)) != 0)
+            return false;
+
+        for (size_t slot = 0; slot < numSlots(); slot++) {
+            int64_t shared_ix = getIndex(shared_table, log2_size, slot);
+            if (getIndex(slot) != (shared_ix < (int64_t)num_items ? shared_ix : IX_EMPTY))
+                return false;
+        }
+        for (uint32_t ix = 0; ix < num_items; ix++) {
+            if (memcmp(&entries()[ix].first, &shared_entries[ix].first, sizeof(KeyT)) != 0)
+                return false;
+        }
+
+        // Leave space for the keys we might append:
+        ValueT* new_values = (ValueT*)PyObject_Malloc(capacity() * sizeof(ValueT));
+        for (uint32_t ix = 0; ix < num_items; ix++)
+            new_values[ix] = entries()[ix].second;
+
+        PyObject_Free(table);
+        keys->refcount++;
+        table = shared_table;
+        values = new_values;
+        split = true;
+        return true;
+    }
+};
+}
+
+#endif
@@ -57,6 +57,13 @@ int SPECULATION_THRESHOLD = 100;
 
 int MAX_OBJECT_CACHE_ENTRIES = 500;
 
+// How many unused generator stacks we keep around for reuse; see generator.cpp:
+int MAX_CACHED_GENERATOR_STACKS = 64;
+int MAX_CACHED_LARGE_GENERATOR_STACKS = 8;
+
+// Only used if ENABLE_BACKGROUND_COMPILATION is set:
+int BACKGROUND_COMPILE_THREADS = 1;
+
 static bool _GLOBAL_ENABLE = 1;
 bool ENABLE_ICS = 1 && _GLOBAL_ENABLE;
 bool ENABLE_ICGENERICS = 1 && ENABLE_ICS;
@@ -79,6 +86,14 @@ bool ENABLE_PYSTON_PASSES = 0 && _GLOBAL_ENABLE;
 bool ENABLE_TYPE_FEEDBACK = 1 && _GLOBAL_ENABLE;
 bool ENABLE_RUNTIME_ICS = 1 && _GLOBAL_ENABLE;
 bool ENABLE_JIT_OBJECT_CACHE = 1 && _GLOBAL_ENABLE;
+// Store the computed bytecode of imported modules in their .pyc files; see codegen/serialize_cfg.h:
+bool ENABLE_BYTECODE_CACHE = 1 && _GLOBAL_ENABLE;
+// Compile functions which reached the reopt/OSR thresholds on a separate thread instead of synchronously:
+bool ENABLE_BACKGROUND_COMPILATION = 0;
+// Remember which functions got hot (and what types they saw) across runs; see codegen/profile_cache.h:
+bool ENABLE_PROFILE_CACHE = 0;
+// Run generators which are still in the interpreter on the stack of their caller; see resumeStacklessGenerator():
+bool ENABLE_STACKLESS_GENERATORS = 1;
 
 bool ENABLE_FRAME_INTROSPECTION = 1;
 
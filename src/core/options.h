@@ -34,6 +34,8 @@ extern int OSR_THRESHOLD_BASELINE, REOPT_THRESHOLD_BASELINE;
 extern int OSR_THRESHOLD_T2, REOPT_THRESHOLD_T2;
 extern int SPECULATION_THRESHOLD;
 extern int MAX_OBJECT_CACHE_ENTRIES;
+extern int MAX_CACHED_GENERATOR_STACKS, MAX_CACHED_LARGE_GENERATOR_STACKS;
+extern int BACKGROUND_COMPILE_THREADS;
 
 extern bool SHOW_DISASM, FORCE_INTERPRETER, FORCE_OPTIMIZE, PROFILE, DUMPJIT, USE_STRIPPED_STDLIB, CONTINUE_AFTER_FATAL,
     ENABLE_INTERPRETER, ENABLE_BASELINEJIT, USE_REGALLOC_BASIC, PAUSE_AT_ABORT, ENABLE_TRACEBACKS,
@@ -44,7 +46,8 @@ extern bool LOG_IC_ASSEMBLY, LOG_BJIT_ASSEMBLY;
 extern bool ENABLE_ICS, ENABLE_ICGENERICS, ENABLE_ICGETITEMS, ENABLE_ICSETITEMS, ENABLE_ICDELITEMS, ENABLE_ICBINEXPS,
     ENABLE_ICNONZEROS, ENABLE_ICCALLSITES, ENABLE_ICSETATTRS, ENABLE_ICGETATTRS, ENALBE_ICDELATTRS, ENABLE_ICGETGLOBALS,
     ENABLE_SPECULATION, ENABLE_OSR, ENABLE_LLVMOPTS, ENABLE_INLINING, ENABLE_REOPT, ENABLE_PYSTON_PASSES,
-    ENABLE_TYPE_FEEDBACK, ENABLE_FRAME_INTROSPECTION, ENABLE_RUNTIME_ICS, ENABLE_JIT_OBJECT_CACHE;
+    ENABLE_TYPE_FEEDBACK, ENABLE_FRAME_INTROSPECTION, ENABLE_RUNTIME_ICS, ENABLE_JIT_OBJECT_CACHE,
+    ENABLE_BACKGROUND_COMPILATION, ENABLE_PROFILE_CACHE, ENABLE_BYTECODE_CACHE, ENABLE_STACKLESS_GENERATORS;
 
 // Due to a temporary LLVM limitation, represent bools as i64's instead of i1's.
 #define BOOLS_AS_I64 1
@@ -14,8 +14,11 @@
 
 #include "core/threading.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <deque>
 #include <err.h>
 #include <setjmp.h>
@@ -369,10 +372,34 @@ extern "C" void endAllowThreads() noexcept {
     current_internal_thread_state->gilTaken();
 }
 
-static pthread_mutex_t gil = PTHREAD_MUTEX_INITIALIZER;
+// The GIL.  Like the one in CPython 3.2+, preemption is time-based: a thread that couldn't get the GIL within the
+// switch interval sets gil_drop_request, which makes the running thread give up the GIL at its next
+// allowGLReadPreemption() check.
+// A thread that releases the GIL while others are waiting hands it directly to the one that has been waiting the
+// longest.  So the releasing thread can't immediately grab it again, and waiting threads get served in FIFO order.
+namespace {
+struct GILWaiter {
+    pthread_cond_t cond;
+    bool granted = false;
+
+    GILWaiter() {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+    ~GILWaiter() { pthread_cond_destroy(&cond); }
+};
+}
+
+static pthread_mutex_t gil_mutex = PTHREAD_MUTEX_INITIALIZER; // protects the following two:
+static bool gil_locked = false;
+static std::deque<GILWaiter*> gil_waiters;
+
+std::atomic<int> gil_drop_request(0);
+static std::atomic<long> gil_switch_interval_us(5000);
 
-std::atomic<int> threads_waiting_on_gil(0);
-static pthread_cond_t gil_acquired = PTHREAD_COND_INITIALIZER;
 bool forgot_refs_via_fork = false;
 
 extern "C" void PyEval_ReInitThreads() noexcept {
@@ -406,7 +433,12 @@ extern "C" void PyEval_ReInitThreads() noexcept {
     threading_lock.unlock();
 
     num_starting_threads = 0;
-    threads_waiting_on_gil = 0;
+
+    // We are holding the GIL, and the threads that were waiting for it don't exist anymore:
+    pthread_mutex_init(&gil_mutex, NULL);
+    assert(gil_locked);
+    gil_waiters.clear();
+    gil_drop_request = 0;
 
     PerThreadSetBase::runAllForkHandlers();
 
@@ -426,45 +458,90 @@ extern "C" void PyEval_ReInitThreads() noexcept {
     Py_DECREF(threading);
 }
 
+static void addMicroseconds(struct timespec* ts, long us) {
+    ts->tv_sec += us / 1000000;
+    ts->tv_nsec += (us % 1000000) * 1000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
 void _acquireGIL() {
-    threads_waiting_on_gil++;
-    pthread_mutex_lock(&gil);
-    threads_waiting_on_gil--;
+    pthread_mutex_lock(&gil_mutex);
+
+    // If there are threads waiting, gil_locked stays set while the GIL gets handed from one to the next.
+    if (!gil_locked) {
+        assert(gil_waiters.empty());
+        gil_locked = true;
+        pthread_mutex_unlock(&gil_mutex);
+        return;
+    }
+
+    GILWaiter waiter;
+    gil_waiters.push_back(&waiter);
+
+    struct timespec start, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    while (!waiter.granted) {
+        addMicroseconds(&deadline, gil_switch_interval_us.load(std::memory_order_relaxed));
+        int r = pthread_cond_timedwait(&waiter.cond, &gil_mutex, &deadline);
+        // Only the longest-waiting thread asks for the GIL; it's the one that will get it.
+        if (r == ETIMEDOUT && !waiter.granted && gil_waiters.front() == &waiter) {
+            static StatCounter num_gil_drop_requests("num_gil_drop_requests");
+            num_gil_drop_requests.log();
+            gil_drop_request = 1;
+        }
+    }
 
-    pthread_cond_signal(&gil_acquired);
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    static StatCounter us_gil_waiting("us_gil_waiting");
+    us_gil_waiting.log((end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000);
+
+    pthread_mutex_unlock(&gil_mutex);
 }
 
 void _releaseGIL() {
-    pthread_mutex_unlock(&gil);
-}
+    pthread_mutex_lock(&gil_mutex);
+    assert(gil_locked);
 
-int gil_check_count = 0;
+    gil_drop_request = 0;
+    if (gil_waiters.empty()) {
+        gil_locked = false;
+    } else {
+        GILWaiter* next = gil_waiters.front();
+        gil_waiters.pop_front();
+        next->granted = true;
+        pthread_cond_signal(&next->cond);
 
-// TODO: this function is fair in that it forces a thread to give up the GIL
-// after a bounded amount of time, but currently we have no guarantees about
-// who it will release the GIL to.  So we could have two threads that are
-// switching back and forth, and a third that never gets run.
-// We could enforce fairness by having a FIFO of events (implementd with mutexes?)
-// and make sure to always wake up the longest-waiting one.
-void _allowGLReadPreemption() {
-    assert(gil_check_count >= GIL_CHECK_INTERVAL);
-    gil_check_count = 0;
+        static StatCounter num_gil_switches("num_gil_switches");
+        num_gil_switches.log();
+    }
 
-    // Double check this, since if we are wrong about there being a thread waiting on the gil,
-    // we're going to get stuck in the following pthread_cond_wait:
-    if (!threads_waiting_on_gil.load(std::memory_order_seq_cst))
-        return;
+    pthread_mutex_unlock(&gil_mutex);
+}
 
+void _allowGLReadPreemption() {
     current_internal_thread_state->gilReleased();
 
-    threads_waiting_on_gil++;
-    pthread_cond_wait(&gil_acquired, &gil);
-    threads_waiting_on_gil--;
-    pthread_cond_signal(&gil_acquired);
+    // This hands the GIL to the thread that asked for it, and puts us at the end of the queue:
+    _releaseGIL();
+    _acquireGIL();
 
     current_internal_thread_state->gilTaken();
 }
 
+void setSwitchInterval(double seconds) {
+    assert(seconds > 0);
+    gil_switch_interval_us = std::max(1L, (long)(seconds * 1000000));
+}
+
+double getSwitchInterval() {
+    return gil_switch_interval_us / 1000000.0;
+}
+
 // We don't support CPython's TLS (yet?)
 extern "C" void PyThread_ReInitTLS(void) noexcept {
     // don't have to do anything since we don't support TLS
@@ -53,12 +53,14 @@ bool isMainThread();
 
 void _allowGLReadPreemption();
 
-#define GIL_CHECK_INTERVAL 1000
-
-// Note: this doesn't need to be an atomic, since it should
-// only be accessed by the thread that holds the gil:
-extern int gil_check_count;
-extern std::atomic<int> threads_waiting_on_gil;
+// Like CPython 3.2+: a thread that has been waiting on the GIL for this long asks the thread holding it to give it
+// up.  Set via sys.setswitchinterval().
+void setSwitchInterval(double seconds);
+double getSwitchInterval();
+
+// Set by a waiting thread once its switch interval ran out; the thread that holds the gil has to drop it the next time
+// it checks.  Only gets cleared when the gil changes hands.
+extern std::atomic<int> gil_drop_request;
 extern "C" inline void allowGLReadPreemption() __attribute__((visibility("default")));
 extern "C" inline void allowGLReadPreemption() {
 #if ENABLE_SAMPLING_PROFILER
@@ -73,12 +75,7 @@ extern "C" inline void allowGLReadPreemption() {
     }
 #endif
 
-    // Double-checked locking: first read with no ordering constraint:
-    if (!threads_waiting_on_gil.load(std::memory_order_relaxed))
-        return;
-
-    gil_check_count++;
-    if (likely(gil_check_count < GIL_CHECK_INTERVAL))
+    if (likely(!gil_drop_request.load(std::memory_order_relaxed)))
         return;
 
     _allowGLReadPreemption();
@@ -279,6 +279,14 @@ struct ParamNames {
 
 private:
     ParamNames() : all_args_contains_names(0), takes_param_names(0), has_vararg_name(0), has_kwarg_name(0) {}
+    // Takes ownership of the names.
+    ParamNames(std::vector<NameOrStr> names, bool has_vararg_name, bool has_kwarg_name)
+        : all_args(std::move(names)),
+          all_args_contains_names(1),
+          takes_param_names(1),
+          has_vararg_name(has_vararg_name),
+          has_kwarg_name(has_kwarg_name) {}
+    friend class CFGDeserializer;
 };
 
 // Similar to ArgPassSpec, this struct is how functions specify what their parameter signature is.
@@ -486,6 +494,21 @@ public:
     DerefInfo getDerefInfo(BST_LoadName*) const;
 
     ScopingResults(ScopeInfo* scope_info, bool globals_from_module);
+
+private:
+    // Used when loading the bytecode from the .pyc file:
+    ScopingResults() = default;
+    friend class CFGDeserializer;
+};
+
+// Functions can get created without their CFG, which then gets computed the first time the function runs
+// (see BoxedCode::ensureCFG).  This holds whatever is needed to compute it: the AST of the function, or the
+// serialized bytecode.
+class LazyCFG {
+public:
+    virtual ~LazyCFG() {}
+    // Has to set the CFG of the code object and its code constants.
+    virtual void compute(BoxedCode* code) = 0;
 };
 
 // Data about a single textual function definition.
@@ -497,7 +520,8 @@ private:
 public:
     BoxedModule* parent_module;
     ScopingResults scoping;
-    CFG* cfg;
+    CFG* cfg; // NULL if it hasn't been computed yet, in which case lazy_cfg is set
+    std::unique_ptr<LazyCFG> lazy_cfg;
     FutureFlags future_flags;
     bool is_generator;
 
@@ -465,7 +465,7 @@ static int main(int argc, char** argv) noexcept {
                 AST_Module* m;
                 std::unique_ptr<ASTAllocator> ast_allocator;
                 std::tie(m, ast_allocator) = parse_string(command, /* future_flags = */ 0);
-                compileAndRunModule(m, main_module);
+                compileAndRunModule(m, main_module, std::move(ast_allocator));
                 rtncode = 0;
             } catch (ExcInfo e) {
                 setCAPIException(e);
@@ -512,7 +512,7 @@ static int main(int argc, char** argv) noexcept {
                     AST_Module* ast;
                     std::tie(ast, ast_allocator) = parse_file(fn, /* future_flags = */ 0);
 
-                    compileAndRunModule(ast, main_module);
+                    compileAndRunModule(ast, main_module, std::move(ast_allocator));
                     rtncode = 0;
                 } catch (ExcInfo e) {
                     setCAPIException(e);
@@ -306,12 +306,63 @@ extern "C" Box* sum(Box* container, Box* initial) {
     static RuntimeICCache<BinopIC, 3> runtime_ic_cache;
     std::shared_ptr<BinopIC> pp = runtime_ic_cache.getIC(__builtin_return_address(0));
 
+    // Like CPython, we add up runs of exact ints and floats without boxing the intermediate results, and only switch
+    // over to the generic addition once we see something else (or an int addition overflows).
+    enum { SUM_GENERIC, SUM_INT, SUM_FLOAT } mode = SUM_GENERIC;
+    i64 int_total = 0;
+    double float_total = 0.0;
+    if (initial->cls == int_cls) {
+        mode = SUM_INT;
+        int_total = static_cast<BoxedInt*>(initial)->n;
+    } else if (initial->cls == float_cls) {
+        mode = SUM_FLOAT;
+        float_total = static_cast<BoxedFloat*>(initial)->d;
+    }
+
     Py_INCREF(initial);
     auto cur = autoDecref(initial);
     for (Box* e : container->pyElements()) {
         AUTO_DECREF(e);
+
+        if (mode == SUM_INT) {
+            if (e->cls == int_cls) {
+                i64 r;
+                if (!__builtin_saddl_overflow(int_total, static_cast<BoxedInt*>(e)->n, &r)) {
+                    int_total = r;
+                    continue;
+                }
+            } else if (e->cls == float_cls) {
+                mode = SUM_FLOAT;
+                float_total = (double)int_total;
+            }
+
+            if (mode == SUM_INT) {
+                mode = SUM_GENERIC;
+                cur = boxInt(int_total);
+            }
+        }
+
+        if (mode == SUM_FLOAT) {
+            if (e->cls == float_cls) {
+                float_total += static_cast<BoxedFloat*>(e)->d;
+                continue;
+            }
+            if (e->cls == int_cls) {
+                float_total += static_cast<BoxedInt*>(e)->n;
+                continue;
+            }
+
+            mode = SUM_GENERIC;
+            cur = boxFloat(float_total);
+        }
+
         cur = pp->call(cur, e, AST_TYPE::Add);
     }
+
+    if (mode == SUM_INT)
+        return boxInt(int_total);
+    if (mode == SUM_FLOAT)
+        return boxFloat(float_total);
     return incref(cur.get());
 }
 
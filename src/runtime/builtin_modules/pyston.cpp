@@ -46,6 +46,13 @@ static Box* setOption(Box* option, Box* value) {
     else CHECK(SPECULATION_THRESHOLD);
     else CHECK(ENABLE_ICS);
     else CHECK(ENABLE_ICGETATTRS);
+    else CHECK(ENABLE_BACKGROUND_COMPILATION);
+    else CHECK(BACKGROUND_COMPILE_THREADS);
+    else CHECK(ENABLE_PROFILE_CACHE);
+    else CHECK(ENABLE_BYTECODE_CACHE);
+    else CHECK(MAX_CACHED_GENERATOR_STACKS);
+    else CHECK(MAX_CACHED_LARGE_GENERATOR_STACKS);
+    else CHECK(ENABLE_STACKLESS_GENERATORS);
     else raiseExcHelper(ValueError, "unknown option name '%s", option_string->data());
 
     Py_RETURN_NONE;
@@ -76,6 +83,19 @@ static Box* pyCompile(Box* fname, Box* force) {
     Py_RETURN_NONE;
 }
 
+static Box* freeze() {
+    return boxInt(_PyGC_Freeze());
+}
+
+static Box* unfreeze() {
+    _PyGC_Unfreeze();
+    Py_RETURN_NONE;
+}
+
+static Box* getFreezeCount() {
+    return boxInt(_PyGC_GetFreezeCount());
+}
+
 void setupPyston() {
     pyston_module = createModule(autoDecref(boxString("__pyston__")));
 
@@ -90,5 +110,12 @@ void setupPyston() {
 
     pyston_module->giveAttr(
         "py_compile", new BoxedBuiltinFunctionOrMethod(BoxedCode::create((void*)pyCompile, UNKNOWN, 2, "pyCompile")));
+
+    pyston_module->giveAttr("freeze",
+                            new BoxedBuiltinFunctionOrMethod(BoxedCode::create((void*)freeze, BOXED_INT, 0, "freeze")));
+    pyston_module->giveAttr(
+        "unfreeze", new BoxedBuiltinFunctionOrMethod(BoxedCode::create((void*)unfreeze, NONE, 0, "unfreeze")));
+    pyston_module->giveAttr("getFreezeCount", new BoxedBuiltinFunctionOrMethod(BoxedCode::create(
+                                                  (void*)getFreezeCount, BOXED_INT, 0, "getFreezeCount")));
 }
 }
@@ -25,6 +25,7 @@
 
 #include "capi/types.h"
 #include "codegen/unwinding.h"
+#include "core/threading.h"
 #include "core/types.h"
 #include "runtime/inline/boxing.h"
 #include "runtime/inline/list.h"
@@ -523,6 +524,34 @@ static PyObject* sys_gettotalrefcount(PyObject* self) {
 }
 #endif /* Py_REF_DEBUG */
 
+static PyObject* sys_setswitchinterval(PyObject* self, PyObject* args) noexcept {
+    double d;
+    if (!PyArg_ParseTuple(args, "d:setswitchinterval", &d))
+        return NULL;
+    if (d <= 0.0) {
+        PyErr_SetString(PyExc_ValueError, "switch interval must be strictly positive");
+        return NULL;
+    }
+    threading::setSwitchInterval(d);
+    Py_RETURN_NONE;
+}
+
+static PyObject* sys_getswitchinterval(PyObject* self, PyObject* args) noexcept {
+    return PyFloat_FromDouble(threading::getSwitchInterval());
+}
+
+PyDoc_STRVAR(setswitchinterval_doc, "setswitchinterval(n)\n\
+\n\
+Set the ideal thread switching delay inside the Python interpreter\n\
+The actual frequency of switching threads can be lower if the\n\
+interpreter executes long sequences of uninterruptible code\n\
+(this is implementation-specific and workload-dependent).\n\
+\n\
+The parameter must represent the desired switching delay in seconds\n\
+A typical value is 0.005 (5 milliseconds).");
+
+PyDoc_STRVAR(getswitchinterval_doc, "getswitchinterval() -> current thread switch interval; see setswitchinterval().");
+
 PyDoc_STRVAR(getrefcount_doc, "getrefcount(object) -> integer\n\
         \n\
         Return the reference count of object.  The count returned is generally\n\
@@ -547,6 +576,8 @@ static PyMethodDef sys_methods[] = {
     { "_clear_type_cache", sys_clear_type_cache, METH_NOARGS, sys_clear_type_cache__doc__ },
     { "getrefcount", (PyCFunction)sys_getrefcount, METH_O, getrefcount_doc },
     { "getsizeof", (PyCFunction)sys_getsizeof, METH_VARARGS | METH_KEYWORDS, getsizeof_doc },
+    { "setswitchinterval", sys_setswitchinterval, METH_VARARGS, setswitchinterval_doc },
+    { "getswitchinterval", sys_getswitchinterval, METH_NOARGS, getswitchinterval_doc },
 };
 
 PyDoc_STRVAR(flags__doc__, "sys.flags\n\
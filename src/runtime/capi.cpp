@@ -852,7 +852,7 @@ extern "C" int PyRun_InteractiveOneFlags(FILE* fp, const char* filename, PyCompi
     try {
         assert(mod->kind == Interactive_kind);
         auto res = cpythonToPystonAST(mod, filename);
-        compileAndRunModule((AST_Module*)res.first, static_cast<BoxedModule*>(m));
+        compileAndRunModule((AST_Module*)res.first, static_cast<BoxedModule*>(m), std::move(res.second));
     } catch (ExcInfo e) {
         setCAPIException(e);
         failed = true;
@@ -16,6 +16,8 @@
 #include <sstream>
 
 #include "codegen/baseline_jit.h"
+#include "codegen/profile_cache.h"
+#include "core/options.h"
 #include "runtime/objmodel.h"
 #include "runtime/set.h"
 
@@ -104,6 +106,9 @@ Box* BoxedCode::flags(Box* b, void*) noexcept {
 void BoxedCode::dealloc(Box* b) noexcept {
     BoxedCode* o = static_cast<BoxedCode*>(b);
 
+    if (unlikely(ENABLE_PROFILE_CACHE) && o->source && o->source->cfg)
+        profileCacheForgetCode(o);
+
     Py_XDECREF(o->filename);
     Py_XDECREF(o->name);
     Py_XDECREF(o->_doc);
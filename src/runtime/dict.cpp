@@ -408,41 +408,20 @@ extern "C" int PyDict_Next(PyObject* op, Py_ssize_t* ppos, PyObject** pkey, PyOb
     assert(PyDict_Check(op));
     BoxedDict* self = static_cast<BoxedDict*>(op);
 
-    // Callers of PyDict_New() provide a pointer to some storage for this function to use, in
-    // the form of a Py_ssize_t* -- ie they allocate a Py_ssize_t on their stack, and let us use
-    // it.
-    //
-    // We want to store an unordered_map::iterator in that.  In my glibc it would fit, but to keep
-    // things a little bit more portable, allocate separate storage for the iterator, and store the
-    // pointer to this storage in the Py_ssize_t slot.
-    //
-    // Results in lots of indirection unfortunately.  If it becomes an issue we can try to switch
-    // to storing the iterator directly in the stack slot.
-
-    typedef BoxedDict::DictMap::iterator iterator;
-
-    static_assert(sizeof(Py_ssize_t) == sizeof(iterator*), "");
-    iterator** it_ptr = reinterpret_cast<iterator**>(ppos);
-
-    // Clients are supposed to zero-initialize *ppos:
-    if (*it_ptr == NULL) {
-        *it_ptr = (iterator*)malloc(sizeof(iterator));
-        **it_ptr = self->d.begin();
-    }
-
-    iterator* it = *it_ptr;
-
-    if (*it == self->d.end()) {
-        free(it);
+    // Callers provide a pointer to some storage for this function to use, in the form of a Py_ssize_t* -- ie they
+    // allocate a Py_ssize_t on their stack, zero-initialize it, and let us use it.  Unlike CPython, which stores a
+    // position in its entries array, we store the slot of the hash index after the one we just returned, ie the
+    // iteration walks the index array (in hash order), not the entries array (in insertion order).
+    auto it = self->d.iteratorAt(*ppos);
+    if (it == self->d.end())
         return 0;
-    }
 
     if (pkey)
-        *pkey = (*it)->first.value;
+        *pkey = it->first.value;
     if (pvalue)
-        *pvalue = (*it)->second;
+        *pvalue = it->second;
 
-    ++(*it);
+    *ppos = it.index() + 1;
 
     return 1;
 }
@@ -948,7 +927,8 @@ static Box* characterize(BoxedDict* a, BoxedDict* b, Box** pval) noexcept {
         thisbval = NULL;
         try {
             it = b->d.find(thiskey);
-            thisbval = it->second;
+            if (it != b->d.end())
+                thisbval = it->second;
         } catch (ExcInfo e) {
             setCAPIException(e);
             goto Fail;
@@ -24,7 +24,6 @@ class BoxedDictIterator : public Box {
 public:
     BoxedDict* d;
     BoxedDict::DictMap::iterator it;
-    const BoxedDict::DictMap::iterator itEnd;
 
     BoxedDictIterator(BoxedDict* d);
 
@@ -20,10 +20,11 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstring>
-#include <deque>
 #include <sys/mman.h>
 #include <ucontext.h>
+#include <vector>
 
+#include "codegen/ast_interpreter.h"
 #include "core/common.h"
 #include "core/stats.h"
 #include "core/types.h"
@@ -35,7 +36,6 @@
 namespace pyston {
 
 static uint64_t next_stack_addr = 0x4270000000L;
-static std::deque<uint64_t> available_addrs;
 
 // There should be a better way of getting this:
 #define PAGE_SIZE 4096
@@ -44,6 +44,122 @@ static std::deque<uint64_t> available_addrs;
 #define STACK_REDZONE_SIZE PAGE_SIZE
 #define MAX_STACK_SIZE (4 * 1024 * 1024)
 
+// Creating a generator stack costs two mmaps, the page faults to touch it and an munmap when we are done with it, so
+// we pool them.  Every stack reserves MAX_STACK_SIZE of address space but only maps INITIAL_STACK_SIZE up front, and
+// grows on demand.  The pool has two size classes: small stacks never grew past their initial mapping, large ones
+// did.  Generators of functions which needed a large stack before get a large one again, so that they don't have to
+// fault the pages back in; all the others get a small one.  A large stack which doesn't fit into its pool gets
+// trimmed back to the initial mapping and becomes a small one.
+// The stacks are identified by their high address (stack_begin).
+static std::vector<uint64_t> small_generator_stacks;
+static std::vector<uint64_t> large_generator_stacks;
+
+// We notice that a stack grew because the word at the bottom of its initial mapping got overwritten:
+#define STACK_CANARY 0x6765727374616b63ULL
+
+static uint64_t* stackCanary(uint64_t stack_high) {
+    return (uint64_t*)(stack_high - INITIAL_STACK_SIZE);
+}
+
+static StatCounter generator_stack_created("generator_stack_created");
+static StatCounter generator_stack_reused("generator_stack_reused");
+static StatCounter generator_stack_large_reused("generator_stack_large_reused");
+// Stacks which took page faults past their initial mapping:
+static StatCounter generator_stack_grew("generator_stack_grew");
+static StatCounter generator_stack_trimmed("generator_stack_trimmed");
+static StatCounter generator_stack_unmapped("generator_stack_unmapped");
+
+static uint64_t allocGeneratorStack(bool large) {
+#if STACK_GROWS_DOWN
+    if (large && !large_generator_stacks.empty()) {
+        generator_stack_reused.log();
+        generator_stack_large_reused.log();
+        uint64_t stack_high = large_generator_stacks.back();
+        large_generator_stacks.pop_back();
+        // The large stacks still have the canary of their previous user overwritten; reset it so that we only notice
+        // if this generator needs the space as well.
+        *stackCanary(stack_high) = STACK_CANARY;
+        return stack_high;
+    }
+
+    // Small stacks work for everyone, and large ones for small generators, so fall back to the other class:
+    std::vector<uint64_t>& pool = !small_generator_stacks.empty() ? small_generator_stacks : large_generator_stacks;
+    if (!pool.empty()) {
+        generator_stack_reused.log();
+        uint64_t stack_high = pool.back();
+        pool.pop_back();
+        *stackCanary(stack_high) = STACK_CANARY;
+        return stack_high;
+    }
+
+    generator_stack_created.log();
+
+    uint64_t stack_low = next_stack_addr;
+    uint64_t stack_high = stack_low + MAX_STACK_SIZE;
+    next_stack_addr = stack_high;
+
+    void* initial_stack_limit = (void*)(stack_high - INITIAL_STACK_SIZE);
+    void* p = mmap(initial_stack_limit, INITIAL_STACK_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS | MAP_GROWSDOWN, -1, 0);
+    ASSERT(p == initial_stack_limit, "%p %s", p, strerror(errno));
+
+    // Create an inaccessible redzone so that the generator stack won't grow indefinitely.
+    // Looks like it throws a SIGBUS if we reach the redzone; it's unclear if that's better
+    // or worse than being able to consume all available memory.
+    void* p2 = mmap((void*)stack_low, STACK_REDZONE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+    assert(p2 == (void*)stack_low);
+    // Interestingly, it seems like MAP_GROWSDOWN will leave a page-size gap between the redzone and the growable
+    // region.
+
+    if (VERBOSITY() >= 3) {
+        printf("Created new generator stack, starts at %p, currently extends to %p\n", (void*)stack_high,
+               initial_stack_limit);
+        printf("Created a redzone from %p-%p\n", (void*)stack_low, (void*)(stack_low + STACK_REDZONE_SIZE));
+    }
+
+    *stackCanary(stack_high) = STACK_CANARY;
+    return stack_high;
+#else
+#error "implement me"
+#endif
+}
+
+static void freeGeneratorStack(BoxedGenerator* g) {
+    if (g->stack_begin == NULL)
+        return;
+
+    uint64_t stack_high = (uint64_t)g->stack_begin;
+    g->stack_begin = NULL;
+
+    bool grew = *stackCanary(stack_high) != STACK_CANARY;
+    if (grew) {
+        generator_stack_grew.log();
+        g->function->code->generator_needs_large_stack = true;
+
+        if (large_generator_stacks.size() < MAX_CACHED_LARGE_GENERATOR_STACKS) {
+            large_generator_stacks.push_back(stack_high);
+            return;
+        }
+
+        // Give the grown part back but keep the initial mapping, the redzone and the address range:
+        generator_stack_trimmed.log();
+        uint64_t stack_low = stack_high - MAX_STACK_SIZE;
+        int r = munmap((void*)(stack_low + STACK_REDZONE_SIZE),
+                       MAX_STACK_SIZE - STACK_REDZONE_SIZE - INITIAL_STACK_SIZE);
+        assert(r == 0);
+        *stackCanary(stack_high) = STACK_CANARY;
+    }
+
+    if (small_generator_stacks.size() < MAX_CACHED_GENERATOR_STACKS) {
+        small_generator_stacks.push_back(stack_high);
+        return;
+    }
+
+    generator_stack_unmapped.log();
+    int r = munmap((void*)(stack_high - MAX_STACK_SIZE), MAX_STACK_SIZE);
+    assert(r == 0);
+}
+
 static llvm::DenseMap<void*, BoxedGenerator*> s_generator_map;
 static_assert(THREADING_USE_GIL, "have to make the generator map thread safe!");
 
@@ -61,56 +177,58 @@ public:
     }
 };
 
-static void freeGeneratorStack(BoxedGenerator* g) {
-    if (g->stack_begin == NULL)
-        return;
-
-    available_addrs.push_back((uint64_t)g->stack_begin);
-    // Limit the number of generator stacks we keep around:
-    if (available_addrs.size() > 5) {
-        uint64_t addr = available_addrs.front();
-        available_addrs.pop_front();
-        int r = munmap((void*)(addr - MAX_STACK_SIZE), MAX_STACK_SIZE);
-        assert(r == 0);
-    }
-
-    g->stack_begin = NULL;
-}
-
 Context* getReturnContextForGeneratorFrame(void* frame_addr) {
     BoxedGenerator* generator = s_generator_map[frame_addr];
     assert(generator);
     return generator->returnContext;
 }
 
+// Continues a stackless generator which moved to a stack of its own (see generatorStepStackless()) until it exits.
+static void runLeftStacklessGenerator(BoxedGenerator* g) noexcept {
+    try {
+        RELEASE_ASSERT(!resumeStacklessGenerator(g), "it yields by switching contexts now");
+    } catch (ExcInfo e) {
+        g->exception = e;
+    }
+    freeStacklessGeneratorFrame(g);
+}
+
 void generatorEntry(BoxedGenerator* g) noexcept {
     {
         assert(g->cls == generator_cls);
         assert(g->function->cls == function_cls);
 
-        assert(g->returnValue == Py_None);
-        Py_CLEAR(g->returnValue);
+        // A generator which left stackless mode is already running, and returnValue holds the value sent into it:
+        bool left_stackless = g->stackless_interpreter;
+        if (!left_stackless) {
+            assert(g->returnValue == Py_None);
+            Py_CLEAR(g->returnValue);
+        }
 
         {
             RegisterHelper context_registerer(g, __builtin_frame_address(0));
 
             g->top_caller_frame_info = (FrameInfo*)cur_thread_state.frame_info;
 
-            // call body of the generator
-            BoxedFunctionBase* func = g->function;
-            // unnecessary because the generator owns g->function
-            // KEEP_ALIVE(func);
-
-            Box** args = g->args ? &g->args->elts[0] : nullptr;
-            auto r = callCLFunc<ExceptionStyle::CAPI, NOT_REWRITABLE>(func->code, nullptr,
-                                                                      func->code->numReceivedArgs(), func->closure, g,
-                                                                      func->globals, g->arg1, g->arg2, g->arg3, args);
-            if (r)
-                Py_DECREF(r);
-            else {
-                // unhandled exception: propagate the exception to the caller
-                PyErr_Fetch(&g->exception.type, &g->exception.value, &g->exception.traceback);
-                PyErr_Clear();
+            if (left_stackless) {
+                runLeftStacklessGenerator(g);
+            } else {
+                // call body of the generator
+                BoxedFunctionBase* func = g->function;
+                // unnecessary because the generator owns g->function
+                // KEEP_ALIVE(func);
+
+                Box** args = g->args ? &g->args->elts[0] : nullptr;
+                auto r = callCLFunc<ExceptionStyle::CAPI, NOT_REWRITABLE>(
+                    func->code, nullptr, func->code->numReceivedArgs(), func->closure, g, func->globals, g->arg1,
+                    g->arg2, g->arg3, args);
+                if (r)
+                    Py_DECREF(r);
+                else {
+                    // unhandled exception: propagate the exception to the caller
+                    PyErr_Fetch(&g->exception.type, &g->exception.value, &g->exception.traceback);
+                    PyErr_Clear();
+                }
             }
         }
 
@@ -121,6 +239,58 @@ void generatorEntry(BoxedGenerator* g) noexcept {
     swapContext(&g->context, g->returnContext, 0);
 }
 
+static bool generatorStarted(BoxedGenerator* g) {
+    if (g->stackless_interpreter || g->entryExited)
+        return true;
+    return !g->stackless && g->returnContext;
+}
+
+static void generatorAllocStack(BoxedGenerator* g) {
+    g->stack_begin = (void*)allocGeneratorStack(g->function->code->generator_needs_large_stack);
+
+    assert(((intptr_t)g->stack_begin & (~(intptr_t)(0xF))) == (intptr_t)g->stack_begin && "stack must be aligned");
+
+    g->context = makeContext(g->stack_begin, (void (*)(intptr_t))generatorEntry);
+}
+
+// Runs a stackless generator until it yields or exits, like a context switch into generatorEntry() would.
+// Returns true if it left stackless mode without yielding, in which case it has to continue on its new stack right
+// away.
+static bool generatorStepStackless(BoxedGenerator* g) {
+    if (!g->stackless_interpreter) {
+        assert(g->returnValue == Py_None);
+        Py_CLEAR(g->returnValue);
+
+        // An exception thrown into a generator which hasn't started yet finishes it without running any of its code:
+        if (g->exception.type) {
+            g->entryExited = true;
+            return false;
+        }
+    }
+
+    try {
+        if (!resumeStacklessGenerator(g))
+            g->entryExited = true;
+    } catch (ExcInfo e) {
+        g->exception = e;
+        g->entryExited = true;
+    }
+
+    if (g->entryExited) {
+        freeStacklessGeneratorFrame(g);
+        return false;
+    }
+
+    if (!leaveStacklessMode(g))
+        return false;
+
+    // From now on it works like any other generator, except that generatorEntry() resumes the existing interpreter:
+    g->stackless = false;
+    generatorAllocStack(g);
+    // It either got suspended at a yield (and returnValue holds the yielded value), or in the middle of a hot loop:
+    return !g->returnValue;
+}
+
 Box* generatorIter(Box* s) {
     return incref(s);
 }
@@ -129,7 +299,7 @@ Box* generatorIter(Box* s) {
 template <ExceptionStyle S> static bool generatorSendInternal(BoxedGenerator* self, Box* v) noexcept(S == CAPI) {
     STAT_TIMER(t0, "us_timer_generator_switching", 0);
 
-    if (!self->returnContext && v != Py_None) {
+    if (!generatorStarted(self) && v != Py_None) {
         if (S == CAPI) {
             PyErr_SetString(TypeError, "can't send non-None value to a just-started generator");
             return true;
@@ -159,25 +329,28 @@ template <ExceptionStyle S> static bool generatorSendInternal(BoxedGenerator* se
     self->returnValue = incref(v);
     self->running = true;
 
+    // A stackless generator runs right here, on our stack, unless it has to continue on a stack of its own:
+    if (!self->stackless || generatorStepStackless(self)) {
 #if STAT_TIMERS
-    if (!self->prev_stack)
-        self->prev_stack = StatTimer::createStack(self->my_timer);
-    else
-        self->prev_stack = StatTimer::swapStack(self->prev_stack);
+        if (!self->prev_stack)
+            self->prev_stack = StatTimer::createStack(self->my_timer);
+        else
+            self->prev_stack = StatTimer::swapStack(self->prev_stack);
 #endif
-    auto* top_caller_frame_info = (FrameInfo*)cur_thread_state.frame_info;
-    swapContext(&self->returnContext, self->context, (intptr_t)self);
-    assert(cur_thread_state.frame_info == top_caller_frame_info
-           && "the generator should reset the frame info before the swapContext");
+        auto* top_caller_frame_info = (FrameInfo*)cur_thread_state.frame_info;
+        swapContext(&self->returnContext, self->context, (intptr_t)self);
+        assert(cur_thread_state.frame_info == top_caller_frame_info
+               && "the generator should reset the frame info before the swapContext");
 
 
 #if STAT_TIMERS
-    self->prev_stack = StatTimer::swapStack(self->prev_stack);
-    if (self->entryExited) {
-        assert(self->prev_stack == &self->my_timer);
-        assert(self->my_timer.isPaused());
-    }
+        self->prev_stack = StatTimer::swapStack(self->prev_stack);
+        if (self->entryExited) {
+            assert(self->prev_stack == &self->my_timer);
+            assert(self->my_timer.isPaused());
+        }
 #endif
+    }
 
     self->running = false;
 
@@ -466,7 +639,9 @@ extern "C" BoxedGenerator::BoxedGenerator(BoxedFunctionBase* function, Box* arg1
       context(nullptr),
       returnContext(nullptr),
       top_caller_frame_info(nullptr),
-      paused_frame_info(nullptr)
+      paused_frame_info(nullptr),
+      stackless(false),
+      stackless_interpreter(nullptr)
 #if STAT_TIMERS
       ,
       prev_stack(NULL),
@@ -491,58 +666,13 @@ extern "C" BoxedGenerator::BoxedGenerator(BoxedFunctionBase* function, Box* arg1
         }
     }
 
-    static StatCounter generator_stack_reused("generator_stack_reused");
-    static StatCounter generator_stack_created("generator_stack_created");
-
-    void* initial_stack_limit;
-    if (available_addrs.size() == 0) {
-        generator_stack_created.log();
-
-        uint64_t stack_low = next_stack_addr;
-        uint64_t stack_high = stack_low + MAX_STACK_SIZE;
-        next_stack_addr = stack_high;
-
-#if STACK_GROWS_DOWN
-        this->stack_begin = (void*)stack_high;
-
-        initial_stack_limit = (void*)(stack_high - INITIAL_STACK_SIZE);
-        void* p = mmap(initial_stack_limit, INITIAL_STACK_SIZE, PROT_READ | PROT_WRITE,
-                       MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS | MAP_GROWSDOWN, -1, 0);
-        ASSERT(p == initial_stack_limit, "%p %s", p, strerror(errno));
-
-        // Create an inaccessible redzone so that the generator stack won't grow indefinitely.
-        // Looks like it throws a SIGBUS if we reach the redzone; it's unclear if that's better
-        // or worse than being able to consume all available memory.
-        void* p2
-            = mmap((void*)stack_low, STACK_REDZONE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
-        assert(p2 == (void*)stack_low);
-        // Interestingly, it seems like MAP_GROWSDOWN will leave a page-size gap between the redzone and the growable
-        // region.
-
-        if (VERBOSITY() >= 3) {
-            printf("Created new generator stack, starts at %p, currently extends to %p\n", (void*)stack_high,
-                   initial_stack_limit);
-            printf("Created a redzone from %p-%p\n", (void*)stack_low, (void*)(stack_low + STACK_REDZONE_SIZE));
-        }
-#else
-#error "implement me"
-#endif
-    } else {
-        generator_stack_reused.log();
-
-#if STACK_GROWS_DOWN
-        uint64_t stack_high = available_addrs.back();
-        this->stack_begin = (void*)stack_high;
-        initial_stack_limit = (void*)(stack_high - INITIAL_STACK_SIZE);
-        available_addrs.pop_back();
-#else
-#error "implement me"
-#endif
+    if (canRunGeneratorStackless(function->code)) {
+        this->stackless = true;
+        this->stack_begin = NULL;
+        return;
     }
 
-    assert(((intptr_t)stack_begin & (~(intptr_t)(0xF))) == (intptr_t)stack_begin && "stack must be aligned");
-
-    context = makeContext(stack_begin, (void (*)(intptr_t))generatorEntry);
+    generatorAllocStack(this);
 }
 
 Box* generator_name(Box* _self, void* context) noexcept {
@@ -667,6 +797,7 @@ static void generator_dealloc(BoxedGenerator* self) noexcept {
     _PyObject_GC_UNTRACK(self);
 
     freeGeneratorStack(self);
+    freeStacklessGeneratorFrame(self);
 
     int numArgs = self->function->code->numReceivedArgs();
     if (numArgs > 3) {
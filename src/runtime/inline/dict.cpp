@@ -19,7 +19,7 @@
 
 namespace pyston {
 
-BoxedDictIterator::BoxedDictIterator(BoxedDict* d) : d(d), it(d->d.begin()), itEnd(d->d.end()) {
+BoxedDictIterator::BoxedDictIterator(BoxedDict* d) : d(d), it(d->d.begin()) {
     Py_INCREF(d);
 }
 
@@ -52,7 +52,7 @@ Box* dictIterIter(Box* s) {
 llvm_compat_bool dictIterHasnextUnboxed(Box* s) {
     BoxedDictIterator* self = static_cast<BoxedDictIterator*>(s);
 
-    return self->it != self->itEnd;
+    return self->it != self->d->d.end();
 }
 
 Box* dictIterHasnext(Box* s) {
@@ -62,7 +62,7 @@ Box* dictIterHasnext(Box* s) {
 Box* dictiter_next(Box* s) noexcept {
     BoxedDictIterator* self = static_cast<BoxedDictIterator*>(s);
 
-    if (self->it == self->itEnd)
+    if (self->it == self->d->d.end())
         return NULL;
 
     Box* rtn = nullptr;
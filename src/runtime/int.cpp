@@ -399,14 +399,15 @@ extern "C" Box* add_i64_i64(i64 lhs, i64 rhs) {
     i64 result;
     if (!__builtin_saddl_overflow(lhs, rhs, &result))
         return boxInt(result);
-    return longAdd(autoDecref(boxLong(lhs)), autoDecref(boxLong(rhs)));
+    // The result always fits into 128 bits:
+    return boxLongFromInt128((__int128)lhs + (__int128)rhs);
 }
 
 extern "C" Box* sub_i64_i64(i64 lhs, i64 rhs) {
     i64 result;
     if (!__builtin_ssubl_overflow(lhs, rhs, &result))
         return boxInt(result);
-    return longSub(autoDecref(boxLong(lhs)), autoDecref(boxLong(rhs)));
+    return boxLongFromInt128((__int128)lhs - (__int128)rhs);
 }
 
 extern "C" Box* div_i64_i64(i64 lhs, i64 rhs) {
@@ -492,7 +493,7 @@ extern "C" Box* mul_i64_i64(i64 lhs, i64 rhs) {
     i64 result;
     if (!__builtin_smull_overflow(lhs, rhs, &result))
         return boxInt(result);
-    return longMul(autoDecref(boxLong(lhs)), autoDecref(boxLong(rhs)));
+    return boxLongFromInt128((__int128)lhs * (__int128)rhs);
 }
 
 extern "C" Box* intAddInt(BoxedInt* lhs, BoxedInt* rhs) {
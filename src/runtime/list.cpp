@@ -928,75 +928,6 @@ extern "C" int PyList_Reverse(PyObject* v) noexcept {
     return 0;
 }
 
-class PyCmpComparer {
-private:
-    Box* cmp;
-
-public:
-    PyCmpComparer(Box* cmp) : cmp(cmp) {}
-    bool operator()(Box* lhs, Box* rhs) {
-        Box* r = runtimeCallInternal<CXX, NOT_REWRITABLE>(cmp, NULL, ArgPassSpec(2), lhs, rhs, NULL, NULL, NULL);
-        AUTO_DECREF(r);
-        if (!PyInt_Check(r))
-            raiseExcHelper(TypeError, "comparison function must return int, not %.200s", r->cls->tp_name);
-        return static_cast<BoxedInt*>(r)->n < 0;
-    }
-};
-
-void _sortArray(Box** elts, long num_elts, Box* cmp, Box* key) {
-    // TODO(kmod): maybe we should just switch to CPython's sort.  not sure how the algorithms compare,
-    // but they specifically try to support cases where __lt__ or the cmp function might end up inspecting
-    // the current list being sorted.
-    // I also don't know if std::stable_sort is exception-safe.
-
-    if (cmp) {
-        assert(!key);
-        std::stable_sort<Box**, PyCmpComparer>(elts, elts + num_elts, PyCmpComparer(cmp));
-    } else {
-        int num_keys_added = 0;
-        auto remove_keys = [&]() {
-            for (int i = 0; i < num_keys_added; i++) {
-                Box** obj_loc = &elts[i];
-                assert((*obj_loc)->cls == tuple_cls);
-                BoxedTuple* t = static_cast<BoxedTuple*>(*obj_loc);
-                *obj_loc = t->elts[2];
-                Py_DECREF(t);
-            }
-        };
-
-        try {
-            if (key) {
-                for (int i = 0; i < num_elts; i++) {
-                    Box** obj_loc = &elts[i];
-
-                    Box* key_val = runtimeCall(key, ArgPassSpec(1), *obj_loc, NULL, NULL, NULL, NULL);
-                    AUTO_DECREF(key_val);
-
-                    // Add the index as part of the new tuple so that the comparison never hits the
-                    // original object.
-                    // TODO we could potentially make this faster by copying the CPython approach of
-                    // creating special sortwrapper objects that compare only based on the key.
-                    Box* new_obj = BoxedTuple::create({ key_val, autoDecref(boxInt(i)), *obj_loc });
-
-                    *obj_loc = new_obj;
-                    num_keys_added++;
-                }
-            }
-
-            // We don't need to do a stable sort if there's a keyfunc, since we explicitly added the index
-            // as part of the sort key.
-            // But we might want to get rid of that approach?  CPython doesn't do that (they create special
-            // wrapper objects that compare only based on the key).
-            std::stable_sort<Box**, PyLt>(elts, elts + num_elts, PyLt());
-        } catch (ExcInfo e) {
-            remove_keys();
-            throw e;
-        }
-
-        remove_keys();
-    }
-}
-
 extern "C" Box* PyList_GetSlice(PyObject* a, Py_ssize_t ilow, Py_ssize_t ihigh) noexcept {
     assert(PyList_Check(a));
     BoxedList* self = static_cast<BoxedList*>(a);
@@ -1005,6 +936,26 @@ extern "C" Box* PyList_GetSlice(PyObject* a, Py_ssize_t ilow, Py_ssize_t ihigh)
         self, autoDecref(new BoxedSlice(autoDecref(boxInt(ilow)), autoDecref(boxInt(ihigh)), autoDecref(boxInt(1)))));
 }
 
+// The equality test of __contains__, count(), index() and remove().  Most lists that get searched hold elements of a
+// single builtin type, so we compare exact ints, floats and strs with each other directly instead of dispatching
+// through PyObject_RichCompareBool() for every element.  Returns -1 with an exception set like the latter.
+static inline int listEltEq(Box* lhs, Box* rhs) {
+    if (lhs == rhs)
+        return 1;
+
+    BoxedClass* cls = lhs->cls;
+    if (cls == rhs->cls) {
+        if (cls == int_cls)
+            return static_cast<BoxedInt*>(lhs)->n == static_cast<BoxedInt*>(rhs)->n;
+        if (cls == float_cls)
+            return static_cast<BoxedFloat*>(lhs)->d == static_cast<BoxedFloat*>(rhs)->d;
+        if (cls == str_cls)
+            return static_cast<BoxedString*>(lhs)->s() == static_cast<BoxedString*>(rhs)->s();
+    }
+
+    return PyObject_RichCompareBool(lhs, rhs, Py_EQ);
+}
+
 static inline int listContainsShared(BoxedList* self, Box* elt) {
     assert(PyList_Check(self));
 
@@ -1012,11 +963,7 @@ static inline int listContainsShared(BoxedList* self, Box* elt) {
     for (int i = 0; i < size; i++) {
         Box* e = self->elts->elts[i];
 
-        bool identity_eq = e == elt;
-        if (identity_eq)
-            return true;
-
-        int r = PyObject_RichCompareBool(elt, e, Py_EQ);
+        int r = listEltEq(elt, e);
         if (r == -1)
             throwCAPIException();
 
@@ -1084,7 +1031,7 @@ Box* listCount(BoxedList* self, Box* elt) {
     for (int i = 0; i < size; i++) {
         Box* e = self->elts->elts[i];
 
-        int r = PyObject_RichCompareBool(e, elt, Py_EQ);
+        int r = listEltEq(e, elt);
         if (r == -1)
             throwCAPIException();
 
@@ -1121,7 +1068,7 @@ Box* listIndex(BoxedList* self, Box* elt, Box* _start, Box** args) {
     for (int64_t i = start; i < stop && i < self->size; i++) {
         Box* e = self->elts->elts[i];
 
-        int r = PyObject_RichCompareBool(e, elt, Py_EQ);
+        int r = listEltEq(e, elt);
         if (r == -1)
             throwCAPIException();
 
@@ -1139,7 +1086,7 @@ Box* listRemove(BoxedList* self, Box* elt) {
     for (int i = 0; i < self->size; i++) {
         Box* e = self->elts->elts[i];
 
-        int r = PyObject_RichCompareBool(e, elt, Py_EQ);
+        int r = listEltEq(e, elt);
         if (r == -1)
             throwCAPIException();
 
@@ -63,8 +63,49 @@ int _PyLong_DigitValue[256] = {
 #define IS_LITTLE_ENDIAN (int)*(unsigned char*)&one
 #define PY_ABS_LLONG_MIN (0 - (unsigned PY_LONG_LONG)PY_LLONG_MIN)
 
+// GMP allocates the limbs of all the mpz_t's (and mpfr_t's) through these functions.  The blocks allocated here get
+// a header word in front of them, so that they can be told apart from the inline limbs of a BoxedLong, which GMP passes
+// to us when the value outgrows them.
+#define LONG_HEAP_LIMBS_HEADER 0ULL
+
+static bool isInlineLimbs(void* ptr) {
+    return ((uint64_t*)ptr)[-1] == LONG_INLINE_LIMBS_MARKER;
+}
+
+static void* gmpAlloc(size_t size) {
+    uint64_t* block = (uint64_t*)malloc(size + sizeof(uint64_t));
+    RELEASE_ASSERT(block, "out of memory");
+    block[0] = LONG_HEAP_LIMBS_HEADER;
+    return block + 1;
+}
+
+static void* gmpRealloc(void* ptr, size_t old_size, size_t new_size) {
+    if (isInlineLimbs(ptr)) {
+        void* rtn = gmpAlloc(new_size);
+        memcpy(rtn, ptr, std::min(old_size, new_size));
+        return rtn;
+    }
+
+    uint64_t* block = (uint64_t*)realloc((uint64_t*)ptr - 1, new_size + sizeof(uint64_t));
+    RELEASE_ASSERT(block, "out of memory");
+    return block + 1;
+}
+
+static void gmpFree(void* ptr, size_t size) {
+    if (isInlineLimbs(ptr))
+        return;
+    free((uint64_t*)ptr - 1);
+}
+
+// This has to be called before any GMP memory gets allocated.
+void setupGMPMemoryFunctions() {
+    mp_set_memory_functions(gmpAlloc, gmpRealloc, gmpFree);
+}
+
 void BoxedLong::tp_dealloc(Box* b) noexcept {
-    mpz_clear(static_cast<BoxedLong*>(b)->n);
+    BoxedLong* l = static_cast<BoxedLong*>(b);
+    if (!l->usesInlineLimbs())
+        mpz_clear(l->n);
     b->cls->tp_free(b);
 }
 
@@ -74,7 +115,7 @@ extern "C" int _PyLong_Sign(PyObject* l) noexcept {
 
 extern "C" PyObject* _PyLong_Copy(PyLongObject* src) noexcept {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set(rtn->n, ((BoxedLong*)src)->n);
+    mpz_set(rtn->n, ((BoxedLong*)src)->n);
     return rtn;
 }
 
@@ -220,9 +261,9 @@ extern "C" PyObject* PyLong_FromString(const char* str, char** pend, int base) n
     BoxedLong* rtn = new BoxedLong();
     int r = 0;
     if (str_ref_trimmed != str_ref)
-        r = mpz_init_set_str(rtn->n, str_ref_trimmed.str().c_str(), base);
+        r = mpz_set_str(rtn->n, str_ref_trimmed.str().c_str(), base);
     else
-        r = mpz_init_set_str(rtn->n, str, base);
+        r = mpz_set_str(rtn->n, str, base);
 
     if (pend) {
         *pend = const_cast<char*>(str) + str_ref.size();
@@ -423,13 +464,13 @@ extern "C" PyObject* PyLong_FromDouble(double v) noexcept {
     }
 
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_d(rtn->n, v);
+    mpz_set_d(rtn->n, v);
     return rtn;
 }
 
 extern "C" PyObject* PyLong_FromLong(long ival) noexcept {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_si(rtn->n, ival);
+    mpz_set_si(rtn->n, ival);
     return rtn;
 }
 
@@ -453,7 +494,7 @@ extern "C" PyObject* PyLong_FromUnicode(Py_UNICODE* u, Py_ssize_t length, int ba
 
 extern "C" PyObject* PyLong_FromUnsignedLong(unsigned long ival) noexcept {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_ui(rtn->n, ival);
+    mpz_set_ui(rtn->n, ival);
     return rtn;
 }
 
@@ -614,7 +655,6 @@ extern "C" PyObject* _PyLong_FromByteArray(const unsigned char* bytes, size_t n,
     }
 
     BoxedLong* rtn = new BoxedLong();
-    mpz_init(rtn->n);
     mpz_import(rtn->n, 1, 1, n, little_endian ? -1 : 1, 0, &bytes[0]);
 
 
@@ -637,33 +677,49 @@ extern "C" void _PyLong_AsMPZ(PyObject* obj, _PyLongMPZ num) noexcept {
 
 extern "C" PyObject* _PyLong_FromMPZ(const _PyLongMPZ num) noexcept {
     BoxedLong* r = new BoxedLong();
-    mpz_init_set(r->n, (mpz_srcptr)num);
+    mpz_set(r->n, (mpz_srcptr)num);
     return r;
 }
 
 extern "C" Box* createLong(llvm::StringRef s) {
     BoxedLong* rtn = new BoxedLong();
     assert(s.data()[s.size()] == '\0');
-    int r = mpz_init_set_str(rtn->n, s.data(), 10);
+    int r = mpz_set_str(rtn->n, s.data(), 10);
     RELEASE_ASSERT(r == 0, "%d: '%s'", r, s.data());
     return rtn;
 }
 
 extern "C" BoxedLong* boxLong(int64_t n) {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_si(rtn->n, n);
+    mpz_set_si(rtn->n, n);
+    return rtn;
+}
+
+// For the results of int operations which overflowed; fills in the (inline) limbs directly.
+BoxedLong* boxLongFromInt128(__int128 n) {
+    static_assert(sizeof(mp_limb_t) == 8 && GMP_NAIL_BITS == 0, "");
+
+    BoxedLong* rtn = new BoxedLong();
+    assert(rtn->usesInlineLimbs() && rtn->n->_mp_alloc >= 2);
+
+    unsigned __int128 magnitude = n < 0 ? -(unsigned __int128)n : (unsigned __int128)n;
+    mp_limb_t lo = (mp_limb_t)magnitude, hi = (mp_limb_t)(magnitude >> 64);
+    rtn->n->_mp_d[0] = lo;
+    rtn->n->_mp_d[1] = hi;
+    int size = hi ? 2 : (lo ? 1 : 0);
+    rtn->n->_mp_size = n < 0 ? -size : size;
     return rtn;
 }
 
 extern "C" PyObject* PyLong_FromLongLong(long long ival) noexcept {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_si(rtn->n, ival);
+    mpz_set_si(rtn->n, ival);
     return rtn;
 }
 
 extern "C" PyObject* PyLong_FromUnsignedLongLong(unsigned long long ival) noexcept {
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set_ui(rtn->n, ival);
+    mpz_set_ui(rtn->n, ival);
     return rtn;
 }
 
@@ -773,7 +829,7 @@ template <ExceptionStyle S> Box* longNew(Box* _cls, Box* val, Box* base) noexcep
 
     BoxedLong* rtn = new (cls) BoxedLong();
 
-    mpz_init_set(rtn->n, l->n);
+    mpz_set(rtn->n, l->n);
     return rtn;
 }
 
@@ -786,7 +842,7 @@ Box* longInt(Box* v) {
     static_assert(sizeof(BoxedInt::n) == sizeof(long), "");
     if (overflow) {
         BoxedLong* rtn = new BoxedLong();
-        mpz_init_set(rtn->n, ((BoxedLong*)v)->n);
+        mpz_set(rtn->n, ((BoxedLong*)v)->n);
         return rtn;
     } else
         return boxInt(n);
@@ -798,7 +854,7 @@ Box* longToLong(Box* self) noexcept {
     } else {
         assert(PyLong_Check(self));
         BoxedLong* l = new BoxedLong();
-        mpz_init_set(l->n, static_cast<BoxedLong*>(self)->n);
+        mpz_set(l->n, static_cast<BoxedLong*>(self)->n);
         return l;
     }
 }
@@ -896,7 +952,6 @@ Box* longNeg(BoxedLong* v1) {
         raiseExcHelper(TypeError, "descriptor '__neg__' requires a 'long' object but received a '%s'", getTypeName(v1));
 
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
     mpz_neg(r->n, v1->n);
     return r;
 }
@@ -909,7 +964,7 @@ Box* longPos(BoxedLong* v) {
         return incref(v);
     } else {
         BoxedLong* r = new BoxedLong();
-        mpz_init_set(r->n, v->n);
+        mpz_set(r->n, v->n);
         return r;
     }
 }
@@ -917,7 +972,6 @@ Box* longPos(BoxedLong* v) {
 Box* longAbs(BoxedLong* v1) {
     assert(PyLong_Check(v1));
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
     mpz_abs(r->n, v1->n);
     return r;
 }
@@ -930,14 +984,12 @@ Box* longAdd(BoxedLong* v1, Box* _v2) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_add(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2 = static_cast<BoxedInt*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         if (v2->n >= 0)
             mpz_add_ui(r->n, v1->n, v2->n);
         else
@@ -948,6 +1000,20 @@ Box* longAdd(BoxedLong* v1, Box* _v2) {
     }
 }
 
+// A read-only mpz_t with the value of an int, which doesn't need any allocations.
+struct IntAsMpz {
+    mp_limb_t limb;
+    mpz_t n;
+
+    IntAsMpz(int64_t v) {
+        limb = v < 0 ? -(mp_limb_t)v : (mp_limb_t)v;
+        n->_mp_alloc = 1;
+        n->_mp_size = v < 0 ? -1 : (v ? 1 : 0);
+        n->_mp_d = &limb;
+    }
+    IntAsMpz(const IntAsMpz&) = delete;
+};
+
 // TODO: split common code out into a helper function
 extern "C" Box* longAnd(BoxedLong* v1, Box* _v2) {
     if (!PyLong_Check(v1))
@@ -955,21 +1021,12 @@ extern "C" Box* longAnd(BoxedLong* v1, Box* _v2) {
     if (PyLong_Check(_v2)) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_and(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2_int = static_cast<BoxedInt*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
-        mpz_t v2_long;
-        mpz_init(v2_long);
-        if (v2_int->n >= 0)
-            mpz_init_set_ui(v2_long, v2_int->n);
-        else
-            mpz_init_set_si(v2_long, v2_int->n);
-
-        mpz_and(r->n, v1->n, v2_long);
+        mpz_and(r->n, v1->n, IntAsMpz(v2_int->n).n);
         return r;
     }
     return incref(NotImplemented);
@@ -981,21 +1038,12 @@ extern "C" Box* longOr(BoxedLong* v1, Box* _v2) {
     if (PyLong_Check(_v2)) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_ior(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2_int = static_cast<BoxedInt*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
-        mpz_t v2_long;
-        mpz_init(v2_long);
-        if (v2_int->n >= 0)
-            mpz_init_set_ui(v2_long, v2_int->n);
-        else
-            mpz_init_set_si(v2_long, v2_int->n);
-
-        mpz_ior(r->n, v1->n, v2_long);
+        mpz_ior(r->n, v1->n, IntAsMpz(v2_int->n).n);
         return r;
     }
     return incref(NotImplemented);
@@ -1007,21 +1055,12 @@ extern "C" Box* longXor(BoxedLong* v1, Box* _v2) {
     if (PyLong_Check(_v2)) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_xor(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2_int = static_cast<BoxedInt*>(_v2);
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
-        mpz_t v2_long;
-        mpz_init(v2_long);
-        if (v2_int->n >= 0)
-            mpz_init_set_ui(v2_long, v2_int->n);
-        else
-            mpz_init_set_si(v2_long, v2_int->n);
-
-        mpz_xor(r->n, v1->n, v2_long);
+        mpz_xor(r->n, v1->n, IntAsMpz(v2_int->n).n);
         return r;
     }
     return incref(NotImplemented);
@@ -1050,7 +1089,7 @@ Box* convertToLong(Box* val) {
     } else if (PyInt_Check(val)) {
         BoxedInt* val_int = static_cast<BoxedInt*>(val);
         BoxedLong* r = new BoxedLong();
-        mpz_init_set_si(r->n, val_int->n);
+        mpz_set_si(r->n, val_int->n);
         return r;
     } else {
         return incref(NotImplemented);
@@ -1074,7 +1113,6 @@ Box* longLShiftLong(BoxedLong* lhs, Box* _rhs) {
 
     uint64_t n = asUnsignedLong(rhs_long);
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
     mpz_mul_2exp(r->n, lhs->n, n);
     return r;
 }
@@ -1117,7 +1155,6 @@ Box* longRShiftLong(BoxedLong* lhs, Box* _rhs) {
 
     uint64_t n = asUnsignedLong(rhs_long);
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
     mpz_div_2exp(r->n, lhs->n, n);
     return r;
 }
@@ -1169,14 +1206,12 @@ Box* longSub(BoxedLong* v1, Box* _v2) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_sub(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2 = static_cast<BoxedInt*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         if (v2->n >= 0)
             mpz_sub_ui(r->n, v1->n, v2->n);
         else
@@ -1203,14 +1238,12 @@ Box* longMul(BoxedLong* v1, Box* _v2) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_mul(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2 = static_cast<BoxedInt*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_mul_si(r->n, v1->n, v2->n);
         return r;
     } else {
@@ -1229,7 +1262,6 @@ Box* longDiv(BoxedLong* v1, Box* _v2) {
             raiseExcHelper(ZeroDivisionError, "long division or modulo by zero");
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_fdiv_q(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
@@ -1239,7 +1271,7 @@ Box* longDiv(BoxedLong* v1, Box* _v2) {
             raiseExcHelper(ZeroDivisionError, "long division or modulo by zero");
 
         BoxedLong* r = new BoxedLong();
-        mpz_init_set_si(r->n, v2->n);
+        mpz_set_si(r->n, v2->n);
         mpz_fdiv_q(r->n, v1->n, r->n);
         return r;
     } else {
@@ -1265,7 +1297,6 @@ Box* longMod(BoxedLong* v1, Box* _v2) {
             raiseExcHelper(ZeroDivisionError, "long division or modulo by zero");
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_mmod(r->n, v1->n, v2->n);
         return r;
     } else if (PyInt_Check(_v2)) {
@@ -1275,7 +1306,7 @@ Box* longMod(BoxedLong* v1, Box* _v2) {
             raiseExcHelper(ZeroDivisionError, "long division or modulo by zero");
 
         BoxedLong* r = new BoxedLong();
-        mpz_init_set_si(r->n, v2->n);
+        mpz_set_si(r->n, v2->n);
         mpz_mmod(r->n, v1->n, r->n);
         return r;
     } else {
@@ -1319,8 +1350,6 @@ Box* longDivmodLong(BoxedLong* lhs, Box* _rhs) {
     BoxedLong* r = new BoxedLong();
     AUTO_DECREF(q);
     AUTO_DECREF(r);
-    mpz_init(q->n);
-    mpz_init(r->n);
     mpz_fdiv_qr(q->n, r->n, lhs->n, rhs_long->n);
     return BoxedTuple::create({ q, r });
 }
@@ -1361,14 +1390,13 @@ Box* longRdiv(BoxedLong* v1, Box* _v2) {
         BoxedLong* v2 = static_cast<BoxedLong*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init(r->n);
         mpz_fdiv_q(r->n, v2->n, v1->n);
         return r;
     } else if (PyInt_Check(_v2)) {
         BoxedInt* v2 = static_cast<BoxedInt*>(_v2);
 
         BoxedLong* r = new BoxedLong();
-        mpz_init_set_si(r->n, v2->n);
+        mpz_set_si(r->n, v2->n);
         mpz_fdiv_q(r->n, r->n, v1->n);
         return r;
     } else {
@@ -1504,7 +1532,6 @@ Box* longPowLong(BoxedLong* lhs, Box* _rhs, Box* _mod) {
     }
 
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
 
     if (_mod != Py_None) {
         mpz_powm(r->n, lhs->n, rhs_long->n, mod_long->n);
@@ -1560,7 +1587,6 @@ extern "C" Box* longInvert(BoxedLong* v) {
                        getTypeName(v));
 
     BoxedLong* r = new BoxedLong();
-    mpz_init(r->n);
     mpz_com(r->n, v->n);
     return r;
 }
@@ -1625,7 +1651,7 @@ extern "C" Box* longIndex(BoxedLong* v) noexcept {
     if (PyLong_CheckExact(v))
         return incref(v);
     BoxedLong* rtn = new BoxedLong();
-    mpz_init_set(rtn->n, v->n);
+    mpz_set(rtn->n, v->n);
     return rtn;
 }
 
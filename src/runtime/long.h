@@ -24,14 +24,35 @@
 namespace pyston {
 
 void setupLong();
+void setupGMPMemoryFunctions();
 
 extern BoxedClass* long_cls;
 
+// Marks the inline limbs of a BoxedLong for our GMP memory functions.
+#define LONG_INLINE_LIMBS_MARKER 0x6c6f6e67696e6cULL
+
 class BoxedLong : public Box {
 public:
+    // Always initialized (by the constructor), so use mpz_set* instead of mpz_init_set* on it.
     mpz_t n;
 
-    BoxedLong() __attribute__((visibility("default"))) {}
+private:
+    static const int NUM_INLINE_LIMBS = 2;
+
+    // Values up to 128 bits are stored in the object itself, so that they don't need a separate allocation.  GMP
+    // doesn't know about this: it passes these limbs to our memory functions (see setupGMPMemoryFunctions()) once the
+    // value outgrows them, which recognize them by the marker in front of them.
+    uint64_t inline_limbs_marker;
+    mp_limb_t inline_limbs[NUM_INLINE_LIMBS];
+
+public:
+    BoxedLong() __attribute__((visibility("default"))) : inline_limbs_marker(LONG_INLINE_LIMBS_MARKER) {
+        n->_mp_alloc = NUM_INLINE_LIMBS;
+        n->_mp_size = 0;
+        n->_mp_d = inline_limbs;
+    }
+
+    bool usesInlineLimbs() const { return n->_mp_d == inline_limbs; }
 
     static void tp_dealloc(Box* b) noexcept;
 
@@ -40,6 +61,7 @@ public:
 
 extern "C" Box* createLong(llvm::StringRef s);
 extern "C" BoxedLong* boxLong(int64_t n);
+BoxedLong* boxLongFromInt128(__int128 n);
 
 Box* longNeg(BoxedLong* lhs);
 Box* longAbs(BoxedLong* v1);
@@ -1280,6 +1280,87 @@ static HCAttrs::AttrList* reallocAttrs(HCAttrs::AttrList* attrs, int old_nattrs,
     return rtn;
 }
 
+// The dict-backed instances of a class usually end up with the same attributes, so we let their dicts share one copy
+// of the keys (see CompactMap::trySplit()).  BoxedClass has no space left for them, so they live in this side table.
+struct SharedInstanceDictKeys {
+    BoxedDict::DictMap::SharedKeys* keys;
+    // We hold a reference to the keys which were there when we created them, so that the layout stays valid when the
+    // instances go away.  The keys which the instances append later are owned by those.
+    uint32_t num_referenced;
+    // Only used to recognize the dict of the first instance (it might not be alive anymore): we wait for a second
+    // instance before creating the keys, so that we don't create them while the first one is still getting set up.
+    Box* first_dict;
+};
+static llvm::DenseMap<BoxedClass*, SharedInstanceDictKeys> shared_instance_dict_keys;
+
+static void releaseSharedInstanceDictKeys(SharedInstanceDictKeys& shared) {
+    auto entries = BoxedDict::DictMap::sharedEntries(shared.keys);
+    for (uint32_t i = 0; i < shared.num_referenced; i++)
+        Py_DECREF(entries[i].first.value);
+    BoxedDict::DictMap::decrefSharedKeys(shared.keys);
+    shared.keys = NULL;
+    shared.num_referenced = 0;
+}
+
+void splitInstanceDict(BoxedClass* cls, Box* _d) {
+    if (!cls->is_user_defined || _d->cls != dict_cls)
+        return;
+
+    // Split dicts stay split when they get the same new attributes as the other instances (see
+    // CompactMap::appendSplit()), so this only has to deal with the ones which got their own keys.
+    BoxedDict* d = static_cast<BoxedDict*>(_d);
+    if (d->d.isSplit() || d->d.empty())
+        return;
+
+    static StatCounter num_split_instance_dicts("num_split_instance_dicts");
+
+    SharedInstanceDictKeys& shared = shared_instance_dict_keys[cls];
+    if (shared.keys) {
+        // This gets called for each new attribute of the dicts which are not split, but trySplit() rejects most of
+        // the ones which don't match without comparing all of their keys.
+        if (d->d.size() <= shared.keys->num_items && d->d.trySplit(shared.keys)) {
+            num_split_instance_dicts.log();
+            return;
+        }
+
+        // If no instance uses the current keys anymore, we can switch to the layout of this dict.  Only do that if it
+        // has more attributes, so that instances which are still getting set up don't replace the keys.
+        if (shared.keys->refcount > 1 || shared.keys->num_items >= d->d.size())
+            return;
+    } else if (!shared.first_dict || shared.first_dict == d) {
+        shared.first_dict = d;
+        return;
+    }
+
+    auto new_keys = d->d.shareKeys();
+    if (!new_keys)
+        return;
+
+    if (shared.keys)
+        releaseSharedInstanceDictKeys(shared);
+    shared.keys = new_keys;
+    shared.num_referenced = new_keys->num_items;
+    shared.first_dict = NULL;
+
+    auto entries = BoxedDict::DictMap::sharedEntries(new_keys);
+    for (uint32_t i = 0; i < shared.num_referenced; i++)
+        Py_INCREF(entries[i].first.value);
+
+    if (d->d.trySplit(new_keys))
+        num_split_instance_dicts.log();
+}
+
+void clearSharedInstanceDictKeys(BoxedClass* cls) {
+    auto it = shared_instance_dict_keys.find(cls);
+    if (it == shared_instance_dict_keys.end())
+        return;
+
+    SharedInstanceDictKeys shared = it->second;
+    shared_instance_dict_keys.erase(it);
+    if (shared.keys)
+        releaseSharedInstanceDictKeys(shared);
+}
+
 void Box::setDictBacked(STOLEN(Box*) val) {
     // this checks for: v.__dict__ = v.__dict__
     if (val->cls == attrwrapper_cls && unwrapAttrWrapper(val) == this) {
@@ -1299,6 +1380,7 @@ void Box::setDictBacked(STOLEN(Box*) val) {
         auto old_dict = hcattrs->attr_list->attrs[0];
         hcattrs->attr_list->attrs[0] = val;
         Py_DECREF(old_dict);
+        splitInstanceDict(cls, val);
         return;
     }
 
@@ -1330,6 +1412,8 @@ void Box::setDictBacked(STOLEN(Box*) val) {
         decrefArray(old_attr_list->attrs, old_attr_list_size);
         freeAttrs(old_attr_list, old_attr_list_size);
     }
+
+    splitInstanceDict(cls, val);
 }
 
 void HCAttrs::_clearRaw() noexcept {
@@ -1531,6 +1615,7 @@ void Box::setattr(BoxedString* attr, BORROWED(Box*) val, SetattrRewriteArgs* rew
             assert(attr->data()[attr->size()] == '\0');
             if (PyDict_SetItem(d, attr, val) < 0)
                 throwCAPIException();
+            splitInstanceDict(cls, d);
             return;
         }
 
@@ -1647,6 +1732,36 @@ struct method_cache_entry {
 static struct method_cache_entry method_cache[1 << MCACHE_SIZE_EXP];
 static unsigned int next_version_tag = 0;
 static bool is_wrap_around = false; // Pyston addition
+unsigned int type_cache_epoch = 0;  // Pyston addition
+
+// Pyston addition: the megamorphic getattr cache.
+// Getattr sites which went megamorphic don't get rewritten anymore, so every call goes through the full
+// getattrInternalGeneric() path.  In the spirit of V8's megamorphic stub cache, we keep a global hashed cache
+// keyed on (class version tag, hidden class, attribute name) which remembers where the attribute was found:
+// either at a fixed offset in the instance's attribute array, or as a plain value on the type.
+// Like the method cache, it relies on the type's version tag getting invalidated whenever the type
+// (or one of its bases) gets modified.  Hidden classes never get freed and NORMAL ones are immutable, so a
+// matching hidden class pointer means the instance still has the same attribute layout.
+#define MEGAMORPHIC_CACHE_SIZE_EXP 12
+
+struct megamorphic_getattr_cache_entry {
+    PY_UINT64_T version;
+    HiddenClass* hcls;
+    PyObject* name;   /* owned reference */
+    int offset;       /* offset into the attribute array, or -1 if the attribute is found on the type */
+    PyObject* value;  /* borrowed, only set if offset == -1 */
+};
+
+static struct megamorphic_getattr_cache_entry megamorphic_getattr_cache[1 << MEGAMORPHIC_CACHE_SIZE_EXP];
+
+static void clearMegamorphicGetattrCache() {
+    for (int i = 0; i < (1 << MEGAMORPHIC_CACHE_SIZE_EXP); i++) {
+        megamorphic_getattr_cache[i].version = 0;
+        megamorphic_getattr_cache[i].hcls = NULL;
+        Py_CLEAR(megamorphic_getattr_cache[i].name);
+        megamorphic_getattr_cache[i].value = NULL;
+    }
+}
 
 extern "C" unsigned int PyType_ClearCache() noexcept {
     Py_ssize_t i;
@@ -1657,6 +1772,8 @@ extern "C" unsigned int PyType_ClearCache() noexcept {
         Py_CLEAR(method_cache[i].name);
         method_cache[i].value = NULL;
     }
+    clearMegamorphicGetattrCache();
+    type_cache_epoch++;
     next_version_tag = 0;
     /* mark all version tags as invalid */
     PyType_Modified(&PyBaseObject_Type);
@@ -1699,6 +1816,8 @@ int assign_version_tag(PyTypeObject* type) noexcept {
             method_cache[i].name = Py_None;
             Py_INCREF(Py_None);
         }
+        clearMegamorphicGetattrCache();
+        type_cache_epoch++;
         /* mark all version tags as invalid */
         PyType_Modified(&PyBaseObject_Type);
         return 1;
@@ -2840,6 +2959,85 @@ Box* getattrMaybeNonstring(Box* obj, Box* attr) {
     return r;
 }
 
+static inline struct megamorphic_getattr_cache_entry& megamorphicGetattrCacheEntry(BoxedClass* cls, HiddenClass* hcls,
+                                                                                     BoxedString* attr) {
+    unsigned int h = (unsigned int)cls->tp_version_tag ^ (unsigned int)((uintptr_t)hcls >> 4);
+    return megamorphic_getattr_cache[MCACHE_HASH(h, attr->hash)];
+}
+
+// Returns a borrowed reference to the attribute, or NULL if the cache doesn't know about it.
+static BORROWED(Box*) megamorphicGetattrCacheLookup(Box* obj, BoxedString* attr) {
+    BoxedClass* cls = obj->cls;
+    if (!cls->instancesHaveHCAttrs() || !PyType_HasFeature(cls, Py_TPFLAGS_VALID_VERSION_TAG) || attr->hash == -1)
+        return NULL;
+
+    HCAttrs* attrs = obj->getHCAttrsPtr();
+    auto&& entry = megamorphicGetattrCacheEntry(cls, attrs->hcls, attr);
+    if (entry.version != cls->tp_version_tag || entry.hcls != attrs->hcls || entry.name != attr)
+        return NULL;
+
+    if (entry.offset >= 0)
+        return attrs->attr_list->attrs[entry.offset];
+    return entry.value;
+}
+
+bool getattrCacheableLocation(Box* obj, BoxedString* attr, int& offset, BORROWED(Box*)& value) {
+    BoxedClass* cls = obj->cls;
+    if (!cls->instancesHaveHCAttrs() || cls->instancesHaveDictAttrs() || !cls->hasGenericGetattr())
+        return false;
+
+    if (!(MCACHE_CACHEABLE_NAME(attr)))
+        return false;
+
+    HiddenClass* hcls = obj->getHCAttrsPtr()->hcls;
+    if (hcls->type != HiddenClass::NORMAL)
+        return false;
+
+    if (!assign_version_tag(cls))
+        return false;
+
+    // This will usually be a method cache hit:
+    Box* descr = typeLookup(cls, attr);
+    offset = hcls->getAsNormal()->getOffset(attr);
+
+    if (offset >= 0) {
+        // Any attribute on the type, even a non-data descriptor, could change how the lookup works; only handle
+        // the case that the type doesn't know about the attribute at all.
+        if (descr)
+            return false;
+        value = NULL;
+    } else {
+        // Plain class-level values, as long as their class can't grow a __get__:
+        if (!descr || !descr->cls->is_constant || descr->cls->tp_descr_get)
+            return false;
+        value = descr;
+    }
+
+    if (attr->hash == -1)
+        strHashUnboxed(attr);
+    return true;
+}
+
+// Remembers where getattrInternalGeneric() found the attribute, if this is one of the simple cases that
+// the cache can handle.
+static void megamorphicGetattrCacheFill(Box* obj, BoxedString* attr) {
+    int offset;
+    Box* value;
+    if (!getattrCacheableLocation(obj, attr, offset, value))
+        return;
+
+    BoxedClass* cls = obj->cls;
+    HiddenClass* hcls = obj->getHCAttrsPtr()->hcls;
+    auto&& entry = megamorphicGetattrCacheEntry(cls, hcls, attr);
+    entry.version = cls->tp_version_tag;
+    entry.hcls = hcls;
+    entry.offset = offset;
+    entry.value = value;
+    Py_INCREF(attr);
+    Py_XDECREF(entry.name);
+    entry.name = attr;
+}
+
 template <ExceptionStyle S> Box* _getattrEntry(Box* obj, BoxedString* attr, void* return_addr) noexcept(S == CAPI) {
     STAT_TIMER(t0, "us_timer_slowpath_getattr", 10);
 
@@ -2942,7 +3140,17 @@ template <ExceptionStyle S> Box* _getattrEntry(Box* obj, BoxedString* attr, void
                 rewriter->commitReturning(rtn);
         }
     } else {
+        // We couldn't rewrite this site (usually because it is megamorphic); try the global cache first.
+        Box* cached = megamorphicGetattrCacheLookup(obj, attr);
+        if (cached) {
+            static StatCounter megamorphic_getattr_cache_hits("num_megamorphic_getattr_cache_hits");
+            megamorphic_getattr_cache_hits.log();
+            return incref(cached);
+        }
+
         val = getattrInternal<S>(obj, attr);
+        if (val)
+            megamorphicGetattrCacheFill(obj, attr);
     }
 
     NoexcHelper::call(val, obj, attr);
@@ -174,6 +174,17 @@ Box* getattrInternalGeneric(Box* obj, BoxedString* attr, GetattrRewriteArgs* rew
 
 extern "C" PyObject* type_getattro(PyObject* o, PyObject* name) noexcept;
 
+// Checks whether getattr(obj, attr) is one of the simple cases which can be cached on the class' version tag
+// together with the instance's hidden class: either the attribute is in the instance's attribute array at 'offset',
+// or (offset == -1) the instance doesn't have it and it is the plain value 'value' on the type.
+// Assigns a version tag to the class if it doesn't have one yet.
+bool getattrCacheableLocation(Box* obj, BoxedString* attr, int& offset, BORROWED(Box*)& value);
+
+// Gets incremented every time the version tags start getting handed out from zero again (PyType_ClearCache() or a
+// wrap-around), after which a matching version tag no longer proves that the type didn't change.  Caches outside
+// of objmodel.cpp which key on version tags have to check it.
+extern unsigned int type_cache_epoch;
+
 // This is the equivalent of _PyType_Lookup(), which calls Box::getattr() on each item in the object's MRO in the
 // appropriate order. It does not do any descriptor logic.
 template <Rewritable rewritable = REWRITABLE>
@@ -1986,11 +1986,12 @@ Box* strTranslate(BoxedString* self, BoxedString* table, BoxedString* delete_cha
         raiseExcHelper(TypeError, "descriptor 'translate' requires a 'str' object but received a '%s'",
                        getTypeName(self));
 
-    std::unordered_set<char> delete_set;
+    bool deleted[256] = {};
     if (delete_chars) {
         if (!PyString_Check(delete_chars))
             raiseExcHelper(TypeError, "expected a character buffer object");
-        delete_set.insert(delete_chars->s().begin(), delete_chars->s().end());
+        for (unsigned char c : delete_chars->s())
+            deleted[c] = true;
     }
 
     bool have_table = table != Py_None;
@@ -2001,12 +2002,34 @@ Box* strTranslate(BoxedString* self, BoxedString* table, BoxedString* delete_cha
             raiseExcHelper(ValueError, "translation table must be 256 characters long");
     }
 
-    std::string str;
-    for (const char c : self->s()) {
-        if (!delete_set.count(c))
-            str.append(1, have_table ? table->s()[(unsigned char)c] : c);
+    // Write straight into the result string; with deletions we shrink it to the final size at the end.
+    const unsigned char* src = (const unsigned char*)self->data();
+    int len = self->size();
+    BoxedString* rtn = new (len) BoxedString(len);
+    char* dest = rtn->data();
+
+    if (!delete_chars || delete_chars->size() == 0) {
+        if (have_table) {
+            const char* table_data = table->data();
+            for (int i = 0; i < len; i++)
+                dest[i] = table_data[src[i]];
+        } else {
+            memcpy(dest, src, len);
+        }
+        return rtn;
     }
-    return boxString(str);
+
+    char* p = dest;
+    for (int i = 0; i < len; i++) {
+        unsigned char c = src[i];
+        if (!deleted[c])
+            *p++ = have_table ? table->data()[c] : c;
+    }
+
+    PyObject* r = rtn;
+    if (_PyString_Resize(&r, p - dest))
+        throwCAPIException();
+    return r;
 }
 
 Box* strLower(BoxedString* self) {
@@ -2081,13 +2104,7 @@ template <ExceptionStyle S> static inline int stringContainsShared(BoxedString*
 
     BoxedString* sub = static_cast<BoxedString*>(elt);
 
-    size_t found_idx;
-    if (sub->size() == 1)
-        // Call the much-faster single-character find():
-        found_idx = self->s().find(sub->s()[0]);
-    else
-        found_idx = self->s().find(sub->s());
-    return (found_idx != std::string::npos);
+    return _PyString_Find(self->data(), self->size(), sub->data(), sub->size()) != -1;
 }
 
 // Analoguous to CPython's, used for sq_ slots.
@@ -70,7 +70,9 @@ BoxedString* internStringImmortal(llvm::StringRef s) noexcept {
     entry->interned_state = SSTATE_INTERNED_IMMORTAL;
     interned_strings.insert((BoxedString*)entry);
 
+    // The table's reference; the string never goes away, so stop counting references to it at all.
     Py_INCREF(entry);
+    _Py_SetImmortal(entry);
     return entry;
 }
 
@@ -101,6 +103,7 @@ extern "C" void PyString_InternInPlace(PyObject** p) noexcept {
 
         // CPython returns mortal but in our current implementation they are inmortal
         s->interned_state = SSTATE_INTERNED_IMMORTAL;
+        _Py_SetImmortal(s);
     }
 }
 
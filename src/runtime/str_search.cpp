@@ -0,0 +1,214 @@
+// Copyright (c) 2014-2016 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Vectorized byte-string search kernels, used by stringlib's fastsearch() and by str.__contains__ / str.split.
+//
+// Substring search compares the first and the last byte of the needle against every position of a whole vector
+// of the haystack at once, and only does the full memcmp for the positions where both match.  We always have SSE2
+// on x86_64; if the CPU supports AVX2 we use 32-byte vectors instead.  Everything else (and the tails which don't
+// fill a whole vector) goes through the scalar versions.
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "Python.h"
+
+namespace pyston {
+
+static Py_ssize_t findCharScalar(const char* s, Py_ssize_t n, char c) {
+    const char* r = (const char*)memchr(s, c, n);
+    return r ? r - s : -1;
+}
+
+static Py_ssize_t countCharScalar(const char* s, Py_ssize_t n, char c, Py_ssize_t maxcount) {
+    Py_ssize_t count = 0;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (s[i] == c && ++count == maxcount)
+            break;
+    }
+    return count;
+}
+
+// Checks the positions [start, end) one by one.  Requires m >= 2.
+static Py_ssize_t findScalar(const char* s, Py_ssize_t start, Py_ssize_t end, const char* p, Py_ssize_t m) {
+    for (Py_ssize_t i = start; i < end; i++) {
+        if (s[i] == p[0] && s[i + m - 1] == p[m - 1] && memcmp(s + i + 1, p + 1, m - 2) == 0)
+            return i;
+    }
+    return -1;
+}
+
+#if defined(__x86_64__)
+
+static Py_ssize_t findCharSSE2(const char* s, Py_ssize_t n, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    Py_ssize_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    Py_ssize_t r = findCharScalar(s + i, n - i, c);
+    return r == -1 ? -1 : i + r;
+}
+
+static Py_ssize_t countCharSSE2(const char* s, Py_ssize_t n, char c, Py_ssize_t maxcount) {
+    const __m128i needle = _mm_set1_epi8(c);
+    Py_ssize_t count = 0;
+    Py_ssize_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (count >= maxcount)
+            return maxcount;
+    }
+    return count + countCharScalar(s + i, n - i, c, maxcount - count);
+}
+
+static Py_ssize_t findSSE2(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m) {
+    const __m128i first = _mm_set1_epi8(p[0]);
+    const __m128i last = _mm_set1_epi8(p[m - 1]);
+    // Candidate positions are [0, n - m]; the loads of the last bytes go up to s[i + m - 1 + 15].
+    Py_ssize_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(s + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(s + i + bit + 1, p + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(s, i, n - m + 1, p, m);
+}
+
+__attribute__((target("avx2"))) static Py_ssize_t findCharAVX2(const char* s, Py_ssize_t n, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    Py_ssize_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    Py_ssize_t r = findCharSSE2(s + i, n - i, c);
+    return r == -1 ? -1 : i + r;
+}
+
+__attribute__((target("avx2,popcnt"))) static Py_ssize_t countCharAVX2(const char* s, Py_ssize_t n, char c,
+                                                                        Py_ssize_t maxcount) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    Py_ssize_t count = 0;
+    Py_ssize_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (count >= maxcount)
+            return maxcount;
+    }
+    return count + countCharSSE2(s + i, n - i, c, maxcount - count);
+}
+
+__attribute__((target("avx2"))) static Py_ssize_t findAVX2(const char* s, Py_ssize_t n, const char* p,
+                                                            Py_ssize_t m) {
+    const __m256i first = _mm256_set1_epi8(p[0]);
+    const __m256i last = _mm256_set1_epi8(p[m - 1]);
+    Py_ssize_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(s + i + m - 1));
+        unsigned mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(s + i + bit + 1, p + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    Py_ssize_t r = findSSE2(s + i, n - i, p, m);
+    return r == -1 ? -1 : i + r;
+}
+
+static bool cpuHasAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+static const bool use_avx2 = cpuHasAVX2();
+
+#endif
+
+extern "C" Py_ssize_t _PyString_FindChar(const char* s, Py_ssize_t n, char c) noexcept {
+#if defined(__x86_64__)
+    if (use_avx2)
+        return findCharAVX2(s, n, c);
+    return findCharSSE2(s, n, c);
+#else
+    return findCharScalar(s, n, c);
+#endif
+}
+
+extern "C" Py_ssize_t _PyString_CountChar(const char* s, Py_ssize_t n, char c, Py_ssize_t maxcount) noexcept {
+    if (maxcount <= 0)
+        return 0;
+#if defined(__x86_64__)
+    if (use_avx2)
+        return countCharAVX2(s, n, c, maxcount);
+    return countCharSSE2(s, n, c, maxcount);
+#else
+    return countCharScalar(s, n, c, maxcount);
+#endif
+}
+
+extern "C" Py_ssize_t _PyString_Find(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m) noexcept {
+    if (m > n)
+        return -1;
+    if (m <= 1)
+        return m == 0 ? 0 : _PyString_FindChar(s, n, p[0]);
+
+#if defined(__x86_64__)
+    if (use_avx2)
+        return findAVX2(s, n, p, m);
+    return findSSE2(s, n, p, m);
+#else
+    return findScalar(s, 0, n - m + 1, p, m);
+#endif
+}
+
+extern "C" Py_ssize_t _PyString_Count(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m,
+                                      Py_ssize_t maxcount) noexcept {
+    if (m == 1)
+        return _PyString_CountChar(s, n, p[0], maxcount);
+
+    assert(m > 1);
+    Py_ssize_t count = 0;
+    Py_ssize_t i = 0;
+    while (count < maxcount) {
+        Py_ssize_t r = _PyString_Find(s + i, n - i, p, m);
+        if (r == -1)
+            break;
+        count++;
+        i += r + m;
+    }
+    return count;
+}
+}
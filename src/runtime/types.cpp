@@ -28,7 +28,9 @@
 #include "capi/typeobject.h"
 #include "capi/types.h"
 #include "codegen/ast_interpreter.h"
+#include "codegen/compile_queue.h"
 #include "codegen/entry.h"
+#include "codegen/profile_cache.h"
 #include "codegen/unwinding.h"
 #include "core/bst.h"
 #include "core/options.h"
@@ -2310,6 +2312,8 @@ private:
 
         hcattrs->hcls = HiddenClass::dict_backed;
         hcattrs->attr_list = new_attr_list;
+
+        splitInstanceDict(b->cls, d);
     }
 
     bool isDictBacked() {
@@ -3883,6 +3887,7 @@ void BoxedClass::dealloc(Box* b) noexcept {
     PyObject_ClearWeakRefs((PyObject*)type);
 
     type->clearAttrsForDealloc();
+    clearSharedInstanceDictKeys(type);
 
     Py_XDECREF(type->tp_dict);
     Py_XDECREF(type->tp_bases);
@@ -4173,6 +4178,8 @@ struct _inittab _PyImport_Inittab[] = { { "array", initarray },
 
 bool TRACK_ALLOCATIONS = false;
 void setupRuntime() {
+    setupGMPMemoryFunctions();
+
     root_hcls = HiddenClass::makeRoot();
     HiddenClass::dict_backed = HiddenClass::makeDictBacked();
 
@@ -4719,6 +4726,17 @@ void setupRuntime() {
 
     setupSysEnd();
 
+#ifdef Py_IMMORTAL_OBJECTS
+    // The constants (None, True/False, the interned ints and characters, ...) and the builtin classes are never
+    // freed in a release build, so stop doing refcounting on them.
+    for (auto b : constants)
+        _Py_SetImmortal(b);
+    for (auto b : late_constants)
+        _Py_SetImmortal(b);
+    for (auto b : classes)
+        _Py_SetImmortal(b);
+#endif
+
     TRACK_ALLOCATIONS = true;
 }
 
@@ -4786,6 +4804,9 @@ extern "C" void Py_Finalize() noexcept {
     call_sys_exitfunc();
     // initialized = 0;
 
+    shutdownCompileQueue();
+    writeProfileCache();
+
     PyType_ClearCache();
     clearAllICs();
     PyGC_Collect();
@@ -4796,6 +4817,9 @@ extern "C" void Py_Finalize() noexcept {
 #ifdef Py_REF_DEBUG
     IN_SHUTDOWN = true;
 
+    // Objects don't get immortal in debug builds, so we can (and have to) free the frozen ones too:
+    _PyGC_Unfreeze();
+
     // May need to run multiple collections to collect everything:
     while (true) {
         clearAllICs();
@@ -23,6 +23,7 @@
 #include "structmember.h"
 
 #include "codegen/irgen/future.h"
+#include "core/compact_map.h"
 #include "core/contiguous_map.h"
 #include "core/from_llvm/DenseMap.h"
 #include "core/threading.h"
@@ -537,6 +538,8 @@ public:
     static void tp_dealloc(Box* b) noexcept;
 
     friend int PyInt_ClearFreeList() noexcept;
+    // The baseline jit allocates from the freelist inline.
+    friend class JitFragmentWriter;
 };
 static_assert(sizeof(BoxedInt) == sizeof(PyIntObject), "");
 static_assert(offsetof(BoxedInt, n) == offsetof(PyIntObject, ob_ival), "");
@@ -575,6 +578,8 @@ public:
     static void tp_dealloc(Box* b) noexcept;
 
     friend int PyFloat_ClearFreeList() noexcept;
+    // The baseline jit allocates from the freelist inline.
+    friend class JitFragmentWriter;
 };
 static_assert(sizeof(BoxedFloat) == sizeof(PyFloatObject), "");
 static_assert(offsetof(BoxedFloat, d) == offsetof(PyFloatObject, ob_fval), "");
@@ -1049,8 +1054,7 @@ inline BoxAndHash& incref(BoxAndHash& b) {
 
 class BoxedDict : public Box {
 public:
-    typedef pyston::DenseMap<BoxAndHash, Box*, BoxAndHash::Comparisons, detail::DenseMapPair<BoxAndHash, Box*>,
-                             /* MinSize= */ 8> DictMap;
+    typedef pyston::CompactMap<BoxAndHash, Box*, BoxAndHash::Comparisons> DictMap;
 
     DictMap d;
 
@@ -1130,6 +1134,9 @@ public:
 
     void optimizeSize() { constants.shrink_to_fit(); }
 
+    // all constants in vreg order, i.e. getAllConstants()[i] is the constant with the vreg -(i + 1)
+    llvm::ArrayRef<Box*> getAllConstants() const { return constants; }
+
     BORROWED(BoxedInt*) getIntConstant(int64_t n) const;
     BORROWED(BoxedFloat*) getFloatConstant(double d) const;
 
@@ -1138,9 +1145,23 @@ public:
         return keyword_names.size() - 1;
     }
     const std::vector<BoxedString*>* getKeywordNames(int constant) const { return keyword_names[constant].get(); }
+    int getNumKeywordNames() const { return keyword_names.size(); }
 };
 
 
+// The interpreter's inline cache for a LoadAttr statement, see ASTInterpreter::visit_loadattr.
+// Valid as long as the class still has the same version tag and the instance the same hidden class, and no
+// version tags got reused since (type_cache_epoch).
+struct InterpreterAttrCache {
+    BoxedClass* cls = NULL;
+    HiddenClass* hcls = NULL;
+    unsigned int version = 0;
+    unsigned int epoch = 0;
+    int offset = -1;           // offset into the attribute array, or -1 if the attribute is 'value' on the type
+    Box* value = NULL;         // borrowed
+    int num_failures = 0;      // we stop trying to quicken sites which are polymorphic or not cacheable
+};
+
 // BoxedCode corresponds to metadata about a function definition.  If the same 'def foo():' block gets
 // executed multiple times, there will only be a single BoxedCode, even though multiple function objects
 // will get created from it.
@@ -1149,8 +1170,9 @@ public:
 // BoxedCode objects also keep track of any machine code that we have available for this function.
 class BoxedCode : public Box {
 public:
-    std::unique_ptr<SourceInfo> source;           // source can be NULL for functions defined in the C/C++ runtime
-    const CodeConstants BORROWED(code_constants); // keeps track of all constants inside the bytecode
+    std::unique_ptr<SourceInfo> source; // source can be NULL for functions defined in the C/C++ runtime
+    // keeps track of all constants inside the bytecode; only gets modified when computing a lazy CFG
+    CodeConstants BORROWED(code_constants);
 
     BoxedString* filename = nullptr;
     BoxedString* name = nullptr;
@@ -1170,6 +1192,8 @@ public:
 
     // Profiling counter:
     int propagated_cxx_exceptions = 0;
+    // Set once a generator of this function grew its stack past the initial size; see allocGeneratorStack().
+    bool generator_needs_large_stack = false;
 
     // For use by the interpreter/baseline jit:
     int times_interpreted;
@@ -1177,7 +1201,8 @@ public:
     std::vector<std::unique_ptr<JitCodeBlock>> code_blocks;
     ICInvalidator dependent_interp_callsites;
     llvm::DenseMap<BST_stmt*, int> cxx_exception_count;
-
+    // indexed by BST_LoadAttr::cache_slot, allocated the first time the interpreter needs it
+    std::unique_ptr<InterpreterAttrCache[]> interp_attr_caches;
 
     // Functions can provide an "internal" version, which will get called instead
     // of the normal dispatch through the functionlist.
@@ -1211,6 +1236,14 @@ public:
         return false;
     }
 
+    // Makes sure that source->cfg (and code_constants) exist; has to be called before running the function.
+    void ensureCFG() {
+        assert(source);
+        if (unlikely(!source->cfg))
+            computeLazyCFG();
+    }
+    void computeLazyCFG();
+
     // These functions add new compiled "versions" (or, instantiations) of this BoxedCode.  The first
     // form takes a CompiledFunction* directly, and the second forms (meant for use by the C++ runtime) take
     // some raw parameters and will create the CompiledFunction behind the scenes.
@@ -1462,6 +1495,11 @@ public:
 
     llvm::ArrayRef<Box*> live_values;
 
+    // Stackless generators don't have a context or stack; they keep their interpreter frame here (an ASTInterpreter,
+    // NULL if the generator hasn't started or has exited).  See resumeStacklessGenerator().
+    bool stackless;
+    void* stackless_interpreter;
+
 #if STAT_TIMERS
     StatTimer* prev_stack;
     StatTimer my_timer;
@@ -1478,6 +1516,9 @@ Box* objectSetattr(Box* obj, Box* attr, Box* value);
 
 BORROWED(Box*) unwrapAttrWrapper(Box* b);
 void convertAttrwrapperToPrivateDict(Box* b);
+// Lets the dict of a dict-backed instance share its keys with the other instances of the class:
+void splitInstanceDict(BoxedClass* cls, Box* d);
+void clearSharedInstanceDictKeys(BoxedClass* cls);
 Box* attrwrapperKeys(Box* b);
 void attrwrapperDel(Box* b, llvm::StringRef attr);
 void attrwrapperClear(Box* b);
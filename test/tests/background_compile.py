@@ -0,0 +1,38 @@
+# skip-if: '-L' in EXTRA_JIT_ARGS or '-n' in EXTRA_JIT_ARGS or '-I' in EXTRA_JIT_ARGS
+# statcheck: stats.get("num_background_compiles_queued", 0) >= 1
+
+# Functions which reach the reopt / OSR thresholds get compiled on a separate thread
+# while they keep running in the interpreter / baseline JIT.
+
+try:
+    import __pyston__
+    __pyston__.setOption("ENABLE_BACKGROUND_COMPILATION", 1)
+    __pyston__.setOption("OSR_THRESHOLD_BASELINE", 50)
+    __pyston__.setOption("REOPT_THRESHOLD_BASELINE", 50)
+except ImportError:
+    pass
+
+def f(x):
+    return x * 2 + 1
+
+def loop(n):
+    t = 0
+    for i in xrange(n):
+        t += f(i)
+    return t
+
+for i in xrange(200):
+    r = loop(100)
+print r
+
+class C(object):
+    def __init__(self, n):
+        self.n = n
+
+    def get(self):
+        return self.n
+
+total = 0
+for i in xrange(10000):
+    total += C(i).get()
+print total
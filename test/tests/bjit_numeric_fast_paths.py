@@ -0,0 +1,74 @@
+# The baseline jit handles int+int, int<int, float*float and friends inline and only calls into the
+# runtime if the operands aren't exactly ints/floats, the result overflows or the freelist is empty.
+
+import sys
+
+def int_ops(a, b):
+    return (a + b, a - b, a < b, a <= b, a > b, a >= b, a == b, a != b)
+
+def float_ops(a, b):
+    return (a + b, a - b, a * b)
+
+def aug(a, b):
+    a += b
+    a -= 1
+    return a
+
+class MyInt(int):
+    def __add__(self, other):
+        return "MyInt.__add__"
+    def __lt__(self, other):
+        return "MyInt.__lt__"
+
+class MyFloat(float):
+    def __mul__(self, other):
+        return "MyFloat.__mul__"
+
+for i in xrange(1000):
+    r1 = int_ops(i, 500)
+    r2 = float_ops(i * 0.5, 2.0)
+    r3 = aug(i, 2)
+print r1, r2, r3
+
+# Overflow has to produce a long:
+for i in xrange(1000):
+    r1 = int_ops(sys.maxint, 1)
+    r2 = int_ops(-sys.maxint - 1, 1)
+    r3 = int_ops(-sys.maxint - 1, -sys.maxint - 1)
+print r1
+print r2
+print r3
+
+# Subclasses and mixed types go through the normal path:
+for i in xrange(1000):
+    r1 = int_ops(MyInt(i), 1)[:3]
+    r2 = float_ops(MyFloat(1.5), 2.0)
+    r3 = int_ops(i, 1.5)
+    r4 = float_ops(1.5, i)
+    r5 = int_ops(1L, 2L)
+print r1, r2, r3, r4, r5
+
+# Special float values:
+inf = float("inf")
+for i in xrange(1000):
+    r = float_ops(1e308, 10.0) + float_ops(inf, inf)
+print r
+
+# Lots of results alive at once, so the freelists run out:
+l = []
+for i in xrange(10000):
+    l.append(i + 1)
+    l.append(i * 0.5 + 0.25)
+print sum(l), len(set(map(id, l)))
+
+# Results in the range of the interned ints have to be those, also when they get computed inline:
+def small(a, b):
+    return a + b, a - b
+
+interned = []
+for i in xrange(1000):
+    for r in small(i % 300 - 20, 3):
+        if (r is int(str(r))) != (-5 <= r <= 256):
+            print "wrong identity for", r
+        interned.append(r is int(str(r)))
+print interned.count(True), interned.count(False)
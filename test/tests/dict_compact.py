@@ -0,0 +1,43 @@
+# Dicts store their entries separately from the hash table, which means that removing entries leaves holes that
+# have to get reused or compacted away; make sure that this keeps the contents and the iteration order intact.
+
+d = {}
+for i in xrange(5):
+    for j in xrange(200):
+        d[(i, j)] = j
+    for j in xrange(0, 200, 3):
+        del d[(i, j)]
+    for j in xrange(0, 200, 7):
+        d[(i, j)] = -j
+print len(d), sum(d.values()), sorted(d.items())[:5]
+
+# Small dicts that keep replacing their keys, without ever growing:
+d = {}
+for i in xrange(1000):
+    d[i] = i
+    if i >= 3:
+        del d[i - 3]
+print d, d.keys(), d.values(), d.items()
+
+# Iteration order matches CPython 2.7's:
+d = dict.fromkeys("abcdefghijklmnopqrstuvwxyz")
+for c in "aeiou":
+    del d[c]
+d["e"] = 1
+d["aa"] = 2
+print d
+print list(d.iterkeys()) == d.keys(), list(d.itervalues()) == d.values(), list(d.iteritems()) == d.items()
+
+c = d.copy()
+print c == d, c.keys() == d.keys()
+
+n = 0
+while d:
+    k, v = d.popitem()
+    n += 1
+print n, d, len(c)
+
+c.clear()
+print c, len(c), c.get("a")
+c["a"] = 1
+print c
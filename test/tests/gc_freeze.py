@@ -0,0 +1,38 @@
+# __pyston__.freeze() moves all the objects that the cycle collector knows about into a permanent generation,
+# which doesn't get collected anymore.
+
+import gc
+import weakref
+
+from __pyston__ import freeze, unfreeze, getFreezeCount
+
+class Node(object):
+    pass
+
+def make_cycle():
+    n = Node()
+    n.self = n
+    return weakref.ref(n)
+
+gc.collect()
+print getFreezeCount()
+
+frozen = make_cycle()
+l = [Node() for i in xrange(100)]
+print freeze() > 100, getFreezeCount() > 100
+
+gc.collect()
+print frozen() is not None
+print l[0] not in gc.get_objects()
+
+# Objects created after the freeze are collected as usual:
+r = make_cycle()
+gc.collect()
+print r() is None
+
+unfreeze()
+print getFreezeCount()
+print frozen() is not None
+r = make_cycle()
+gc.collect()
+print r() is None
@@ -0,0 +1,48 @@
+# statcheck: noninit_count("generator_stack_created") <= 150
+# statcheck: noninit_count("generator_stack_reused") >= 1000
+
+# Generator stacks get pooled and reused.  Generators which recurse deeply grow their stack; those stacks get
+# recycled too, or trimmed back once the pool of large stacks is full.
+
+try:
+    import __pyston__
+    __pyston__.setOption("MAX_CACHED_LARGE_GENERATOR_STACKS", 2)
+    # Otherwise the first generators of every function wouldn't need a stack:
+    __pyston__.setOption("ENABLE_STACKLESS_GENERATORS", 0)
+except ImportError:
+    pass
+
+def gen(n):
+    for i in xrange(n):
+        yield i
+
+total = 0
+for i in xrange(2000):
+    total += sum(gen(3))
+print total
+
+# Lots of generators alive at the same time:
+gens = [gen(5) for i in xrange(100)]
+print sum(g.next() + g.next() for g in gens)
+del gens
+
+def recurse(n):
+    if n == 0:
+        return 0
+    return recurse(n - 1) + 1
+
+def deep_gen(n):
+    yield recurse(n)
+    yield recurse(n // 2)
+
+for i in xrange(20):
+    r = list(deep_gen(400))
+print r
+
+# Interleave deep and shallow generators so that they pick up each other's stacks:
+for i in xrange(50):
+    g1 = deep_gen(300)
+    g2 = gen(10)
+    r = g1.next(), g2.next(), list(g2), g1.next()
+print r
+print sum(gen(10)), list(deep_gen(100))
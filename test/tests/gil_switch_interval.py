@@ -0,0 +1,37 @@
+# A thread that is waiting for the GIL gets it within a few switch intervals, even if another thread is busy
+# running Python code the whole time.
+
+import sys
+import threading
+import time
+
+print sys.getswitchinterval()
+sys.setswitchinterval(0.001)
+print sys.getswitchinterval()
+
+for bad in (0, -1):
+    try:
+        sys.setswitchinterval(bad)
+    except ValueError as e:
+        print e
+
+stop = []
+def spin():
+    n = 0
+    while not stop:
+        n += 1
+
+threads = [threading.Thread(target=spin) for i in xrange(2)]
+for t in threads:
+    t.start()
+
+start = time.time()
+for i in xrange(100):
+    time.sleep(0.001)
+elapsed = time.time() - start
+
+stop.append(1)
+for t in threads:
+    t.join()
+
+print elapsed < 5.0
@@ -0,0 +1,50 @@
+# sum() adds up ints and floats without boxing the intermediate results, and list searches compare ints, floats and
+# strs directly; make sure that they still agree with the generic paths.
+
+import sys
+
+print sum([1, 2, 3]), sum([1.5, 2.5]), sum([1, 2.5, 3]), sum([0.5, 1, 2]), sum([], 0.0), sum([])
+print sum(xrange(100)), sum(x * 0.5 for x in xrange(10)), sum((1, 2, 3), 10), sum([1, 2], 0.5)
+print sum([True, True, 1]), sum([1, True, 2.0, False]), sum([1, 2L, 3]), sum([1.0, 2L])
+print repr(sum([0.1] * 10)), repr(sum([1e100, 1.0, -1e100]))
+
+# int overflow falls back to longs:
+print sum([sys.maxint, 1]), sum([sys.maxint, 1, 1.0]), sum([-sys.maxint - 1, -1]), sum([sys.maxint] * 3, 2.0)
+
+# Other types after a run of numbers:
+print sum([[1], [2]], []), sum([1, 2, 3j]), sum([1.5, 3j])
+class C(object):
+    def __radd__(self, other):
+        return "C.__radd__(%r)" % (other,)
+print sum([1, 2, C()]), sum([1.5, C()])
+try:
+    sum([1, 2, "a"])
+except TypeError as e:
+    print e
+try:
+    sum(["a"], "")
+except TypeError as e:
+    print e
+
+class MyInt(int):
+    def __add__(self, other):
+        return "MyInt.__add__"
+print sum([1], MyInt(3)), sum([MyInt(1), 2])
+
+l = [1, 2, 3, 4.0, 5.5, "a", "bc", None]
+print 4 in l, 4.0 in l, 1.0 in l, 5.5 in l, "bc" in l, "b" in l, 7 in l, None in l
+print l.index(3.0), l.index(4), l.index("a"), l.count(1), l.count(1.0), l.count("bc")
+nan = float("nan")
+l2 = [nan, 1.0, 2]
+print nan in l2, float("nan") in l2, l2.index(2.0), l2.count(1)
+l2.remove(1)
+print l2[1:], [1, 2, 3] == [1.0, 2.0, 3.0], ["a"] == ["a"]
+
+class Eq(object):
+    def __eq__(self, other):
+        return other == 3
+print Eq() in [1, 2, 3], [1, 2, 3].index(Eq()), [Eq(), 3].count(3)
+try:
+    [1, 2].index(1.5)
+except ValueError as e:
+    print e
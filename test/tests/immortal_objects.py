@@ -0,0 +1,34 @@
+# None, True/False, the small ints, interned strings and the builtin classes don't get refcounted in release
+# builds; make sure that dropping lots of references to them (from all the tiers) doesn't free them.
+
+import sys
+
+def f(x):
+    l = []
+    for i in xrange(x):
+        l.append(None)
+        l.append(i < 5)
+        l.append(i % 7)
+        l.append("a")
+        l.append(int)
+        l.append(NotImplemented)
+        l.append(Ellipsis)
+    return len(l)
+
+for i in xrange(2000):
+    f(10)
+print f(100)
+
+print None, True, False, 3, "a", int, NotImplemented, Ellipsis
+print sys.getrefcount(None) > 1, sys.getrefcount(int) > 1, sys.getrefcount(5) > 1
+
+s = intern("immortal_objects_" + str(1))
+print s is intern("immortal_objects_1")
+del s
+print intern("immortal_objects_" + "1") is intern("immortal_objects_1")
+
+# The in-place string concatenation checks for a refcount of 1; it shouldn't kick in for immortal strings:
+c = "a"
+d = c
+d += "b"
+print c, d, "a"
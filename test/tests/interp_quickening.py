@@ -0,0 +1,102 @@
+# The interpreter specializes ("quickens") attribute loads and int binops for the types it sees;
+# make sure that they go back to the generic versions when something changes underneath them.
+
+class C(object):
+    k = 1
+
+    def __init__(self, x):
+        self.x = x
+
+def get_x(o):
+    return o.x
+
+def get_k(o):
+    return o.k
+
+c = C(5)
+for i in xrange(20):
+    r = get_x(c), get_k(c)
+print r
+
+# Different hidden class:
+d = C(6)
+d.y = 1
+print get_x(d), get_k(d)
+
+# Shadow the class attribute:
+c.k = 10
+print get_k(c)
+del c.k
+print get_k(c)
+
+# Change the class attribute:
+C.k = 2
+print get_k(c)
+
+# Data descriptor on the class takes precedence over the instance attribute:
+C.x = property(lambda self: "prop")
+print get_x(c), get_x(d)
+del C.x
+print get_x(c), get_x(d)
+
+# A completely different class:
+class D(object):
+    x = "D.x"
+    k = "D.k"
+print get_x(D()), get_k(D())
+
+# Old-style classes and builtin types:
+class O:
+    x = 1
+    k = 2
+print get_x(O()), get_k(O())
+print get_x(type("T", (object,), {"x": 3})), get_k(type("T", (object,), {"k": 4}))
+
+def add(a, b):
+    return a + b
+
+def ops(a, b):
+    return a - b, a * b, a & b, a | b, a ^ b
+
+for i in xrange(20):
+    r = add(i, 1), ops(i, 3)
+print r
+
+# Overflow into longs:
+print add(2 ** 62, 2 ** 62), ops(2 ** 62, -(2 ** 62))
+print add(-2 ** 63, -1), ops(-2 ** 63, 2)
+
+# Other types:
+print add(1.5, 1), add("a", "b"), add([1], [2]), add(1, 2L)
+print ops(7, 3)
+
+class MyInt(int):
+    def __add__(self, other):
+        return "MyInt.__add__"
+print add(MyInt(1), 2), add(1, 2)
+
+try:
+    add(1, None)
+except TypeError as e:
+    print e
+print add(3, 4)
+
+# sys._clear_type_cache() makes version tags get handed out from zero again, so after replacing a class attribute
+# the class can end up with the same version tag it had when a site cached the old (now freed) value:
+import sys
+class E(object):
+    k = ["E.k"]
+
+def get_ek(o):
+    return o.k
+
+e = E()
+for i in xrange(3):
+    sys._clear_type_cache()
+    e.k
+    get_ek(e)
+    sys._clear_type_cache()
+    E.k = ["E.k", i]
+    junk = [["junk"] for j in xrange(100)]
+    e.k
+    print get_ek(e)
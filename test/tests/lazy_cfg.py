@@ -0,0 +1,90 @@
+# statcheck: noninit_count('num_lazy_cfgs') - noninit_count('num_lazy_cfgs_computed') >= 20
+# The CFGs of functions only get computed once they get called for the first time; make sure that everything
+# which they reference from the enclosing scopes still works at that point.
+
+def make_unused(i):
+    def unused0(): return i + 0
+    def unused1(): return i + 1
+    def unused2(): return i + 2
+    def unused3(): return i + 3
+    def unused4(): return i + 4
+    def unused5(): return i + 5
+    def unused6(): return i + 6
+    def unused7(): return i + 7
+    def unused8(): return i + 8
+    def unused9(): return i + 9
+    return [unused0, unused1, unused2, unused3, unused4, unused5, unused6, unused7, unused8, unused9]
+
+def never_called():
+    def a(): pass
+    def b(): pass
+    def c(): pass
+    l = [lambda: 1, lambda: 2, lambda: 3, lambda: 4, lambda: 5, lambda: 6, lambda: 7, lambda: 8, lambda: 9, lambda: 0]
+    return a, b, c, l
+
+fs = make_unused(10)
+print fs[3](), fs[7]()
+
+def outer(x, y=5):
+    z = x * 2
+    def inner(a, *args, **kw):
+        "docstring of inner"
+        def innermost():
+            return x + z + a
+        return innermost() + len(args) + len(kw)
+    return inner
+
+f = outer(3)
+print f.__doc__, f.__name__
+print f(1), f(1, 2, 3, k=4)
+
+l = lambda a, b=[1, 2] * 2, *c: (a, b, c)
+print l(1), l(1, 2, 3)
+
+print sorted(map(lambda x: -x, range(5)))
+
+def gen(n):
+    for i in xrange(n):
+        yield (lambda: i * i)()
+print list(gen(5))
+
+class C(object):
+    def method(self, x):
+        return [y for y in range(x) if y % 2]
+
+    @staticmethod
+    def s():
+        return {k: v for k, v in zip("abc", range(3))}
+
+print C().method(7), sorted(C.s().items())
+
+def raises():
+    1 / 0
+
+try:
+    raises()
+except ZeroDivisionError as e:
+    import sys
+    print e, sys.exc_info()[2].tb_next.tb_frame.f_code.co_name
+
+exec "def g(): return 42\nprint g()"
+print eval("(lambda: 'eval')()")
+
+# Syntax errors inside of functions still have to be reported when the module gets imported, not on the first call:
+import os, sys, tempfile
+d = tempfile.mkdtemp()
+sys.path.insert(0, d)
+for i, body in enumerate(["def f():\n    break\n",
+                          "def f():\n    if 1:\n        continue\n",
+                          "def f():\n    class C:\n        return 1\n",
+                          "def f():\n    class C:\n        yield 1\n",
+                          "def f():\n    for i in range(3):\n        def g():\n            break\n"]):
+    with open(os.path.join(d, "lazy_cfg_mod%d.py" % i), "w") as f:
+        f.write("print 'imported'\n" + body)
+    try:
+        __import__("lazy_cfg_mod%d" % i)
+    except SyntaxError as e:
+        print "SyntaxError:", e.msg
+for fn in os.listdir(d):
+    os.remove(os.path.join(d, fn))
+os.rmdir(d)
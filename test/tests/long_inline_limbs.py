@@ -0,0 +1,46 @@
+# Longs that fit into 128 bits are stored inline, and the int operations which overflow create them directly;
+# check the values around the limb boundaries, and longs which grow out of the inline storage.
+
+import sys
+M = sys.maxint
+
+print M + 1, -M - 1 - 1, M + M, (-M - 1) + (-M - 1)
+print M - (-M - 1), (-M - 1) - 1, 0 - (-M - 1)
+print M * M, (-M - 1) * (-M - 1), (-M - 1) * M, M * 2, -M * 3
+print type(M + 1), type(M * M)
+
+def add(a, b):
+    return a + b
+def sub(a, b):
+    return a - b
+def mul(a, b):
+    return a * b
+for i in xrange(200):
+    x = add(M, i)
+    y = mul(M - i, M - i)
+    z = sub(-M - 1, i)
+print x, y, z
+
+for bits in (63, 64, 65, 127, 128, 129, 192, 256):
+    v = 2 ** bits
+    print bits, v - 1, v, v + 1, -v, (v - 1) & (v + 1), (v - 1) | M, (v + 1) ^ -1, str(v)[-5:], hex(v)
+
+# Growing well past the inline storage and shrinking again:
+x = 1L
+for i in xrange(100):
+    x = x * 3 + (M + 1)
+print x % 1000003, len(str(x))
+for i in xrange(100):
+    x = x // 3
+print x, x - x, -(x * x) // (x + 1)
+
+class L(long):
+    pass
+l = L(M + 1) * 2
+print l, type(l), L(2 ** 130) + 1, L(-5)
+
+print long("123456789012345678901234567890") * -1, long("-0"), long(2.0 ** 70), long(-1e20)
+print int(M + 1 - 1), type(int(M + 1 - 1)), int(M * 4)
+print (M * M) & 0xffff, (M * M) | 1, -(M * M) ^ 7, (2 ** 100) & -1, 5L & M, -5L | 3, 12L ^ -12
+print abs(-M - 1 - 1), -(M + 1), ~(M + 1), (M + 1) >> 1, (M + 1) << 70
+print divmod(M * M, M + 1), pow(M + 1, 3), hash(M + 1) == hash(M + 1 + 0)
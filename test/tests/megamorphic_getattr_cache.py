@@ -0,0 +1,51 @@
+# Getattr sites that go megamorphic fall back to a global (class, hidden class, attribute) cache.
+# Make sure that it notices when classes or instances change underneath it.
+
+classes = []
+for i in xrange(200):
+    class C(object):
+        k = i * 10
+    classes.append(C)
+
+objs = []
+for i, C in enumerate(classes):
+    c = C()
+    c.x = i
+    objs.append(c)
+
+def get_x(o):
+    return o.x
+
+def get_k(o):
+    return o.k
+
+def run():
+    t = 0
+    for o in objs:
+        t += get_x(o) + get_k(o)
+    return t
+
+for i in xrange(20):
+    r = run()
+print r
+
+# Shadow the class attribute with an instance attribute:
+objs[5].k = 1000
+print run()
+
+# Make the instance attribute inaccessible via a data descriptor on the class:
+classes[7].x = property(lambda self: -1)
+print run()
+
+# Change a class attribute:
+classes[9].k = 5
+print run()
+
+# Delete an instance attribute, which should expose the class attribute:
+del objs[5].k
+print run()
+
+# Add a __getattr__ fallback and remove the attribute:
+classes[11].__getattr__ = lambda self, attr: 42
+del objs[11].x
+print run()
@@ -0,0 +1,49 @@
+# The LLVM object cache has to keep working when a process left a partially written record behind in it: records
+# written afterwards must still be found, by this process and by later ones.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+home = tempfile.mkdtemp()
+env = dict(os.environ)
+env["HOME"] = home
+cache_file = os.path.join(home, ".cache", "pyston", "object_cache.pack")
+
+prog1 = "def f(x):\n    return x + 1\nprint f(1)\n"
+prog2 = "def g(x):\n    return [x, x * 2.0]\nprint g(2)\n"
+
+def run(prog):
+    # -n makes us compile everything with LLVM, -T gives us the stats.
+    p = subprocess.Popen([sys.executable, "-S", "-n", "-T", "-c", prog], env=env, stdout=subprocess.PIPE,
+                         stderr=subprocess.PIPE)
+    out, err = p.communicate()
+    stats = {}
+    for l in err.splitlines():
+        if ": " in l:
+            k, v = l.split(": ", 1)
+            stats[k] = v
+    return out.strip(), int(stats.get("num_jit_objectcache_misses", 0))
+
+try:
+    out, misses_prog1 = run(prog1)
+    print out
+    size = os.path.getsize(cache_file)
+    print size > 0
+
+    # Something which looks like the start of a record, followed by junk, like a crash in the middle of a write:
+    with open(cache_file, "ab") as f:
+        f.write("OHY2" + "\xab" * 100)
+
+    out, misses_first = run(prog2)
+    print out
+    out, misses_again = run(prog2)
+    print out, misses_again < misses_first
+
+    # The first program's records in front of the junk are still there too:
+    out, misses = run(prog1)
+    print out, misses < misses_prog1
+finally:
+    shutil.rmtree(home)
@@ -0,0 +1,20 @@
+# Sites that see a handful of different classes get a polymorphic type profile; make sure
+# that the speculation we do based on it (and the deopts when it is wrong) behave correctly.
+
+def f(x):
+    return x + x
+
+def run(n, values):
+    t = []
+    for i in xrange(n):
+        t.append(f(values[i % len(values)]))
+    return t
+
+print run(10000, [1])[-3:]
+print run(10000, [1, 2.0])[-3:]
+print run(10000, [1, 2.0, "a", [3]])[-3:]
+print run(10000, [1, 2.0, "a", [3], (4,), 5L])[-3:]
+
+# Mostly ints, with the occasional float; too many floats to speculate on the first one, few enough for the second:
+print run(10000, [1] * 99 + [1.5])[-3:]
+print run(10000, [1] * 1999 + [1.5])[-3:]
@@ -0,0 +1,37 @@
+# skip-if: '-n' in EXTRA_JIT_ARGS or '-I' in EXTRA_JIT_ARGS
+
+# With the profile cache enabled we write out which functions got hot at exit, and a process that runs this file
+# again moves them straight to the same tier.  Both the first and any later runs have to give the same results.
+
+try:
+    import __pyston__
+    __pyston__.setOption("ENABLE_PROFILE_CACHE", 1)
+except ImportError:
+    pass
+
+def f(x):
+    return x * 2 + 1
+
+def g(l):
+    t = 0
+    for x in l:
+        t += f(x)
+    return t
+
+for i in xrange(3000):
+    r = g([1, 2.0, 3])
+print r
+
+# The cache can't tell these two apart (same line, name and size), so it must not give one the profile of the other:
+add, mul = (lambda a, b: a + b), (lambda a, b: a * b)
+for i in xrange(3000):
+    r = add("a", "b"), mul(i, 3)
+print r
+
+# Code objects which go away again:
+for i in xrange(20):
+    ns = {}
+    exec "def h(x):\n    return x + %d\n" % i in ns
+    for j in xrange(100):
+        r = ns["h"](j)
+print r
@@ -0,0 +1,22 @@
+# statcheck: stats.get("num_pyc_bytecode_hits", 0) >= 1
+# Imports a module twice: the first import stores the bytecode of the module in the .pyc file (unless an earlier run
+# already did so), and the second one loads it from there instead of recomputing it from the AST.
+
+import sys
+
+def run(m):
+    print m.__doc__, m.constants
+    print m.f(1, (2, 3)), m.f(1, (2, 3), 4, 5, 6, x=7), m.f.__doc__, m.f.__name__
+    c = m.make_counter(10)
+    print c(), c(5)
+    print list(m.gen(5))
+    o = m.C()
+    print m.C.__doc__, m.C.__module__, o.m(2)(3), o.p
+    print m.g()
+
+import pyc_bytecode_cache_target
+run(pyc_bytecode_cache_target)
+
+del sys.modules["pyc_bytecode_cache_target"]
+import pyc_bytecode_cache_target
+run(pyc_bytecode_cache_target)
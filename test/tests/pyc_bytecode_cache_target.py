@@ -0,0 +1,46 @@
+# -*- coding: utf-8 -*-
+# Used by pyc_bytecode_cache.py: covers the different kinds of constants and code objects which end up in the
+# bytecode section of the .pyc file.
+"""module docstring"""
+
+from __future__ import division
+
+constants = (1, -5, 2.5, -0.0, 10 ** 30, 123456789012345678901234567890L, 3j, u"unicöde", "str", None, Ellipsis)
+
+def f(a, (b, c), d=4, *args, **kw):
+    "function docstring"
+    return a + b + c + d + len(args) + len(kw)
+
+def make_counter(start):
+    count = [start]
+    def inc(by=1):
+        count[0] += by
+        return count[0]
+    return inc
+
+def gen(n):
+    for i in xrange(n):
+        try:
+            if i % 2:
+                raise ValueError(i)
+            yield i
+        except ValueError as e:
+            yield -e.args[0]
+        finally:
+            pass
+
+class C(object):
+    "class docstring"
+    x = 1
+
+    def m(self, y):
+        return lambda z: self.x + y + z
+
+    @property
+    def p(self):
+        return [i * i for i in range(4)] + list(i for i in range(2)) + sorted({i for i in "ab"}) + sorted({i: 1 for i in "cd"})
+
+def g():
+    with open(__file__) as fp:
+        pass
+    return 1 / 2, 7 // 2, f(1, (2, 3), d=5, e=6)
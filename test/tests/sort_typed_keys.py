@@ -0,0 +1,70 @@
+# list.sort() compares exact ints, floats and strs directly; make sure that it still behaves like the generic
+# comparison for them, and that it doesn't use the shortcuts when it shouldn't.
+
+import random
+random.seed(12345)
+
+ints = [random.randint(-1000, 1000) for i in xrange(500)]
+print sorted(ints) == sorted(ints, cmp=cmp), sorted(ints)[:5], sorted(ints, reverse=True)[:5]
+import sys
+print sorted([-sys.maxint - 1, sys.maxint, 0, -1, 1])
+
+floats = [random.random() * 100 - 50 for i in xrange(500)]
+print sorted(floats) == sorted(floats, cmp=cmp), sorted(floats)[0] == min(floats)
+print sorted([1.5, -0.0, 0.0, float('inf'), -float('inf'), 2.25])
+
+strs = ["b", "a", "", "ab", "a\x00", "\xff", "\x00", "ba", "abc", "B", "aa"]
+print sorted(strs)
+print sorted(strs, reverse=True)
+print sorted(strs, key=len)
+
+# Stability, with keys that compare equal:
+records = [(random.randint(0, 5), i) for i in xrange(300)]
+by_key = sorted(records, key=lambda r: r[0])
+print by_key == sorted(records), by_key[:4]
+by_key = sorted(records, key=lambda r: str(r[0]), reverse=True)
+print by_key[:4]
+by_key = sorted(records, key=lambda r: float(r[0]))
+print by_key[-4:]
+
+# Mixed types and subclasses have to go through the normal comparisons:
+print sorted([3, 1.5, 2L, True, -1, 0.5])
+print sorted(["b", u"a", "c"])
+
+class MyInt(int):
+    def __lt__(self, other):
+        return int(self) > int(other)
+print sorted([MyInt(1), MyInt(3), MyInt(2)])
+print sorted([MyInt(1), 3, 2])
+
+class MyStr(str):
+    def __lt__(self, other):
+        return len(self) < len(other)
+print sorted(map(MyStr, ["ccc", "a", "bb", "dd"]))
+
+# cmp functions get the keys:
+def mycmp(a, b):
+    assert type(a) is str and type(b) is str
+    return cmp(b, a)
+print sorted(range(15), key=str, cmp=mycmp)
+
+# Errors in the key function or the comparison leave the list intact:
+l = [3, 1, 2, 0]
+try:
+    l.sort(key=lambda x: 1 / x)
+except ZeroDivisionError as e:
+    print e, l
+try:
+    l.sort(cmp=lambda a, b: 1 / 0)
+except ZeroDivisionError as e:
+    print e, sorted(l)
+try:
+    l.sort(key=lambda x: "abc"[x])
+except IndexError as e:
+    print e, sorted(l)
+
+l = range(10)
+try:
+    l.sort(key=lambda x: l.append(x) or -x)
+except ValueError as e:
+    print e
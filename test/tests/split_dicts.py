@@ -0,0 +1,83 @@
+# statcheck: noninit_count('num_split_instance_dicts') >= 50
+# Dict-backed instances of the same class share the keys of their dicts; make sure that they still behave like
+# separate dicts when they get modified.
+
+class Record(object):
+    def __init__(self, **kw):
+        self.__dict__ = kw
+
+class C(object):
+    def __init__(self, i):
+        self.__dict__ = {}
+        self.a = i
+        self.b = i * 2
+        self.c = str(i)
+
+records = [Record(x=i, y=-i, name="r%d" % i) for i in xrange(100)]
+objs = [C(i) for i in xrange(100)]
+
+print records[5].x, records[5].y, records[5].name
+print objs[7].a, objs[7].b, objs[7].c
+print sorted(records[3].__dict__.items())
+
+# Changing a value of one instance doesn't affect the others:
+records[1].x = "changed"
+objs[2].b = None
+print records[0].x, records[1].x, records[2].x
+print objs[1].b, objs[2].b, objs[3].b
+
+# Adding and removing attributes:
+records[4].extra = 1
+del records[6].y
+objs[8].d = 4
+del objs[9].a
+print sorted(records[4].__dict__), sorted(records[5].__dict__), sorted(records[6].__dict__)
+print hasattr(records[6], "y"), hasattr(records[7], "y"), hasattr(records[5], "extra")
+print sorted(objs[8].__dict__), sorted(objs[9].__dict__), sorted(objs[10].__dict__)
+try:
+    objs[9].a
+except AttributeError as e:
+    print e
+
+# The iteration order is the same as for an unshared dict:
+print records[10].__dict__.keys() == dict(x=10, y=-10, name="r10").keys()
+print objs[11].__dict__.items() == {"a": 11, "b": 22, "c": "11"}.items()
+
+# Copies and other dict operations:
+d = records[12].__dict__.copy()
+d["x"] = "copy"
+print records[12].x, d["x"], d == records[12].__dict__
+print records[13].__dict__ == records[13].__dict__.copy()
+print len(records[14].__dict__), "name" in records[14].__dict__, records[14].__dict__.get("nope")
+print records[15].__dict__.pop("name"), sorted(records[15].__dict__)
+print records[16].__dict__.setdefault("x", 0), records[16].__dict__.setdefault("z", 0)
+records[17].__dict__.update(x=1, w=2)
+print sorted(records[17].__dict__.items())
+records[18].__dict__.clear()
+print records[18].__dict__, hasattr(records[18], "x")
+records[18].x = 5
+print records[18].x, records[19].x
+
+for r in records[20:25]:
+    for k in r.__dict__:
+        r.__dict__[k] = k
+print [sorted(r.__dict__.values()) for r in records[20:23]]
+
+# Instances with other keys (or the same keys in another layout) don't get mixed up:
+others = [Record(name="o%d" % i, y=i, x=-i) for i in xrange(5)]
+others += [Record(p=i) for i in xrange(5)]
+print [(r.x, r.y) for r in others[:5]], [r.p for r in others[5:]]
+
+# Dropping the class should drop its keys as well:
+def make_class():
+    class Tmp(object):
+        def __init__(self, i):
+            self.__dict__ = {"i": i, "s": str(i)}
+    return [Tmp(i) for i in xrange(10)]
+for i in xrange(5):
+    l = make_class()
+    print sum(o.i for o in l),
+print
+del l
+import gc
+gc.collect()
@@ -0,0 +1,37 @@
+# statcheck: noninit_count('num_split_instance_dicts') >= 10
+# Dict-backed instances which get a lot of attributes one at a time.  Their dicts keep sharing the keys while they add
+# the same attributes in the same order, instead of getting their own copy of the keys for every new attribute.
+
+class C(object):
+    def __init__(self, n, offset=0):
+        self.__dict__ = {}
+        for i in xrange(n):
+            setattr(self, "attr%d" % i, i + offset)
+
+objs = [C(2000, j) for j in xrange(20)]
+print [o.attr1999 for o in objs[:5]], sum(o.attr1000 for o in objs)
+
+plain = {}
+for i in xrange(2000):
+    plain["attr%d" % i] = i
+print objs[0].__dict__ == plain, objs[-1].__dict__.keys() == plain.keys()
+
+# Built in lockstep:
+objs = [C(0) for j in xrange(10)]
+for i in xrange(500):
+    for j, o in enumerate(objs):
+        setattr(o, "x%d" % i, i * j)
+print [o.x499 for o in objs], all(len(o.__dict__) == 500 for o in objs)
+
+# One of them diverges; the others don't see its attributes:
+objs[3].only_here = 1
+for o in objs:
+    o.x500 = 500
+print [hasattr(o, "only_here") for o in objs], objs[3].x500, objs[4].x500
+plain = {}
+for i in xrange(500):
+    plain["x%d" % i] = 0
+plain["only_here"] = 0
+plain["x500"] = 0
+print objs[3].__dict__.keys() == plain.keys()
+print sorted(objs[2].__dict__.keys()) == sorted(["x%d" % i for i in xrange(501)])
@@ -0,0 +1,52 @@
+# skip-if: '-L' in EXTRA_JIT_ARGS or '-n' in EXTRA_JIT_ARGS or '-I' in EXTRA_JIT_ARGS
+# statcheck: noninit_count("num_stackless_generators_left") >= 2
+# statcheck: noninit_count("num_stackless_generator_bjit_yields") >= 1000
+# statcheck: noninit_count("num_baselinejit_code_blocks") >= 3
+
+# A stackless generator runs in the baseline JIT on the stack of its caller, but it can't OSR from there, so once a loop
+# inside of it runs long without yielding it moves to a generator stack of its own.  There are no loops outside of the
+# generators here, so everything which gets baseline-JITed comes from them.
+
+import sys
+
+def counter(n):
+    for i in xrange(n):
+        yield i * 2
+
+def summer(n):
+    t = 0
+    for i in xrange(n):
+        t += i
+    yield t
+    yield sys._getframe().f_back.f_code.co_name
+
+def caller():
+    return list(summer(100000))
+
+print sum(counter(100000))
+print caller()
+
+# Values sent and exceptions thrown into the generator still arrive after it moved:
+def echo():
+    x = None
+    try:
+        for i in xrange(1000):
+            x = yield (i, x)
+    except ValueError as e:
+        yield "caught " + str(e)
+
+g = echo()
+print g.next(), map(g.send, range(500))[-1]
+print g.throw(ValueError("after moving"))
+print list(g)
+
+# The yield got baseline-JITed while the generator ran stackless, and runs again after it moved:
+def phases(n):
+    got = []
+    for i in xrange(n):
+        if i < 100 or i % 5000 == 0:
+            got.append((yield i))
+    yield got[-5:]
+
+g = phases(20000)
+print g.next(), [g.send(k) for k in xrange(102)][-4:], g.send("last")
@@ -0,0 +1,208 @@
+# statcheck: noninit_count("num_stackless_generators") >= 20
+
+# Generators of functions which are still interpreted run on the stack of their caller and keep their frame in the
+# generator object.  Make sure that they behave the same as the ones with their own stack, also after the function
+# got hot enough to switch over.
+
+import sys
+
+def simple(n):
+    for i in xrange(n):
+        yield i
+    yield "done"
+
+print list(simple(3))
+
+# Several yields in the same block, and yields as expressions:
+def multi():
+    x = yield 1
+    y = yield x + 1
+    yield x, y
+    yield (yield)
+
+g = multi()
+print g.next(), g.send(10), g.send(20), g.next(), g.send("last")
+try:
+    g.next()
+except StopIteration:
+    print "StopIteration"
+
+try:
+    multi().send(1)
+except TypeError as e:
+    print e
+
+# Exceptions thrown into the generator, inside and outside of try blocks:
+def catcher():
+    while True:
+        try:
+            v = yield
+            print "got", v
+        except ValueError as e:
+            print "caught", e
+            yield "after catch"
+        finally:
+            print "finally"
+
+g = catcher()
+g.next()
+g.send(1)
+print g.throw(ValueError, "boom")
+g.next()
+try:
+    g.throw(KeyError, "not caught")
+except KeyError as e:
+    print "KeyError", e
+try:
+    g.next()
+except StopIteration:
+    print "exited"
+
+# Throwing into a generator which hasn't started doesn't run any of its code:
+def never_runs():
+    print "shouldn't get here"
+    yield 1
+
+g = never_runs()
+try:
+    g.throw(ZeroDivisionError)
+except ZeroDivisionError:
+    print "ZeroDivisionError"
+print list(g)
+
+# close() and GeneratorExit:
+def closer():
+    try:
+        yield 1
+        yield 2
+    except GeneratorExit:
+        print "GeneratorExit"
+        raise
+
+g = closer()
+print g.next()
+g.close()
+g.close()
+
+def ignores_exit():
+    try:
+        yield 1
+    except GeneratorExit:
+        pass
+    yield 2
+
+g = ignores_exit()
+g.next()
+try:
+    g.close()
+except RuntimeError as e:
+    print e
+print list(g)
+
+# Dropping a suspended generator closes it:
+def cleanup(l):
+    try:
+        yield 1
+    finally:
+        l.append("cleaned up")
+
+l = []
+g = cleanup(l)
+g.next()
+del g
+print l
+
+# Exceptions escaping from the generator:
+def raiser():
+    yield 1
+    1 / 0
+
+g = raiser()
+g.next()
+try:
+    g.next()
+except ZeroDivisionError:
+    print "ZeroDivisionError from the generator"
+print list(g)
+
+# Closures and generator expressions:
+def make_counter(start):
+    def inc(x):
+        return x + start
+    def gen():
+        for i in xrange(3):
+            yield inc(i)
+    return gen()
+
+print list(make_counter(10))
+print sum(x * x for x in xrange(10)), list(x for x in "abc" if x != "b")
+
+# Recursive generators resume each other:
+def tree(n):
+    if n == 0:
+        yield 0
+        return
+    for x in tree(n - 1):
+        yield x
+    yield n
+
+print list(tree(5))
+
+# Re-entering a running generator:
+def reenter():
+    yield g.next()
+
+g = reenter()
+try:
+    g.next()
+except ValueError as e:
+    print e
+
+# The frame of a suspended generator, resumed from different callers:
+def frames():
+    f = sys._getframe()
+    yield f.f_code.co_name, f.f_back.f_code.co_name
+    yield f.f_back.f_code.co_name
+
+def caller1(g):
+    return g.next()
+
+def caller2(g):
+    return g.next()
+
+g = frames()
+print caller1(g)
+print caller2(g)
+
+# Locals of a suspended generator stay alive until it gets resumed:
+class C(object):
+    def __del__(self):
+        print "C.__del__"
+
+def holds():
+    c = C()
+    yield 1
+    print "resumed"
+    del c
+    yield 2
+
+g = holds()
+g.next()
+print "suspended"
+g.next()
+del g
+
+# Lots of generators of the same function, so that it gets hot and switches over to the generator stacks:
+def counter(n):
+    total = 0
+    for i in xrange(n):
+        total += i
+        yield total
+
+results = []
+gens = []
+for i in xrange(200):
+    g = counter(5)
+    results.append(g.next())
+    gens.append(g)
+print sum(results), sum(sum(g) for g in gens)
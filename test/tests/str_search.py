@@ -0,0 +1,57 @@
+# str searching uses vectorized kernels which handle 16/32 bytes at a time; check matches around the edges of those
+# blocks and in the scalar tails against a simple reference implementation.
+
+def ref_find(s, sub):
+    for i in xrange(len(s) - len(sub) + 1):
+        if s[i:i + len(sub)] == sub:
+            return i
+    return -1
+
+def ref_count(s, sub):
+    n = 0
+    while True:
+        i = ref_find(s, sub)
+        if i == -1:
+            return n
+        n += 1
+        s = s[i + len(sub):]
+
+mismatches = 0
+checks = 0
+for n in (0, 1, 15, 16, 17, 31, 32, 33, 47, 64, 65, 100):
+    for sub in ("x", "xy", "xyz", "xyzw" * 5, "aa"):
+        for pos in range(0, n, 7) + [n - len(sub)]:
+            if pos < 0:
+                continue
+            s = ("a" * pos + sub + "a" * n)[:max(n, pos + len(sub))]
+            checks += 1
+            if s.find(sub) != ref_find(s, sub) or (sub in s) != (ref_find(s, sub) != -1):
+                mismatches += 1
+                print "find", repr(s), repr(sub)
+            if s.count(sub) != ref_count(s, sub):
+                mismatches += 1
+                print "count", repr(s), repr(sub)
+print checks > 0, mismatches
+
+# Near-misses: the first and last characters match but the middle doesn't.
+s = "xaay" * 20 + "xaby"
+print s.find("xaby"), s.count("xaay"), s.count("xaby"), "xaay" in s, "xacy" in s
+print "".find(""), "abc".find(""), "abc".count(""), "" in "abc"
+
+line = ",".join(str(i) for i in xrange(50))
+parts = line.split(",")
+print len(parts), parts[:3], parts[-3:]
+print line.split(",", 3)[:4] == parts[:3] + [",".join(parts[3:])]
+print "a,,b,".split(","), ",".split(","), "abc".split(","), "".split(",")
+print line.count(","), line.count("1"), line.count("1", 10, 40)
+print line.replace(",", ";")[:30], line.replace("4", "")[:30], line.replace(",", "", 5)[:30]
+print line.rfind("4"), line.index("49"), line.partition(",4")[2][:10]
+
+table = "".join(chr((i + 1) % 256) for i in xrange(256))
+print "hello world".translate(table), "hello world".translate(None, "lo")
+print "hello world".translate(table, "lo"), repr("\xff\x00".translate(table)), repr("".translate(table, "x"))
+print "hello".translate(None), "hello".translate(None, "")
+try:
+    "hello".translate("abc")
+except ValueError as e:
+    print e
@@ -0,0 +1,31 @@
+# skip-if: '-L' in EXTRA_JIT_ARGS or '-n' in EXTRA_JIT_ARGS or '-I' in EXTRA_JIT_ARGS
+# statcheck: noninit_count('num_deopt') == 1
+
+# A site which switched to producing a different class has to get speculated on the new class, even though the
+# old one was seen more often in total: f() tiers up during the run of ints, so the LLVM tier should assume that
+# o.x is an int, and the float at the end is the only deopt.
+
+try:
+    import __pyston__
+    __pyston__.setOption("OSR_THRESHOLD_BASELINE", 100000)
+    __pyston__.setOption("REOPT_THRESHOLD_BASELINE", 300)
+    __pyston__.setOption("SPECULATION_THRESHOLD", 50)
+except ImportError:
+    pass
+
+class C(object):
+    def __init__(self, x):
+        self.x = x
+
+def f(o):
+    return o.x
+
+def run(o, n):
+    t = 0
+    for i in xrange(n):
+        t += f(o)
+    return t
+
+print run(C(1.5), 200)
+print run(C(2), 400)
+print run(C(2.5), 1)